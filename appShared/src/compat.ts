@@ -1,3 +1,5 @@
+import { DataLane, DataSendOptions } from "./types";
+
 /**
  * Interface representing a UDP datagram socket.
  * Provides methods for creating, sending, receiving data, and closing the socket.
@@ -13,9 +15,165 @@ export abstract class DatagramCompat {
     abstract send(data: Uint8Array, port: number, address: string): Promise<void>;
     abstract close(): void;
 
-    onMessage?: (msg: Uint8Array, rinfo: { address: string; family: string; port: number }) => void;
+    /**
+     * Optional send backpressure. Sockets with a bounded native send queue
+     * report how many more datagrams it takes right now, and call onDrain
+     * once it has room again after running out. send() keeps working when
+     * out of credits; it just resolves later.
+     */
+    sendCredits?(): number;
+    onDrain?: () => void;
+
+    /**
+     * Optional transport counters from native sockets: what happened below
+     * ReDatagram, to tell network loss apart from a stalled event loop.
+     */
+    stats?(): DatagramSocketStats | null;
+
+    onMessage?: (msg: Uint8Array, rinfo: DatagramRemoteInfo) => void;
+
+    /**
+     * Optional batched receive. Sockets that support it deliver every datagram
+     * that arrived since JS last ran in one call; others (and batching sockets
+     * when this is unset) keep calling onMessage per datagram.
+     * The batch memory may be reused once this returns: copy anything kept.
+     */
+    onMessageBatch?: (batch: DatagramBatch) => void;
+
+    /**
+     * Optional native ReUDP. Sockets that can run the reliability layer off
+     * the JS thread return a session for the given peer and ReDatagram hands
+     * its work over; null (or unset) means ReDatagram runs it in JS.
+     */
+    openReliableSession?(options: ReliableSessionOptions): ReliableSessionCompat | null;
+
+    /**
+     * Optional native peer filter. Sockets that support it drop datagrams
+     * from anyone but these peers (and their sessions' peers) before JS
+     * runs; null lifts the filter. Returns false when not applied, e.g. for
+     * non-numeric addresses; callers keep checking sources themselves.
+     */
+    setPeerFilter?(peers: DatagramPeer[] | null): boolean;
+
+    /**
+     * Optional: true when datagrams go out with the don't-fragment bit set,
+     * so ReDatagram may probe the path for packets above 1300 bytes. May turn
+     * false later, if the route can't take even those whole.
+     */
+    isDontFragment?(): boolean;
+
+    /**
+     * Optional: the largest datagram the local route to `address` takes
+     * without fragmenting, 0 if unknown. ReDatagram doesn't probe past it.
+     */
+    maxDatagramSize?(address: string): number;
 }
 
+export type DatagramRemoteInfo = { address: string; family: string; port: number };
+
+/** A peer's port and every address it may send from. */
+export type DatagramPeer = { addresses: string[]; port: number };
+
+export type DatagramSocketStats = {
+    packetsReceived: number;
+    bytesReceived: number;
+    packetsSent: number;
+    bytesSent: number;
+    kernelDrops?: number;     // receive-queue overflows reported by the OS (Linux only)
+    batchDrops: number;       // dropped natively because JS fell behind
+    truncated: number;        // datagrams too large for a receive slot
+    filtered?: number;        // dropped natively by the peer filter
+    shed?: number;            // dropped natively: from a session peer not yet validated, past its rate limit
+    challenged?: number;      // answered natively with a cookie: from a session peer not yet validated
+    sendErrors: number;       // datagrams the OS refused to send
+    sendFull: number;         // sends turned away for lack of credits
+    recvBuffer?: number;      // kernel receive buffer in bytes, autotuned (Linux only)
+    sendBuffer?: number;      // kernel send buffer in bytes, autotuned (Linux only)
+    sendQueue: number;        // datagrams waiting to be sent
+    pendingDatagrams: number; // received, waiting for the next batch callback
+    pendingEvents: number;    // callbacks queued for the JS thread
+    peakPendingEvents: number;
+    /** Time from a native event being queued to its JS callback starting. */
+    handoff: {
+        count: number;
+        p50Us: number;
+        p90Us: number;
+        p99Us: number;
+        maxUs: number;
+        buckets: number[]; // bucket i: [2^i, 2^(i+1)) µs
+    };
+};
+
+/**
+ * Datagrams packed back to back in `data`. `table` holds one
+ * [offset, length, rinfoIndex] triple per datagram.
+ */
+export type DatagramBatch = {
+    data: Uint8Array;
+    table: Uint32Array;
+    rinfos: DatagramRemoteInfo[];
+    times?: Float64Array; // per datagram: kernel receive time in ms since the epoch (0 if not stamped)
+};
+
+export type ReliableSessionOptions = {
+    addresses: string[]; // allowed peer addresses, the first one is contacted
+    port: number;
+    isLan: boolean;
+    isLegacyPeer?: boolean; // the peer may run ReUDP before v8 (the JS engine), which can't answer a cookie challenge
+};
+
+/**
+ * A ReUDP session run by the socket implementation. Same wire protocol and
+ * semantics as ReDatagram; only in-order payload crosses into JS.
+ */
+export interface ReliableSessionCompat {
+    /** Queues data on its lane; resolves once the session can take more. Media sends get FEC (see reUdpProtocol.ts). */
+    send(data: Uint8Array, options?: DataSendOptions): Promise<void>;
+    /** Graceful close (BYE to the peer). onClose follows. */
+    close(): void;
+
+    onReady?: (isSuccess: boolean) => void;
+    onMessage?: (data: Uint8Array, lane: DataLane) => void;
+    onClose?: (err: Error | null) => void;
+
+    /** Latest congestion-control snapshot, for diagnostics. */
+    stats?(): ReliableSessionStats | null;
+
+    /**
+     * Optional: take over RPCPeer's frame encryption for one direction of
+     * the byte stream (AES-256-CTR, hex key and IV as from CryptoModule).
+     * Output is byte-identical to the JS cipher, one keystream per lane.
+     */
+    setFrameCipher?(direction: 'send' | 'recv', secretKey: string, iv: string): void;
+}
+
+export type ReliableSessionStats = {
+    bytesSent: number;
+    bytesReceived: number;
+    packetsSent: number;
+    packetsReceived: number;
+    retransmits: number;
+    cwnd: number;
+    ssthresh: number;
+    srtt: number;
+    rto: number;
+    inFlight: number;
+    queuedBytes: number;
+    pacingRate: number;   // bytes/s new data is paced at, 0 when unpaced
+    pacingDelays: number; // times the pacer held back a packet the window allowed
+    lossRate: number;      // smoothed share of packets reported missing
+    paritySent: number;    // FEC parity packets sent
+    fecRecovered: number;  // packets rebuilt from parity instead of retransmitted
+    mtu: number;           // largest packet the path currently takes
+    bottleneckRate?: number; // bytes/s the BBR model measured the path at, 0 under AIMD (native sessions only)
+    minRtt?: number;       // ms, lowest recent RTT sample (native sessions only)
+    isEcn?: boolean;       // packets go out ECN-capable (native sessions only)
+    ceReported?: number;   // CE marks the peer echoed back (native sessions only)
+    localDrops?: number;   // datagrams our socket dropped, reported to the peer (native sessions only)
+    lossesExcused?: number; // losses the peer's socket owned up to, not taken for congestion (native sessions only)
+    cookiesAnswered?: number; // cookie challenges from the peer's socket, answered (native sessions only)
+};
+
 export interface HttpClientCompat {
     setDefaultHeader(name: string, value: string): void;
     get(url: string | URL, headers?: Record<string, string>): Promise<Response>;
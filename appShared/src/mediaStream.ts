@@ -17,6 +17,23 @@
 const textEncoder = new TextEncoder();
 const textDecoder = new TextDecoder();
 
+const mediaStreams = new WeakSet<ReadableStream<Uint8Array>>();
+
+/**
+ * Mark a stream as live media. RPC sends its chunks on the media lane, which
+ * ReUDP answers with forward error correction: a lost packet is rebuilt on
+ * arrival instead of stalling playback for a retransmit, and a file copy on
+ * the bulk lane doesn't hold frames back.
+ */
+export function markMediaStream<T extends ReadableStream<Uint8Array>>(stream: T): T {
+    mediaStreams.add(stream);
+    return stream;
+}
+
+export function isMediaStream(stream: ReadableStream<Uint8Array>): boolean {
+    return mediaStreams.has(stream);
+}
+
 export interface MediaChunkMetadata {
     [key: string]: string;
 }
@@ -1,8 +1,10 @@
-import { DatagramCompat } from "./compat";
+import { DatagramCompat, DatagramRemoteInfo, ReliableSessionCompat } from "./compat";
+import { DataLane, DataSendOptions } from "./types";
 import { isLocalIp, isDebug, safeIp } from "./utils";
 
 const HEADER_SIZE = 5; // 1 byte type + 4 bytes seq
-const MAX_PACKET_SIZE = 1300;
+const BASE_PACKET_SIZE = 1300;     // fits any path; the packet size until probing finds more
+const MAX_PACKET_SIZE = 8972;      // 9000-byte jumbo frame less IPv4 + UDP headers
 const ACK_BATCH_SIZE = 64;
 const MAX_BUFFERED_PACKETS = 1024;
 const INITIAL_RTO = 1200;          // ms — initial RTO before any RTT measurement
@@ -42,20 +44,121 @@ const FLAG_HELLO_ACK = 3;
 const FLAG_BYE = 4;
 const FLAG_PING = 5;
 
-const MAX_PACKET_PAYLOAD = MAX_PACKET_SIZE - HEADER_SIZE;
+// Wire format v2, used only once the peer has announced it in HELLO / HELLO_ACK.
+// Its packet types have the high bit set so they parse regardless of what the
+// receiver has negotiated; v1 peers never see them.
+const PROTOCOL_VERSION = 5;
+const FLAG_V2 = 0x80;
+const FLAG_DATA_V2 = FLAG_V2 | FLAG_DATA; // [type][seq & 0xFFFF (2)][payload]
+const FLAG_ACK_V2 = FLAG_V2 | FLAG_ACK;   // [type][cumulative seq (4)][bitmap]
+const DATA_V2_HEADER_SIZE = 3;
+const ACK_BITMAP_BYTES = MAX_SEND_WINDOW / 8; // bit i: seq cumulative + 2 + i received
+
+// Lanes (v4): independent ordering domains over the one seq space. Every
+// DATA packet keeps its place in the seq for ACKs, loss recovery and cwnd,
+// and also carries its lane and a per-lane seq that the receiver delivers by.
+// Without lanes everything travels on control, and a packet's lane seq is its seq.
+const FLAG_DATA_LANE = FLAG_V2 | 7; // [type][seq & 0xFFFF (2)][lane (1)][lane seq & 0xFFFF (2)][payload]
+const DATA_LANE_HEADER_SIZE = 6;
+const LANE_FIELDS_SIZE = DATA_LANE_HEADER_SIZE - DATA_V2_HEADER_SIZE;
+const LANE_COUNT = 3;
+const LANE_WEIGHTS = [8, 4, 1]; // share of packets while lanes compete
+const CONTROL_HEADROOM = 4;     // packets control may have in flight past a full window
+
+// Forward error correction (v3): media DATA goes out in groups of consecutive
+// packets, each followed by the XOR of their payloads, so the receiver can
+// rebuild one lost packet per group without waiting for a retransmit.
+// Payloads are padded to the longest; the XOR of their lengths recovers the missing one's.
+// With lanes, a group's packets are interleaved with other lanes' and the
+// parity names them by a mask over the seqs it spans; the XOR then also
+// covers their lane fields, so a rebuilt packet knows where to go.
+const FLAG_PARITY = FLAG_V2 | 6; // [type][first seq (4)][count (1)][length xor (2)][payload xor]
+const PARITY_HEADER_SIZE = 8;
+const FLAG_PARITY_LANE = FLAG_V2 | 8; // [type][first seq (4)][member mask (8)][length xor (2)][lane fields + payload xor]
+const PARITY_LANE_HEADER_SIZE = 15;
+const FEC_MAX_SPAN = 64; // seqs one lane group may span: bits in the member mask
+const MAX_PARITY_BODY = MAX_PACKET_SIZE - PARITY_LANE_HEADER_SIZE;
+const FEC_MIN_GROUP = 4;
+const FEC_MAX_GROUP = 32;           // ~3% overhead on a loss-free link
+const FEC_LOSSES_PER_GROUP = 0.25;  // group size aims for this many expected losses
+const FEC_LOSS_SAMPLE = 32;         // packets sent before a loss-rate sample counts
+const FEC_HISTORY = 2 * FEC_MAX_GROUP; // delivered payloads a receiver keeps for recovery
+
+// Path MTU discovery (v5, DPLPMTUD as in RFC 8899): packets start at
+// BASE_PACKET_SIZE; on sockets that send with the don't-fragment bit set,
+// PINGs padded to the size under test (carried in the seq field) probe for
+// larger ones, which the peer confirms with a PROBE_ACK if they arrived
+// whole. A larger packet that keeps going unanswered means the path shrank
+// without telling us (a black hole): the size drops back to the base, and
+// DATA already sent larger is retransmitted in FRAGMENTs that the peer puts
+// back together.
+const FLAG_PROBE_ACK = FLAG_V2 | 9; // [type][probe size (4)]
+const FLAG_FRAGMENT = FLAG_V2 | 10; // [type][seq (4)][index (1)][count (1)][piece of the DATA packet]
+const FRAGMENT_HEADER_SIZE = 7;
+const MAX_FRAGMENTS = Math.ceil(MAX_PACKET_SIZE / (BASE_PACKET_SIZE - FRAGMENT_HEADER_SIZE));
+const MTU_PROBE_SIZES = [1452, 1472, 8952, 8972]; // 1500 and 9000-byte frames, less IPv6 / IPv4 + UDP headers
+const MAX_PROBES = 3;               // probes of one size lost before it counts as too big
+const BLACK_HOLE_ATTEMPTS = 3;      // sends of a larger-than-base packet without an ACK
+const MTU_RAISE_INTERVAL_MS = 10 * 60 * 1000; // search again this long after the last one ended
+const MAX_REASSEMBLIES = 64;        // fragmented packets being put back together at once
+
+// Sent by native sockets (v8) to peers they haven't validated: [type][cookie (4)].
+// Answered with a HELLO echoing it, as the native engine does
+const FLAG_COOKIE = FLAG_V2 | 13;
+
+// Packet size a search found per peer address, probed first by its next session
+const pathMtuCache = new Map<string, { size: number; at: number }>();
+
+function cachedPathMtu(address: string): number {
+    const entry = pathMtuCache.get(address);
+    if (!entry) return 0;
+    if (Date.now() - entry.at > MTU_RAISE_INTERVAL_MS) {
+        pathMtuCache.delete(address);
+        return 0;
+    }
+    return entry.size;
+}
+
+// The base size after a black hole forgets the peer's
+function rememberPathMtu(address: string, size: number) {
+    if (size > BASE_PACKET_SIZE) pathMtuCache.set(address, { size, at: Date.now() });
+    else pathMtuCache.delete(address);
+}
+
+/** Full seq nearest to `expected` whose low 16 bits are `truncated`. */
+function expandSeq(truncated: number, expected: number): number {
+    let candidate = Math.floor(expected / 0x10000) * 0x10000 + truncated;
+    if (candidate + 0x8000 <= expected && candidate + 0x10000 <= 0xFFFFFFFF) {
+        candidate += 0x10000;
+    } else if (candidate > expected + 0x8000 && candidate >= 0x10000) {
+        candidate -= 0x10000;
+    }
+    return candidate;
+}
 
 const STRICT_IP_CHECK = true;
+// Peers may still run a release whose engine can't answer a native socket's
+// cookie challenge; false once none is left. While true, any HELLO claiming
+// a version before v8 gets a session past the challenge
+const ALLOW_LEGACY_PEERS = true;
+
+// A DATA packet as received: where it is delivered, and what
+type ReceivedPacket = { lane: DataLane; laneSeq: number; payload: Uint8Array };
 
 export class ReDatagram {
     private socket: DatagramCompat;
+    private native: ReliableSessionCompat | null = null; // set when the socket runs ReUDP itself
     private remote: { address: string; port: number };
     private allowedAddresses: Set<string>;
     public tag: string;
 
     private sendSeq = 1;
     private recvSeq = 1;
+    private peerVersion = 1; // from its HELLO / HELLO_ACK, or any v2 packet
+    private cookie: number | null = null; // the peer's socket last challenged us with
+    private cookieAnsweredAt = 0;
 
-    private sendWindow = new Map<number, { packet: Uint8Array; sentAt: number; attempts: number; sacked: boolean }>();
+    private sendWindow = new Map<number, { packet: Uint8Array; lane: DataLane; sentAt: number; attempts: number; sacked: boolean; lost: boolean }>();
     private ackPending = 0;
 
     private retransmitScanId: number | null = null;
@@ -64,16 +167,22 @@ export class ReDatagram {
     private isRemoteClosed = false;
     private isClosing = false;
 
-    onMessage?: (data: Uint8Array) => void;
+    onMessage?: (data: Uint8Array, lane: DataLane) => void;
     onClose?: (err: Error | null) => void;
     private onReady?: (isSuccess: boolean) => void;
 
     private lastPingReceived = Date.now();
 
-    private sendQueue: Promise<void> = Promise.resolve();
-
-    // Flow control: resolve callbacks waiting for window space
-    private windowWaiters: (() => void)[] = [];
+    // Sending, per lane: sends queue behind each other, so each lane has at
+    // most one waiting for window space
+    private sendQueues: Promise<void>[] = Array.from({ length: LANE_COUNT }, () => Promise.resolve());
+    private windowWaiters: ((() => void) | null)[] = new Array(LANE_COUNT).fill(null);
+    private laneBytes: number[] = new Array(LANE_COUNT).fill(0);   // queued, not yet packetized
+    private laneNextSeq: number[] = new Array(LANE_COUNT).fill(1); // lane seq of its next DATA packet
+    private laneFinish: number[] = new Array(LANE_COUNT).fill(0);  // virtual time its last packet finished at
+    private virtualTime = 0;     // start of the last packet scheduled, for weighted fair queueing
+    private sackedInFlight = 0;  // packets in sendWindow the receiver already has
+    private controlInFlight = 0; // control packets sent and neither ACKed nor SACKed
 
     // Benchmarking
     private bytesSent = 0;
@@ -96,6 +205,29 @@ export class ReDatagram {
     private inRecovery = false;          // QUIC-style recovery phase
     private recoveryUntil = 0;           // minimum time before exiting recovery
 
+    // FEC: group being sent, loss rate sizing the groups, payloads kept for rebuilding
+    private fecGroup: { first: number; count: number; maskHi: number; maskLo: number; isLaneGroup: boolean; length: number; lengthXor: number; parity: Uint8Array } | null = null;
+    private lossRate = 0;
+    private lostPackets = 0;
+    private packetsSent = 0;
+    private lossSampleSent = 0;
+    private lossSampleLost = 0;
+    private paritySent = 0;
+    private fecRecovered = 0;
+    private fecHistory: Map<number, ReceivedPacket> | null = null; // from the first parity packet on
+
+    // Path MTU: DATA goes out in packets up to packetSize; a search probes for more
+    private packetSize = BASE_PACKET_SIZE;
+    private canProbe = false;          // the socket sends with the don't-fragment bit set
+    private isMtuSearchStarted = false;
+    private probeSize = 0;             // awaiting its PROBE_ACK; 0: none
+    private probeHint = 0;             // size the last session to this peer found, tried first
+    private probeCeiling = Infinity;   // smallest size known not to get through
+    private maxProbeSize = MAX_PACKET_SIZE; // most the local route takes
+    private probeAttempts = 0;
+    private probeTimeout: number | null = null;
+    private reassembly = new Map<number, { count: number; have: number; pieces: (Uint8Array | null)[] }>();
+
     private statsLastBytesSent = 0;
     private statsLastBytesReceived = 0;
     private statsLastRetransmits = 0;
@@ -116,26 +248,31 @@ export class ReDatagram {
         this.remote = { address: peerAddresses[0], port };
         this.allowedAddresses = new Set(peerAddresses);
 
-        this.socket.onMessage = (msg, rinfo) => {
-            // always verify port matches
-            if (rinfo.port !== this.remote.port) {
-                console.warn(`[ReUDP:${this.tag}] Ignoring packet from unexpected port.`);
-                console.debug(`[ReUDP:${this.tag}] Expected address ${safeIp(this.remote.address)}:${this.remote.port}, got ${safeIp(rinfo.address)}:${rinfo.port}`);
-                return;
-            }
-            // make sure message is from an allowed remote address
-            if (STRICT_IP_CHECK && !this.allowedAddresses.has(rinfo.address)) {
-                console.warn(`[ReUDP:${this.tag}] Ignoring packet from unexpected remote.`);
-                console.debug(`[ReUDP:${this.tag}] Expected address ${safeIp(this.remote.address)}:${this.remote.port}, got ${safeIp(rinfo.address)}:${rinfo.port}`);
-                return;
-            }
-            // Update remote address if it changed to an allowed one
-            if (rinfo.address !== this.remote.address && this.allowedAddresses.has(rinfo.address)) {
-                console.debug(`[ReUDP:${this.tag}] Remote address changed from ${safeIp(this.remote.address)}:${this.remote.port} to ${safeIp(rinfo.address)}:${rinfo.port}.`);
-                this.remote.address = rinfo.address;
-            }
-            this.handlePacket(msg);
-        };
+        // Sockets that can filter natively drop other senders before JS runs;
+        // acceptPacket() keeps checking for those that can't
+        if (STRICT_IP_CHECK) this.socket.setPeerFilter?.([{ addresses: peerAddresses, port }]);
+        this.native = this.socket.openReliableSession?.({ addresses: peerAddresses, port, isLan, isLegacyPeer: ALLOW_LEGACY_PEERS }) ?? null;
+        if (this.native) {
+            console.debug(`[ReUDP:${this.tag}] Using native session.`);
+            this.attachNativeSession(this.native);
+            this.socket.onMessage = undefined;
+            this.socket.onMessageBatch = undefined;
+            this.socket.onDrain = undefined;
+        } else {
+            this.canProbe = this.socket.isDontFragment?.() ?? false;
+            this.maxProbeSize = this.socket.maxDatagramSize?.(this.remote.address) || MAX_PACKET_SIZE;
+            this.probeHint = cachedPathMtu(this.remote.address);
+            this.socket.onMessage = (msg, rinfo) => this.acceptPacket(msg, rinfo);
+            // Batching sockets hand over everything received since the last JS
+            // turn at once; walk it here instead of paying one callback per packet.
+            this.socket.onMessageBatch = ({ data, table, rinfos, times }) => {
+                for (let i = 0; i < table.length && !this.isClosing; i += 3) {
+                    this.acceptPacket(data.subarray(table[i], table[i] + table[i + 1]), rinfos[table[i + 2]], times?.[i / 3]);
+                }
+            };
+            // The native send queue filled up before the window did
+            this.socket.onDrain = () => this.wakeWindowWaiters();
+        }
 
         this.socket.onError = (err) => {
             if (this.isClosing) {
@@ -152,16 +289,67 @@ export class ReDatagram {
             if (this.isClosing) this.onClose?.(null);
         };
 
+        if (isDebug()) this.startStatsLoop();
+
+        // The native session does its own handshake, keepalive and retransmits
+        if (this.native) return;
+
         this.sendHello();
         this.startPingLoop();
         this.startRetransmitLoop();
-        if (isDebug()) this.startStatsLoop();
+    }
+
+    private attachNativeSession(session: ReliableSessionCompat) {
+        session.onReady = (isSuccess) => {
+            if (isSuccess) this.markReady();
+        };
+        session.onMessage = (data, lane) => {
+            this.bytesReceived += data.length;
+            this.onMessage?.(data, lane);
+        };
+        session.onClose = (err) => {
+            if (this.isClosing) return;
+            if (err) {
+                if (!this.isReady) {
+                    this.onClose?.(err);
+                } else {
+                    console.warn(`[ReUDP:${this.tag}] Native session closed: ${err.message}`);
+                }
+            } else {
+                console.log(`[ReUDP:${this.tag}] Native session closed by remote.`);
+            }
+            this.isRemoteClosed = true;
+            this.close();
+        };
+    }
+
+    // receivedAt: when the kernel took the datagram in (Date.now() clock), where the socket says
+    private acceptPacket(msg: Uint8Array, rinfo: DatagramRemoteInfo, receivedAt?: number) {
+        // always verify port matches
+        if (rinfo.port !== this.remote.port) {
+            console.warn(`[ReUDP:${this.tag}] Ignoring packet from unexpected port.`);
+            console.debug(`[ReUDP:${this.tag}] Expected address ${safeIp(this.remote.address)}:${this.remote.port}, got ${safeIp(rinfo.address)}:${rinfo.port}`);
+            return;
+        }
+        // make sure message is from an allowed remote address
+        if (STRICT_IP_CHECK && !this.allowedAddresses.has(rinfo.address)) {
+            console.warn(`[ReUDP:${this.tag}] Ignoring packet from unexpected remote.`);
+            console.debug(`[ReUDP:${this.tag}] Expected address ${safeIp(this.remote.address)}:${this.remote.port}, got ${safeIp(rinfo.address)}:${rinfo.port}`);
+            return;
+        }
+        // Update remote address if it changed to an allowed one
+        if (rinfo.address !== this.remote.address && this.allowedAddresses.has(rinfo.address)) {
+            console.debug(`[ReUDP:${this.tag}] Remote address changed from ${safeIp(this.remote.address)}:${this.remote.port} to ${safeIp(rinfo.address)}:${rinfo.port}.`);
+            this.remote.address = rinfo.address;
+        }
+        this.handlePacket(msg, receivedAt);
     }
 
     private startRetransmitLoop() {
         this.retransmitScanId = setInterval(() => {
             if (this.isClosing) return;
             const now = Date.now();
+            this.updateLossRate();
 
             let retransmitsThisScan = 0;
             for (const [seq, entry] of this.sendWindow) {
@@ -181,11 +369,9 @@ export class ReDatagram {
                 // where ACK spikes >MIN_RTO are common), not actual congestion.
                 // SACK-driven fast retransmit handles reliable mid-stream loss detection.
                 if (entry.attempts >= 2) this.onCongestionEvent();
-                this.retransmitCount++;
-                entry.attempts++;
-                entry.sentAt = now;
+                this.noteLoss(entry);
                 retransmitsThisScan++;
-                this.socket.send(entry.packet, this.remote.port, this.remote.address).catch(() => { });
+                this.retransmit(seq, entry, now);
             }
         }, RETRANSMIT_SCAN_INTERVAL);
     }
@@ -203,7 +389,23 @@ export class ReDatagram {
                 const sendRate = ((sentDelta / dt) / 1024).toFixed(1);
                 const recvRate = ((recvDelta / dt) / 1024).toFixed(1);
                 const windowWaitInfo = this.windowWaitCount > 0 ? ` | WindowWait: ${this.windowWaitMs}ms (${this.windowWaitCount}×)` : '';
-                console.debug(`[ReUDP:${this.tag}] [STATS] TX: ${sendRate} KB/s (${(this.bytesSent / 1024).toFixed(0)} KB total) | RX: ${recvRate} KB/s (${(this.bytesReceived / 1024).toFixed(0)} KB total) | Window: ${this.sendWindow.size}/${this.effectiveWindow()} | cwnd: ${Math.floor(this.cwnd)} ssthresh: ${this.ssthresh} | Retransmits: ${retxDelta} (${this.retransmitCount} total) | RTO: ${this.rto}ms SRTT: ${this.srtt.toFixed(0)}ms${windowWaitInfo}`);
+                // Native sessions keep congestion state (and pacing) on their side
+                const native = this.native?.stats?.();
+                const ccInfo = native
+                    ? `Window: ${native.inFlight}/${Math.floor(native.cwnd)} | cwnd: ${Math.floor(native.cwnd)} ssthresh: ${native.ssthresh} | Retransmits: ${native.retransmits} total | RTO: ${native.rto}ms SRTT: ${native.srtt.toFixed(0)}ms | Pacing: ${(native.pacingRate / 1024).toFixed(0)} KB/s (${native.pacingDelays} delays)`
+                    : `Window: ${this.sendWindow.size}/${this.effectiveWindow()} | cwnd: ${Math.floor(this.cwnd)} ssthresh: ${this.ssthresh} | Retransmits: ${retxDelta} (${this.retransmitCount} total) | RTO: ${this.rto}ms SRTT: ${this.srtt.toFixed(0)}ms${windowWaitInfo}`;
+                const mtuInfo = ` | MTU: ${native?.mtu ?? this.packetSize}`;
+                // Native sockets also say whether the stall is below us: OS / native drops, JS handoff delay
+                const sock = this.socket.stats?.();
+                const sockInfo = sock
+                    ? ` | Socket drops: ${sock.kernelDrops ?? '-'} kernel, ${sock.batchDrops} native, ${sock.shed ?? 0} shed | Handoff p99: ${(sock.handoff.p99Us / 1000).toFixed(1)}ms (${sock.pendingEvents} queued)`
+                    : '';
+                // FEC, once either direction has used it
+                const fec = native ?? { paritySent: this.paritySent, fecRecovered: this.fecRecovered, lossRate: this.lossRate };
+                const fecInfo = fec.paritySent > 0 || fec.fecRecovered > 0
+                    ? ` | FEC: ${fec.paritySent} parity sent, ${fec.fecRecovered} recovered, loss ${(fec.lossRate * 100).toFixed(1)}%`
+                    : '';
+                console.debug(`[ReUDP:${this.tag}] [STATS] TX: ${sendRate} KB/s (${(this.bytesSent / 1024).toFixed(0)} KB total) | RX: ${recvRate} KB/s (${(this.bytesReceived / 1024).toFixed(0)} KB total) | ${ccInfo}${mtuInfo}${fecInfo}${sockInfo}`);
                 this.windowWaitMs = 0;
                 this.windowWaitCount = 0;
             }
@@ -246,6 +448,44 @@ export class ReDatagram {
         return buf;
     }
 
+    // HELLO / HELLO_ACK: [header(5)] [protocol version(1)]; v1 peers ignore the extra byte.
+    // A HELLO also echoes the cookie the peer's socket last challenged us with.
+    private encodeHandshake(type: number): Uint8Array {
+        const withCookie = type === FLAG_HELLO && this.cookie !== null;
+        const buf = new Uint8Array(HEADER_SIZE + (withCookie ? 5 : 1));
+        buf.set(this.encodeHeader(type, 0));
+        buf[HEADER_SIZE] = PROTOCOL_VERSION;
+        if (withCookie) {
+            new DataView(buf.buffer).setUint32(HEADER_SIZE + 1, this.cookie!, false);
+        }
+        return buf;
+    }
+
+    // The peer's socket holds our packets back until a HELLO echoes its cookie.
+    // Answered ready or not: we stop sending HELLOs once ready, but the peer may
+    // still be challenging our HELLO_ACKs. At most once per RTO, so a forged
+    // stream of cookies doesn't turn into one of HELLOs.
+    private onCookie(cookie: number) {
+        const now = Date.now();
+        if (this.cookie !== null && now - this.cookieAnsweredAt < this.rto) return;
+        this.cookie = cookie;
+        this.cookieAnsweredAt = now;
+        const header = this.encodeHandshake(FLAG_HELLO);
+        this.socket.send(header, this.remote.port, this.remote.address).catch(() => { });
+    }
+
+    // v1 peers send bare handshakes
+    private onPeerVersion(buf: Uint8Array) {
+        if (buf.length > HEADER_SIZE) {
+            this.peerVersion = Math.max(this.peerVersion, buf[HEADER_SIZE]);
+        }
+    }
+
+    /** Wire format in use towards the peer: 1 until it announces v2. */
+    private wireVersion() {
+        return Math.min(PROTOCOL_VERSION, this.peerVersion);
+    }
+
     private decodeHeader(buf: Uint8Array): { type: number; seq: number } {
         if (buf.length < HEADER_SIZE) {
             throw new Error(`Invalid packet: too short (${buf.length} < ${HEADER_SIZE})`);
@@ -265,7 +505,7 @@ export class ReDatagram {
             return;
         }
         console.debug(`[ReUDP:${this.tag}] Sending HELLO (attempt ${attempt})`);
-        const header = this.encodeHeader(FLAG_HELLO, 0);
+        const header = this.encodeHandshake(FLAG_HELLO);
         await this.socket.send(header, this.remote.port, this.remote.address);
         setTimeout(() => this.sendHello(attempt + 1), INITIAL_RTO);
     }
@@ -276,9 +516,91 @@ export class ReDatagram {
         this.socket.send(header, this.remote.port, this.remote.address).catch(() => { });
     }
 
+    // Once the handshake shows the peer answers probes
+    private startMtuSearch() {
+        if (!this.canProbe || this.isMtuSearchStarted || this.wireVersion() < 5) return;
+        this.isMtuSearchStarted = true;
+        this.probeMtu();
+    }
+
+    // Next size to try: the hint, then the candidates between what fits and what didn't
+    private nextProbeSize() {
+        const hint = this.probeHint;
+        this.probeHint = 0;
+        const fits = (size: number) => size > this.packetSize && size < this.probeCeiling && size <= this.maxProbeSize;
+        if (fits(hint)) return hint;
+        return MTU_PROBE_SIZES.find(fits) ?? 0;
+    }
+
+    // Send a probe: the one awaiting its PROBE_ACK again, or the next size
+    // once that one counts as too big. Probes are not DATA: not in the window,
+    // not retransmitted, and their loss isn't congestion.
+    private probeMtu() {
+        if (this.probeTimeout) clearTimeout(this.probeTimeout);
+        this.probeTimeout = null;
+        if (this.isClosing) return;
+        if (!this.socket.isDontFragment?.()) {
+            // The socket fragments again: a probe would get through at any size
+            console.debug(`[ReUDP:${this.tag}] Socket stopped sending with DF, back to ${BASE_PACKET_SIZE}`);
+            this.canProbe = false;
+            this.probeSize = 0;
+            this.packetSize = BASE_PACKET_SIZE;
+            return;
+        }
+        if (this.probeSize !== 0 && this.probeAttempts >= MAX_PROBES) {
+            this.probeCeiling = this.probeSize;
+            this.probeSize = 0;
+        }
+        if (this.probeSize === 0) {
+            this.probeSize = this.nextProbeSize();
+            this.probeAttempts = 0;
+        }
+        if (this.probeSize === 0) {
+            // Nothing left to try; the path may carry more by the next search
+            this.probeCeiling = Infinity;
+            this.probeTimeout = setTimeout(() => this.probeMtu(), MTU_RAISE_INTERVAL_MS);
+            return;
+        }
+        const probe = new Uint8Array(this.probeSize);
+        probe.set(this.encodeHeader(FLAG_PING, this.probeSize));
+        this.probeAttempts++;
+        this.socket.send(probe, this.remote.port, this.remote.address).catch(() => { });
+        this.probeTimeout = setTimeout(() => this.probeMtu(), this.rto);
+    }
+
+    private onProbeAck(size: number) {
+        if (size === 0 || size !== this.probeSize) return;
+        console.debug(`[ReUDP:${this.tag}] Path takes ${size}-byte packets`);
+        this.packetSize = size;
+        this.probeSize = 0;
+        rememberPathMtu(this.remote.address, this.packetSize);
+        this.probeMtu();
+    }
+
+    // Back to the base size, and look again below the one that stopped getting through
+    private onBlackHole(size: number) {
+        console.warn(`[ReUDP:${this.tag}] ${size}-byte packets stopped getting through, back to ${BASE_PACKET_SIZE}`);
+        this.packetSize = BASE_PACKET_SIZE;
+        this.probeCeiling = size;
+        this.probeSize = 0;
+        rememberPathMtu(this.remote.address, this.packetSize);
+        if (this.isMtuSearchStarted) this.probeMtu();
+    }
+
+    /**
+     * Hands RPC frame encryption for one direction to the native session.
+     * False when there is none; the caller then encrypts in JS.
+     */
+    setFrameCipher(direction: 'send' | 'recv', secretKey: string, iv: string): boolean {
+        if (!this.native?.setFrameCipher) return false;
+        this.native.setFrameCipher(direction, secretKey, iv);
+        return true;
+    }
+
     private warnedSendAfterClose = false;
 
-    async send(data: Uint8Array) {
+    /** Queue data for in-order delivery on its lane. Media sends get FEC once the peer speaks v3. */
+    async send(data: Uint8Array, options?: DataSendOptions) {
         if (this.isClosing) {
             if (!this.warnedSendAfterClose) {
                 this.warnedSendAfterClose = true;
@@ -290,23 +612,55 @@ export class ReDatagram {
             console.warn(`[ReUDP:${this.tag}] Attempting to send empty data`);
             return;
         }
+        if (this.native) {
+            this.bytesSent += data.length;
+            return this.native.send(data, options);
+        }
 
-        const task = this.sendQueue.then(() => this.sendData(data));
-        this.sendQueue = task.catch((e) => {
+        const lane = this.laneFor(options?.lane ?? DataLane.Control);
+        const isMedia = options?.lane === DataLane.Media;
+        this.laneBytes[lane] += data.length;
+        const task = this.sendQueues[lane].then(() => this.sendData(data, lane, isMedia));
+        this.sendQueues[lane] = task.catch((e) => {
             console.warn(`[ReUDP:${this.tag}] Send failed in queue:`, e?.message || e);
         });
         await task;
     }
 
-    private async sendData(data: Uint8Array) {
-        let offset = 0;
-        while (offset < data.length) {
-            const chunkSize = Math.min(MAX_PACKET_PAYLOAD, data.length - offset);
-            const chunk = data.slice(offset, offset + chunkSize);
+    /**
+     * Lane that data sent now travels on, and is delivered on: `lane` once
+     * the peer speaks v4, control until then. Not tracked for native
+     * sessions, which take over the frame cipher (the reason to ask) anyway.
+     */
+    laneFor(lane: DataLane): DataLane {
+        return this.wireVersion() >= 4 && lane < LANE_COUNT ? lane : DataLane.Control;
+    }
 
-            await this.sendPacket(chunk);
-            offset += chunkSize;
+    private async sendData(data: Uint8Array, lane: DataLane, isMedia: boolean) {
+        let offset = 0;
+        try {
+            while (offset < data.length) {
+                // Wait before sizing the chunk: the wire format may change meanwhile
+                await this.waitForWindowSpace(lane);
+                if (this.isClosing) return;
+                const isFec = isMedia && this.wireVersion() >= 3;
+                // Parity packets carry the lane fields on top of each payload, so media leaves room for them
+                const maxPayload = isFec ? this.packetSize - PARITY_LANE_HEADER_SIZE - LANE_FIELDS_SIZE : this.packetSize - this.dataHeaderSize();
+                const chunkSize = Math.min(maxPayload, data.length - offset);
+                const chunk = data.slice(offset, offset + chunkSize);
+                offset += chunkSize;
+                this.laneBytes[lane] -= chunkSize;
+                this.sendPacket(chunk, lane, isFec);
+            }
+        } finally {
+            this.laneBytes[lane] -= data.length - offset;
         }
+        // Close the group with the message, so its tail doesn't wait for the next one
+        if (isMedia && this.fecGroup && !this.isClosing) this.sendParity();
+    }
+
+    private dataHeaderSize() {
+        return this.wireVersion() >= 4 ? DATA_LANE_HEADER_SIZE : this.wireVersion() >= 2 ? DATA_V2_HEADER_SIZE : HEADER_SIZE;
     }
 
     private effectiveWindow() {
@@ -317,12 +671,46 @@ export class ReDatagram {
     private windowWaitMs = 0;
     private windowWaitCount = 0;
 
-    private async waitForWindowSpace() {
-        if (this.sendWindow.size < this.effectiveWindow()) return;
+    // Weighted fair queueing between the lanes with data queued that the
+    // window lets through: the one whose next packet starts earliest in
+    // virtual time, control first on ties. -1: nothing may go.
+    //
+    // Bulk counts every packet since the first unACKed one, as all DATA did
+    // before lanes. Control and media count only what is still in the network
+    // (not SACKed), so a hole in a bulk transfer waiting for its retransmit
+    // doesn't hold them back, and a trickle of control may overrun even that,
+    // so an input event never waits for ACKs. Nothing goes while the socket's
+    // native send queue, when it has one, is full.
+    private nextLane(): number {
+        const inFlight = this.sendWindow.size;
+        if (inFlight >= MAX_SEND_WINDOW || (this.socket.sendCredits?.() ?? 1) <= 0) return -1;
+        const window = this.effectiveWindow();
+        const pipe = inFlight - this.sackedInFlight;
+        let best = -1;
+        let bestStart = 0;
+        for (let lane = 0; lane < LANE_COUNT; lane++) {
+            if (this.laneBytes[lane] === 0) continue;
+            const fits = lane === DataLane.Bulk
+                ? inFlight < window
+                : pipe < window || (lane === DataLane.Control && this.controlInFlight < CONTROL_HEADROOM);
+            if (!fits) continue;
+            const start = Math.max(this.virtualTime, this.laneFinish[lane]);
+            if (best < 0 || start < bestStart) {
+                best = lane;
+                bestStart = start;
+            }
+        }
+        return best;
+    }
+
+    private async waitForWindowSpace(lane: DataLane) {
+        if (this.nextLane() === lane) return;
         const t0 = Date.now();
-        while (this.sendWindow.size >= this.effectiveWindow() && !this.isClosing) {
+        while (this.nextLane() !== lane && !this.isClosing) {
+            // The lane whose turn it is may be waiting too
+            this.wakeWindowWaiters();
             await new Promise<void>(resolve => {
-                this.windowWaiters.push(resolve);
+                this.windowWaiters[lane] = resolve;
             });
         }
         this.windowWaitMs += Date.now() - t0;
@@ -330,8 +718,10 @@ export class ReDatagram {
     }
 
     private wakeWindowWaiters() {
-        if (this.windowWaiters.length > 0 && this.sendWindow.size < this.effectiveWindow()) {
-            const waiter = this.windowWaiters.shift()!;
+        const lane = this.nextLane();
+        const waiter = lane >= 0 ? this.windowWaiters[lane] : null;
+        if (waiter) {
+            this.windowWaiters[lane] = null;
             waiter();
         }
     }
@@ -354,28 +744,32 @@ export class ReDatagram {
         this.recoveryUntil = Date.now() + Math.max(this.rto, 1000);
     }
 
-    private async sendPacket(data: Uint8Array) {
-        if (this.isClosing) return;
-        if (data.length > MAX_PACKET_PAYLOAD) {
-            throw new Error(`Packet payload too large: ${data.length} > ${MAX_PACKET_PAYLOAD}`);
-        }
-
-        // Flow control: wait if send window is full
-        await this.waitForWindowSpace();
-        if (this.isClosing) return;
-
+    private sendPacket(data: Uint8Array, lane: DataLane, isFec: boolean) {
         const seq = this.sendSeq;
         this.sendSeq = this.sendSeq + 1;
-
-        const header = this.encodeHeader(FLAG_DATA, seq);
+        const laneSeq = this.laneNextSeq[lane]++;
+        this.virtualTime = Math.max(this.virtualTime, this.laneFinish[lane]);
+        this.laneFinish[lane] = this.virtualTime + 1 / LANE_WEIGHTS[lane];
+
+        let header: Uint8Array;
+        const hasLanes = this.wireVersion() >= 4;
+        if (hasLanes) {
+            header = new Uint8Array([FLAG_DATA_LANE, (seq >>> 8) & 0xFF, seq & 0xFF, lane, (laneSeq >>> 8) & 0xFF, laneSeq & 0xFF]);
+        } else if (this.wireVersion() >= 2) {
+            header = new Uint8Array([FLAG_DATA_V2, (seq >>> 8) & 0xFF, seq & 0xFF]);
+        } else {
+            header = this.encodeHeader(FLAG_DATA, seq);
+        }
         const packet = new Uint8Array(header.length + data.length);
         packet.set(header);
         packet.set(data, header.length);
 
         // Track in window before sending — retransmit scan handles failures
-        this.sendWindow.set(seq, { packet, sentAt: Date.now(), attempts: 1, sacked: false });
+        this.sendWindow.set(seq, { packet, lane, sentAt: Date.now(), attempts: 1, sacked: false, lost: false });
+        if (lane === DataLane.Control) this.controlInFlight++;
 
         this.bytesSent += data.length;
+        this.packetsSent++;
         this.lastDataActivity = Date.now();
 
         // Fire-and-forget: don't await socket.send to allow burst sending.
@@ -385,17 +779,89 @@ export class ReDatagram {
                 console.error(`[ReUDP:${this.tag}] Failed to send packet seq=${seq}:`, error);
             }
         });
+
+        if (isFec) {
+            // Parity covers everything after the seq: lane fields too, when there are any
+            const group = this.fecGroup;
+            if (group && (seq - group.first >= FEC_MAX_SPAN || group.isLaneGroup !== hasLanes)) this.sendParity();
+            this.addToFecGroup(seq, packet.subarray(DATA_V2_HEADER_SIZE), hasLanes);
+            if (this.fecGroup!.count >= this.fecGroupSize()) this.sendParity();
+        }
+        // Another lane's turn may have come
+        this.wakeWindowWaiters();
+    }
+
+    // Fewer packets per parity the more get lost, so one loss per group stays the norm
+    private fecGroupSize() {
+        if (this.lossRate <= 0) return FEC_MAX_GROUP;
+        return Math.min(FEC_MAX_GROUP, Math.max(FEC_MIN_GROUP, Math.floor(FEC_LOSSES_PER_GROUP / this.lossRate)));
+    }
+
+    private addToFecGroup(seq: number, body: Uint8Array, isLaneGroup: boolean) {
+        if (!this.fecGroup) {
+            this.fecGroup = { first: seq, count: 0, maskHi: 0, maskLo: 0, isLaneGroup, length: 0, lengthXor: 0, parity: new Uint8Array(MAX_PARITY_BODY) };
+        }
+        const group = this.fecGroup;
+        for (let i = 0; i < body.length; i++) group.parity[i] ^= body[i];
+        group.length = Math.max(group.length, body.length);
+        group.lengthXor ^= body.length;
+        const bit = seq - group.first;
+        if (bit < 32) group.maskLo |= 1 << bit;
+        else group.maskHi |= 1 << (bit - 32);
+        group.count++;
+    }
+
+    // Parity isn't tracked in the window or retransmitted; a lost one just costs the retransmit it would have saved
+    private sendParity() {
+        const group = this.fecGroup!;
+        this.fecGroup = null;
+        const headerSize = group.isLaneGroup ? PARITY_LANE_HEADER_SIZE : PARITY_HEADER_SIZE;
+        const pkt = new Uint8Array(headerSize + group.length);
+        const view = new DataView(pkt.buffer);
+        view.setUint32(1, group.first, false);
+        if (group.isLaneGroup) {
+            pkt[0] = FLAG_PARITY_LANE;
+            view.setUint32(5, group.maskHi >>> 0, false);
+            view.setUint32(9, group.maskLo >>> 0, false);
+        } else {
+            pkt[0] = FLAG_PARITY;
+            pkt[5] = group.count;
+        }
+        view.setUint16(headerSize - 2, group.lengthXor, false);
+        pkt.set(group.parity.subarray(0, group.length), headerSize);
+        this.paritySent++;
+        this.socket.send(pkt, this.remote.port, this.remote.address).catch(() => { });
+    }
+
+    // A DATA packet first seen missing, by a SACK hole or its retransmit timer
+    private noteLoss(entry: { lost: boolean }) {
+        if (entry.lost) return;
+        entry.lost = true;
+        this.lostPackets++;
+    }
+
+    private updateLossRate() {
+        const sent = this.packetsSent - this.lossSampleSent;
+        if (sent < FEC_LOSS_SAMPLE) return;
+        const sample = Math.min(1, (this.lostPackets - this.lossSampleLost) / sent);
+        this.lossRate = 0.875 * this.lossRate + 0.125 * sample;
+        this.lossSampleSent = this.packetsSent;
+        this.lossSampleLost = this.lostPackets;
     }
 
     // Retransmit logic is handled by startRetransmitLoop() periodic scan
 
-    private reorderBuffer = new Map<number, Uint8Array>();
+    // Receiving: packets past recvSeq (delivered or not) for SACK and FEC,
+    // and per lane the next lane seq to deliver and those that wait for it
+    private received = new Map<number, ReceivedPacket>();
+    private laneNext: number[] = new Array(LANE_COUNT).fill(1);
+    private laneWaiting: Map<number, number>[] = Array.from({ length: LANE_COUNT }, () => new Map()); // lane seq → seq
 
     private ackDelayTimeout: number | null = null;
 
     // Batched delivery: collect payloads during one event-loop tick,
-    // then flush them all in a single onMessage call.
-    private pendingPayloads: Uint8Array[] = [];
+    // then flush them all in a single onMessage call per lane.
+    private pendingPayloads: Uint8Array[][] = Array.from({ length: LANE_COUNT }, () => []);
     private flushScheduled = false;
     private sackScheduled = false;
 
@@ -408,108 +874,203 @@ export class ReDatagram {
         this.ackDelayTimeout = null;
     }
 
+    // Control first, so an input event doesn't queue behind a file chunk's handler
     private flushPendingPayloads() {
         this.flushScheduled = false;
-        if (this.isClosing || this.pendingPayloads.length === 0) return;
-
-        const payloads = this.pendingPayloads;
-        this.pendingPayloads = [];
+        for (let lane = 0; lane < LANE_COUNT && !this.isClosing; lane++) {
+            const payloads = this.pendingPayloads[lane];
+            if (payloads.length === 0) continue;
+            this.pendingPayloads[lane] = [];
 
-        try {
-            if (payloads.length === 1) {
-                // Fast path: single payload, no concatenation needed
-                this.onMessage?.(payloads[0]);
-            } else {
-                // Merge all payloads into one buffer so DataChannelParser.feed()
-                // does a single pass instead of N separate feed() calls.
-                let totalLength = 0;
-                for (const p of payloads) totalLength += p.length;
-                const merged = new Uint8Array(totalLength);
-                let offset = 0;
-                for (const p of payloads) {
-                    merged.set(p, offset);
-                    offset += p.length;
+            try {
+                if (payloads.length === 1) {
+                    // Fast path: single payload, no concatenation needed
+                    this.onMessage?.(payloads[0], lane);
+                } else {
+                    // Merge all payloads into one buffer so DataChannelParser.feed()
+                    // does a single pass instead of N separate feed() calls.
+                    let totalLength = 0;
+                    for (const p of payloads) totalLength += p.length;
+                    const merged = new Uint8Array(totalLength);
+                    let offset = 0;
+                    for (const p of payloads) {
+                        merged.set(p, offset);
+                        offset += p.length;
+                    }
+                    this.onMessage?.(merged, lane);
                 }
-                this.onMessage?.(merged);
+            } catch (error) {
+                console.error(`[ReUDP:${this.tag}] Error in onMessage handler:`, error);
             }
-        } catch (error) {
-            console.error(`[ReUDP:${this.tag}] Error in onMessage handler:`, error);
         }
     }
 
-    private handleDataPacket(seq: number, payload: Uint8Array, alreadyCopied = false) {
+    private handleDataPacket(seq: number, lane: DataLane, laneSeq: number, payload: Uint8Array, alreadyCopied = false) {
         if (seq < 1 || seq > 0xFFFFFFFF) {
             console.warn(`[ReUDP:${this.tag}] Invalid sequence number: ${seq}`);
             return;
         }
+        // Old/duplicate packet: our ACK for it was lost, re-ACK so the sender stops retransmitting
+        if (seq < this.recvSeq || this.received.has(seq)) {
+            this.scheduleSackAck();
+            return;
+        }
+        if (laneSeq < this.laneNext[lane] || (seq > this.recvSeq && this.received.size >= MAX_BUFFERED_PACKETS)) return;
+        this.bytesReceived += payload.length;
+        // Copy the payload: it's a view into the UDP recv buffer. Rebuilt
+        // ones are already standalone copies.
+        const packet: ReceivedPacket = { lane, laneSeq, payload: alreadyCopied ? payload : payload.slice() };
+
+        // In order on its lane: deliverable now, whatever other lanes are missing
+        const isDeliverable = laneSeq === this.laneNext[lane];
+        if (isDeliverable) this.deliver(lane, packet.payload);
+        if (seq === this.recvSeq && isDeliverable) {
+            this.rememberDelivered(seq, packet);
+        } else {
+            this.received.set(seq, packet);
+            if (!isDeliverable) this.laneWaiting[lane].set(laneSeq, seq);
+        }
+        if (isDeliverable) this.deliverWaiting(lane);
 
-        if (seq === this.recvSeq) {
-            this.recvSeq = this.recvSeq + 1;
-            this.ackPending++;
-            this.bytesReceived += payload.length;
-
-            // ACK immediately, then defer data processing to the next tick.
-            // This lets the event loop drain the kernel UDP recv buffer and
-            // send ACKs for the entire incoming batch before onMessage
-            // handlers (disk writes, crypto, etc.) block the thread.
-            if (this.ackPending >= ACK_BATCH_SIZE) {
-                this.sendAck(this.recvSeq - 1);
-                this.ackPending = 0;
-                if (this.ackDelayTimeout) {
-                    clearTimeout(this.ackDelayTimeout);
-                    this.ackDelayTimeout = null;
-                }
-            } else if (!this.ackDelayTimeout) {
-                this.ackDelayTimeout = setTimeout(() => this.sendPendingAcks(), MAX_ACK_DELAY_MS);
-            }
-
-            // Batch data delivery: copy the payload (it's a view into the
-            // UDP recv buffer) and schedule a single flush for the next tick.
-            // All packets received in this event-loop pass are coalesced into
-            // one onMessage call, reducing timer + feed() overhead.
-            // Payloads from reorderBuffer are already standalone copies.
-            this.pendingPayloads.push(alreadyCopied ? payload : payload.slice());
-            if (!this.flushScheduled) {
-                this.flushScheduled = true;
-                setTimeout(() => this.flushPendingPayloads(), 0);
-            }
-
-            // Drain contiguous buffered packets (already copied when buffered)
-            while (this.reorderBuffer.has(this.recvSeq)) {
-                const nextPayload = this.reorderBuffer.get(this.recvSeq)!;
-                this.reorderBuffer.delete(this.recvSeq);
-                this.recvSeq++;
-                this.ackPending++;
-                this.bytesReceived += nextPayload.length;
-                this.pendingPayloads.push(nextPayload); // already copied
-
-                if (this.ackPending >= ACK_BATCH_SIZE) {
-                    this.sendAck(this.recvSeq - 1);
-                    this.ackPending = 0;
-                    if (this.ackDelayTimeout) {
-                        clearTimeout(this.ackDelayTimeout);
-                        this.ackDelayTimeout = null;
-                    }
-                }
+        if (seq !== this.recvSeq) {
+            this.scheduleSackAck();
+            return;
+        }
+        // Advance the ACK point over everything now contiguous; a lane seq
+        // follows the seq order, so all of it has been delivered already
+        this.recvSeq++;
+        this.onInOrder();
+        while (this.received.has(this.recvSeq)) {
+            this.rememberDelivered(this.recvSeq, this.received.get(this.recvSeq)!);
+            this.received.delete(this.recvSeq);
+            this.recvSeq++;
+            this.onInOrder();
+        }
+    }
+
+    // Batch data delivery: schedule a single flush for the next tick. All
+    // packets received in this event-loop pass are coalesced into one
+    // onMessage call per lane, reducing timer + feed() overhead.
+    private deliver(lane: DataLane, payload: Uint8Array) {
+        this.pendingPayloads[lane].push(payload);
+        this.laneNext[lane]++;
+        if (!this.flushScheduled) {
+            this.flushScheduled = true;
+            setTimeout(() => this.flushPendingPayloads(), 0);
+        }
+    }
+
+    // Deliver the packets of `lane` that were waiting for the one just delivered
+    private deliverWaiting(lane: DataLane) {
+        const waiting = this.laneWaiting[lane];
+        let seq: number | undefined;
+        while ((seq = waiting.get(this.laneNext[lane])) !== undefined) {
+            waiting.delete(this.laneNext[lane]);
+            const packet = this.received.get(seq);
+            if (!packet) break;
+            this.deliver(lane, packet.payload);
+        }
+    }
+
+    // One more packet under the cumulative ACK. ACK immediately, then defer
+    // data processing to the next tick: this lets the event loop drain the
+    // kernel UDP recv buffer and send ACKs for the entire incoming batch
+    // before onMessage handlers (disk writes, crypto, etc.) block the thread.
+    private onInOrder() {
+        this.ackPending++;
+        if (this.ackPending >= ACK_BATCH_SIZE) {
+            this.sendAck(this.recvSeq - 1);
+            this.ackPending = 0;
+            if (this.ackDelayTimeout) {
+                clearTimeout(this.ackDelayTimeout);
+                this.ackDelayTimeout = null;
+            }
+        } else if (!this.ackDelayTimeout) {
+            this.ackDelayTimeout = setTimeout(() => this.sendPendingAcks(), MAX_ACK_DELAY_MS);
+        }
+    }
+
+    private rememberDelivered(seq: number, packet: ReceivedPacket) {
+        if (!this.fecHistory) return;
+        this.fecHistory.set(seq, packet);
+        this.fecHistory.delete(seq - FEC_HISTORY);
+    }
+
+    // Rebuild the one packet of a parity group that hasn't arrived, if only one
+    private handleParity(buf: Uint8Array) {
+        const isLaneGroup = buf[0] === FLAG_PARITY_LANE;
+        const headerSize = isLaneGroup ? PARITY_LANE_HEADER_SIZE : PARITY_HEADER_SIZE;
+        if (buf.length < headerSize) return;
+        // From now on keep delivered payloads: the next group may need them
+        if (!this.fecHistory) this.fecHistory = new Map();
+        const view = new DataView(buf.buffer, buf.byteOffset, buf.length);
+        const first = view.getUint32(1, false);
+        // Seqs in the group, as offsets from the first
+        const members: number[] = [];
+        if (isLaneGroup) {
+            const maskHi = view.getUint32(5, false);
+            const maskLo = view.getUint32(9, false);
+            for (let i = 0; i < FEC_MAX_SPAN; i++) {
+                if (((i < 32 ? maskLo >>> i : maskHi >>> (i - 32)) & 1) !== 0) members.push(i);
+            }
+        } else if (buf[5] <= FEC_MAX_GROUP) {
+            for (let i = 0; i < buf[5]; i++) members.push(i);
+        }
+        if (first === 0 || members.length === 0 || first + members[members.length - 1] < this.recvSeq) return;
+
+        let missing = 0;
+        const have: ReceivedPacket[] = [];
+        for (const i of members) {
+            const s = first + i;
+            const packet = s < this.recvSeq ? this.fecHistory.get(s) : this.received.get(s);
+            if (packet) {
+                have.push(packet);
+            } else if (s < this.recvSeq || missing !== 0) {
+                return; // delivered before we kept payloads, or two or more lost: retransmits fill them in
+            } else {
+                missing = s;
             }
         }
-        // Future packet: buffer it and schedule SACK ACK
-        else if (this.recvSeq < seq && this.reorderBuffer.size < MAX_BUFFERED_PACKETS) {
-            this.reorderBuffer.set(seq, alreadyCopied ? payload : payload.slice());
-            // Batch SACK ACKs: schedule one per event-loop tick instead of one per packet
-            if (!this.sackScheduled) {
-                this.sackScheduled = true;
-                setTimeout(() => {
-                    this.sackScheduled = false;
-                    if (!this.isClosing) this.sendAck(this.recvSeq - 1);
-                }, 0);
+        if (missing === 0) return;
+
+        const fieldsSize = isLaneGroup ? LANE_FIELDS_SIZE : 0;
+        const rebuilt = buf.slice(headerSize);
+        let length = view.getUint16(headerSize - 2, false);
+        for (const packet of have) {
+            if (fieldsSize + packet.payload.length > rebuilt.length) return;
+            if (isLaneGroup) {
+                rebuilt[0] ^= packet.lane;
+                rebuilt[1] ^= (packet.laneSeq >>> 8) & 0xFF;
+                rebuilt[2] ^= packet.laneSeq & 0xFF;
             }
-        } // else: old/duplicate packet, ignore
+            for (let i = 0; i < packet.payload.length; i++) rebuilt[fieldsSize + i] ^= packet.payload[i];
+            length ^= fieldsSize + packet.payload.length;
+        }
+        if (length > rebuilt.length || length < fieldsSize) return;
+        this.fecRecovered++;
+        if (!isLaneGroup) {
+            this.handleDataPacket(missing, DataLane.Control, missing, rebuilt.subarray(0, length), true);
+            return;
+        }
+        const lane = rebuilt[0];
+        if (lane >= LANE_COUNT) return;
+        const laneSeq = expandSeq((rebuilt[1] << 8) | rebuilt[2], this.laneNext[lane]);
+        this.handleDataPacket(missing, lane, laneSeq, rebuilt.subarray(LANE_FIELDS_SIZE, length), true);
+    }
+
+    // Batch SACK ACKs: schedule one per event-loop tick instead of one per packet
+    private scheduleSackAck() {
+        if (this.sackScheduled) return;
+        this.sackScheduled = true;
+        setTimeout(() => {
+            this.sackScheduled = false;
+            if (!this.isClosing) this.sendAck(this.recvSeq - 1);
+        }, 0);
     }
 
     private sendBase = 1; // first un-ACKed sequence
 
-    private handlePacket(buf: Uint8Array) {
+    private handlePacket(buf: Uint8Array, receivedAt?: number) {
         if (this.isClosing) return;
         try {
             if (buf.length === 0) {
@@ -522,14 +1083,40 @@ export class ReDatagram {
             //     return;
             // }
 
+            // v2 and lane DATA have their own short headers, checked before the v1 decode
+            if (buf[0] === FLAG_DATA_V2 && buf.length >= DATA_V2_HEADER_SIZE) {
+                this.markReady();
+                this.peerVersion = Math.max(this.peerVersion, 2);
+                const payload = new Uint8Array(buf.buffer, buf.byteOffset + DATA_V2_HEADER_SIZE, buf.length - DATA_V2_HEADER_SIZE);
+                const seq = expandSeq((buf[1] << 8) | buf[2], this.recvSeq);
+                this.handleDataPacket(seq, DataLane.Control, seq, payload);
+                return;
+            }
+            if (buf[0] === FLAG_DATA_LANE && buf.length >= DATA_LANE_HEADER_SIZE) {
+                this.markReady();
+                this.peerVersion = Math.max(this.peerVersion, 4);
+                const lane = buf[3];
+                if (lane >= LANE_COUNT) return;
+                const payload = new Uint8Array(buf.buffer, buf.byteOffset + DATA_LANE_HEADER_SIZE, buf.length - DATA_LANE_HEADER_SIZE);
+                const seq = expandSeq((buf[1] << 8) | buf[2], this.recvSeq);
+                this.handleDataPacket(seq, lane, expandSeq((buf[4] << 8) | buf[5], this.laneNext[lane]), payload);
+                return;
+            }
+
             const { type, seq } = this.decodeHeader(buf);
             this.markReady();
             if (type === FLAG_DATA) {
                 const payload = new Uint8Array(buf.buffer, buf.byteOffset + HEADER_SIZE, buf.length - HEADER_SIZE);
-                this.handleDataPacket(seq, payload);
+                this.handleDataPacket(seq, DataLane.Control, seq, payload);
             }
-            else if (type === FLAG_ACK) {
+            else if (type === FLAG_PARITY || type === FLAG_PARITY_LANE) {
+                this.handleParity(buf);
+            }
+            else if (type === FLAG_ACK || type === FLAG_ACK_V2) {
                 const now = Date.now();
+                // Measured from the kernel's receive time when known, so time
+                // the ACK waited for the event loop isn't counted as network RTT
+                const ackAt = receivedAt || now;
                 const nextAck = seq + 1;
                 // RTT measurement: use only the highest-seq first-attempt packet
                 // in this ACK range (Karn's algorithm). Measuring all packets
@@ -542,7 +1129,7 @@ export class ReDatagram {
                     for (let s = nextAck - 1; s >= this.sendBase; s--) {
                         const entry = this.sendWindow.get(s);
                         if (entry && entry.attempts === 1) {
-                            this.updateRTT(now - entry.sentAt);
+                            this.updateRTT(Math.max(0, ackAt - entry.sentAt));
                             break; // one sample per ACK
                         }
                     }
@@ -550,6 +1137,9 @@ export class ReDatagram {
                 // Remove all cached packets from sendBase up to nextAck
                 const ackedCount = nextAck - this.sendBase;
                 while (this.sendBase < nextAck) {
+                    const entry = this.sendWindow.get(this.sendBase);
+                    if (entry?.sacked) this.sackedInFlight--;
+                    else if (entry?.lane === DataLane.Control) this.controlInFlight--;
                     this.sendWindow.delete(this.sendBase);
                     this.sendBase++;
                 }
@@ -582,8 +1172,23 @@ export class ReDatagram {
                         }
                     }
                 }
+                if (type === FLAG_ACK_V2) {
+                    // Bitmap of what arrived past the hole at seq + 1
+                    let highestSacked = 0;
+                    for (let i = 0; i < buf.length - HEADER_SIZE && i < ACK_BITMAP_BYTES; i++) {
+                        const bits = buf[HEADER_SIZE + i];
+                        for (let b = 0; bits && b < 8; b++) {
+                            if (!(bits & (1 << b))) continue;
+                            const s = seq + 2 + i * 8 + b;
+                            const e = this.sendWindow.get(s);
+                            if (e) this.markSacked(e);
+                            highestSacked = s;
+                        }
+                    }
+                    if (highestSacked > this.sendBase && !this.fastRetransmitBelow(highestSacked, now)) return;
+                }
                 // Parse SACK blocks if present (beyond the 5-byte header)
-                if (buf.length > HEADER_SIZE) {
+                else if (buf.length > HEADER_SIZE) {
                     const sackCount = Math.min(buf[HEADER_SIZE], MAX_SACK_BLOCKS);
                     const sackView = new DataView(buf.buffer, buf.byteOffset);
                     let firstSackStart = 0;
@@ -594,29 +1199,11 @@ export class ReDatagram {
                         // Mark SACKed entries — receiver already has these
                         for (let s = sackStart; s <= sackEnd && s - sackStart < MAX_SEND_WINDOW; s++) {
                             const e = this.sendWindow.get(s);
-                            if (e) e.sacked = true;
+                            if (e) this.markSacked(e);
                         }
                     }
                     // Fast retransmit: resend gap packets between cumulative ACK and first SACK block
-                    if (sackCount > 0 && firstSackStart > this.sendBase) {
-                        let fastRetx = 0;
-                        for (let s = this.sendBase; s < firstSackStart && fastRetx < MAX_RETRANSMITS_PER_SCAN; s++) {
-                            const gapEntry = this.sendWindow.get(s);
-                            if (gapEntry && !gapEntry.sacked && now - gapEntry.sentAt >= MIN_RTO) {
-                                if (gapEntry.attempts >= this.profile.maxRetransmits) {
-                                    console.error(`[ReUDP:${this.tag}] Max retransmits (fast) for seq=${s}, closing`);
-                                    this.close();
-                                    return;
-                                }
-                                this.onCongestionEvent(); // shrink cwnd on SACK-driven loss
-                                gapEntry.attempts++;
-                                gapEntry.sentAt = now;
-                                this.retransmitCount++;
-                                fastRetx++;
-                                this.socket.send(gapEntry.packet, this.remote.port, this.remote.address).catch(() => { });
-                            }
-                        }
-                    }
+                    if (sackCount > 0 && firstSackStart > this.sendBase && !this.fastRetransmitBelow(firstSackStart, now)) return;
                 }
                 // ACK proves peer is alive
                 this.lastPingReceived = now;
@@ -626,23 +1213,41 @@ export class ReDatagram {
             else if (type === FLAG_HELLO) {
                 console.debug(`[ReUDP:${this.tag}] Received HELLO, sending HELLO_ACK`);
                 this.lastPingReceived = Date.now();
-                const header = this.encodeHeader(FLAG_HELLO_ACK, 0);
+                this.onPeerVersion(buf);
+                const header = this.encodeHandshake(FLAG_HELLO_ACK);
                 this.socket.send(header, this.remote.port, this.remote.address).catch(() => { });
+                this.startMtuSearch();
             }
             else if (type === FLAG_HELLO_ACK) {
                 console.debug(`[ReUDP:${this.tag}] Received HELLO_ACK`);
                 this.lastPingReceived = Date.now();
+                this.onPeerVersion(buf);
                 // this.markReady();
+                this.startMtuSearch();
             }
             else if (type === FLAG_PING) {
                 // console.log(`[ReUDP:${this.tag}] Received PING, sending PING back`);
                 this.lastPingReceived = Date.now();
+                // A probe, if padded to the size in its seq; a truncated one isn't confirmed
+                if (buf.length > HEADER_SIZE && seq === buf.length) {
+                    const header = this.encodeHeader(FLAG_PROBE_ACK, seq);
+                    this.socket.send(header, this.remote.port, this.remote.address).catch(() => { });
+                }
+            }
+            else if (type === FLAG_PROBE_ACK) {
+                this.onProbeAck(seq);
+            }
+            else if (type === FLAG_FRAGMENT) {
+                this.handleFragment(seq, buf);
             }
             else if (type === FLAG_BYE) {
                 console.log(`[ReUDP:${this.tag}] Received BYE from remote, closing connection.`);
                 this.isRemoteClosed = true;
                 this.close();
             }
+            else if (type === FLAG_COOKIE) {
+                this.onCookie(seq);
+            }
             else {
                 console.warn(`[ReUDP:${this.tag}] Unknown packet type: ${type}`);
             }
@@ -653,6 +1258,107 @@ export class ReDatagram {
         }
     }
 
+    // The receiver has it: out of the network, though still in the window
+    private markSacked(entry: { lane: DataLane; sacked: boolean }) {
+        if (entry.sacked) return;
+        entry.sacked = true;
+        this.sackedInFlight++;
+        if (entry.lane === DataLane.Control) this.controlInFlight--;
+    }
+
+    /**
+     * Fast retransmit: resend un-SACKed gap packets below `limit`; all of them count as lost.
+     * Returns false if the connection was closed (max retransmits).
+     */
+    private fastRetransmitBelow(limit: number, now: number): boolean {
+        let fastRetx = 0;
+        for (let s = this.sendBase; s < limit && fastRetx < MAX_RETRANSMITS_PER_SCAN; s++) {
+            const gapEntry = this.sendWindow.get(s);
+            if (gapEntry && !gapEntry.sacked) this.noteLoss(gapEntry);
+            if (gapEntry && !gapEntry.sacked && now - gapEntry.sentAt >= MIN_RTO) {
+                if (gapEntry.attempts >= this.profile.maxRetransmits) {
+                    console.error(`[ReUDP:${this.tag}] Max retransmits (fast) for seq=${s}, closing`);
+                    this.close();
+                    return false;
+                }
+                this.onCongestionEvent(); // shrink cwnd on SACK-driven loss
+                fastRetx++;
+                this.retransmit(s, gapEntry, now);
+            }
+        }
+        return true;
+    }
+
+    private retransmit(seq: number, entry: { packet: Uint8Array; sentAt: number; attempts: number }, now: number) {
+        // Lost again and again at a size probing found: suspect the path, not the network
+        const size = entry.packet.length;
+        if (entry.attempts >= BLACK_HOLE_ATTEMPTS && size > BASE_PACKET_SIZE && size <= this.packetSize) {
+            this.onBlackHole(size);
+        }
+        this.retransmitCount++;
+        entry.attempts++;
+        entry.sentAt = now;
+        if (size > this.packetSize) {
+            this.sendFragments(seq, entry.packet);
+        } else {
+            this.socket.send(entry.packet, this.remote.port, this.remote.address).catch(() => { });
+        }
+    }
+
+    // A DATA packet sent before the packet size came down, in pieces that fit.
+    // Always cut at the base size: the peer may hold pieces of an earlier
+    // resend, and pieces cut at another size would splice into garbage
+    private sendFragments(seq: number, packet: Uint8Array) {
+        const pieceSize = BASE_PACKET_SIZE - FRAGMENT_HEADER_SIZE;
+        const count = Math.ceil(packet.length / pieceSize);
+        for (let i = 0; i < count; i++) {
+            const piece = packet.subarray(i * pieceSize, (i + 1) * pieceSize);
+            const fragment = new Uint8Array(FRAGMENT_HEADER_SIZE + piece.length);
+            const view = new DataView(fragment.buffer);
+            view.setUint8(0, FLAG_FRAGMENT);
+            view.setUint32(1, seq);
+            view.setUint8(5, i);
+            view.setUint8(6, count);
+            fragment.set(piece, FRAGMENT_HEADER_SIZE);
+            this.socket.send(fragment, this.remote.port, this.remote.address).catch(() => { });
+        }
+    }
+
+    // Put a DATA packet retransmitted in pieces back together, then take it
+    // as if it had come whole
+    private handleFragment(seq: number, buf: Uint8Array) {
+        const index = buf[5], count = buf[6];
+        if (buf.length <= FRAGMENT_HEADER_SIZE || count < 2 || count > MAX_FRAGMENTS || index >= count) return;
+        // Whatever is under the ACK point got here some other way
+        for (const pending of this.reassembly.keys()) {
+            if (pending < this.recvSeq) this.reassembly.delete(pending);
+        }
+        if (seq < this.recvSeq || this.received.has(seq)) {
+            this.scheduleSackAck();
+            return;
+        }
+        let entry = this.reassembly.get(seq);
+        if (!entry) {
+            if (this.reassembly.size >= MAX_REASSEMBLIES) return;
+            entry = { count, have: 0, pieces: new Array(count).fill(null) };
+            this.reassembly.set(seq, entry);
+        }
+        if (entry.count !== count || entry.pieces[index]) return;
+        entry.pieces[index] = buf.slice(FRAGMENT_HEADER_SIZE);
+        if (++entry.have < count) return;
+        this.reassembly.delete(seq);
+        const packet = new Uint8Array(entry.pieces.reduce((n, piece) => n + piece!.length, 0));
+        let offset = 0;
+        for (const piece of entry.pieces) {
+            packet.set(piece!, offset);
+            offset += piece!.length;
+        }
+        const type = packet[0];
+        if ((type === FLAG_DATA && packet.length >= HEADER_SIZE) || type === FLAG_DATA_V2 || type === FLAG_DATA_LANE) {
+            this.handlePacket(packet);
+        }
+    }
+
     private updateRTT(sample: number) {
         const now = Date.now();
         const idleTime = now - this.lastDataActivity;
@@ -702,8 +1408,8 @@ export class ReDatagram {
     }
 
     private getSackBlocks(): [number, number][] {
-        if (this.reorderBuffer.size === 0) return [];
-        const seqs = Array.from(this.reorderBuffer.keys()).sort((a, b) => a - b);
+        if (this.received.size === 0) return [];
+        const seqs = Array.from(this.received.keys()).sort((a, b) => a - b);
         const blocks: [number, number][] = [];
         let start = seqs[0], end = seqs[0];
         for (let i = 1; i < seqs.length; i++) {
@@ -721,6 +1427,10 @@ export class ReDatagram {
 
     private sendAck(seq: number) {
         if (this.isClosing) return;
+        if (this.wireVersion() >= 2) {
+            this.sendBitmapAck(seq);
+            return;
+        }
         const header = this.encodeHeader(FLAG_ACK, seq);
         const sackBlocks = this.getSackBlocks();
         if (sackBlocks.length > 0) {
@@ -739,12 +1449,28 @@ export class ReDatagram {
         }
     }
 
+    // v2 ACK: [header(5)] [bitmap], bit i set if seq + 2 + i has arrived; trimmed after the last set byte
+    private sendBitmapAck(seq: number) {
+        const bitmap = new Uint8Array(ACK_BITMAP_BYTES);
+        let used = 0;
+        for (const s of this.received.keys()) {
+            const bit = s - seq - 2;
+            if (bit < 0 || bit >= ACK_BITMAP_BYTES * 8) continue;
+            bitmap[bit >> 3] |= 1 << (bit & 7);
+            used = Math.max(used, (bit >> 3) + 1);
+        }
+        const pkt = new Uint8Array(HEADER_SIZE + used);
+        pkt.set(this.encodeHeader(FLAG_ACK_V2, seq));
+        pkt.set(bitmap.subarray(0, used), HEADER_SIZE);
+        this.socket.send(pkt, this.remote.port, this.remote.address).catch(() => { });
+    }
+
     private cleanup() {
         // Mark as closing to prevent further sends
         this.isClosing = true;
         // Wake all waiting senders so they can exit
-        for (const w of this.windowWaiters) w();
-        this.windowWaiters = [];
+        for (const w of this.windowWaiters) w?.();
+        this.windowWaiters.fill(null);
         // Cleanup all resources
         for (const t of [this.retransmitScanId, this.pingIntervalId, this.statsIntervalId]) {
             if (t) clearInterval(t);
@@ -756,9 +1482,19 @@ export class ReDatagram {
             clearTimeout(this.ackDelayTimeout);
             this.ackDelayTimeout = null;
         }
+        if (this.probeTimeout) {
+            clearTimeout(this.probeTimeout);
+            this.probeTimeout = null;
+        }
         this.sendWindow.clear();
-        this.reorderBuffer.clear();
-        this.pendingPayloads = [];
+        this.reassembly.clear();
+        this.received.clear();
+        for (const waiting of this.laneWaiting) waiting.clear();
+        this.sackedInFlight = 0;
+        this.controlInFlight = 0;
+        this.fecGroup = null;
+        this.fecHistory = null;
+        for (const payloads of this.pendingPayloads) payloads.length = 0;
         this.flushScheduled = false;
         this.sackScheduled = false;
         this.onMessage = undefined;
@@ -778,7 +1514,10 @@ export class ReDatagram {
     async close() {
         if (this.isClosing) return;
         this.isClosing = true;
-        if (!this.isRemoteClosed && this.isReady) {
+        if (this.native) {
+            // Native side sends BYE unless the session already ended
+            this.native.close();
+        } else if (!this.isRemoteClosed && this.isReady) {
             // Try to notify remote for graceful close
             const header = this.encodeHeader(FLAG_BYE, 0);
             try {
@@ -1,5 +1,6 @@
 import { DataChannelParser } from './DataChannelParser';
-import { ProxyHandlers, GenericDataChannel } from './types';
+import { ProxyHandlers, GenericDataChannel, DataLane } from './types';
+import { isMediaStream } from './mediaStream';
 import { isDebug, fp } from './utils';
 
 // ----- Message Types -----
@@ -27,6 +28,19 @@ const SETUP_AUTH_TYPES = [
     MessageType.READY,
 ]
 
+// Stream frames travel on their own lane and may arrive before the REQUEST /
+// RESPONSE announcing the stream; they are held this long, up to this much
+const EARLY_STREAM_TIMEOUT_MS = 5000;
+const MAX_EARLY_STREAM_BYTES = 8 * 1024 * 1024;
+
+type FrameCipher = { update(data: Uint8Array): Uint8Array };
+
+/** Each lane has its own keystream: the IV with the lane XORed into its first byte (as in FrameCipher.h). */
+function laneIv(iv: string, lane: DataLane): string {
+    if (lane === DataLane.Control) return iv;
+    return (parseInt(iv.slice(0, 2), 16) ^ lane).toString(16).padStart(2, '0') + iv.slice(2);
+}
+
 // ----- Types -----
 type PendingCall = {
     resolve: (val: any) => void;
@@ -49,7 +63,7 @@ export interface RPCPeerOptions {
 
 // ----- RPCPeer Implementation -----
 export class RPCPeer {
-    private parser: DataChannelParser;
+    private parsers = new Map<DataLane, DataChannelParser>(); // frames are whole within a lane
     private nextCallId = 1;
     private nextStreamId = 1;
 
@@ -57,6 +71,8 @@ export class RPCPeer {
     private streamControllers = new Map<number, ReadableStreamController<Uint8Array>>();
     private outgoingStreamReaders = new Map<number, ReadableStreamDefaultReader<Uint8Array>>();
     private cancelledStreams = new Set<number>(); // streams we've already sent CANCEL for
+    private earlyStreamFrames = new Map<number, { frames: { type: MessageType; buf: Uint8Array }[]; timer: any }>();
+    private earlyStreamBytes = 0;
     private streamRecvStats = new Map<number, { bytes: number; start: number }>();
     private targetPublicKeyPem: string | null = null;
     private targetFingerprint: string | null = null;
@@ -64,10 +80,12 @@ export class RPCPeer {
 
     private isTargetAuthenticated = false;
     private isTargetReady = false;
-    /** Stateful AES-256-CTR cipher for encrypting all outbound frames (set after auth). */
-    private sendCipher: { update(data: Uint8Array): Uint8Array } | null = null;
-    /** Stateful AES-256-CTR decipher for decrypting all inbound frames (set after auth). */
-    private recvDecipher: { update(data: Uint8Array): Uint8Array } | null = null;
+    /** Key and IV for encrypting outbound frames in JS (set after auth); the stateful AES-256-CTR ciphers, per lane. */
+    private sendKey: { securityKey: string; iv: string } | null = null;
+    private sendCiphers = new Map<DataLane, FrameCipher>();
+    /** Same for decrypting inbound frames. */
+    private recvKey: { securityKey: string; iv: string } | null = null;
+    private recvDeciphers = new Map<DataLane, FrameCipher>();
 
     private pingIntervalId: number | null = null;
     private lastPingReceived: number = Date.now();
@@ -80,10 +98,14 @@ export class RPCPeer {
 
     constructor(private opts: RPCPeerOptions) {
         this.tag = opts.id || fp(opts.fingerprint || 'unknown');
-        this.parser = new DataChannelParser({ onFrame: this.onFrame });
         // this.opts.dataChannel.binaryType = 'arraybuffer';
-        this.opts.dataChannel.onmessage = data => {
-            this.parser.feed(data);
+        this.opts.dataChannel.onmessage = (data, lane = DataLane.Control) => {
+            let parser = this.parsers.get(lane);
+            if (!parser) {
+                parser = new DataChannelParser({ onFrame: frame => this.onFrame(frame, lane) });
+                this.parsers.set(lane, parser);
+            }
+            parser.feed(data);
         };
         this.opts.dataChannel.onerror = (ev: Error | string) => {
             this.onError(typeof ev === 'string' ? new Error(ev) : ev);
@@ -236,6 +258,9 @@ export class RPCPeer {
         });
         this.streamControllers.clear();
         this.cancelledStreams.clear();
+        this.earlyStreamFrames.forEach(({ timer }) => clearTimeout(timer));
+        this.earlyStreamFrames.clear();
+        this.earlyStreamBytes = 0;
         // Reject all pending RPC calls so callers don't hang forever.
         const pendingError = new Error('Connection closed');
         this.pending.forEach(({ reject }) => reject(pendingError));
@@ -247,7 +272,7 @@ export class RPCPeer {
         this.opts.onClose?.(this);
     }
 
-    private onFrame = async ({ type, flags, payload }: { type: number, payload: Uint8Array, flags: number }) => {
+    private onFrame = async ({ type, flags, payload }: { type: number, payload: Uint8Array, flags: number }, lane: DataLane) => {
         // Any received frame proves the peer is alive
         this.lastPingReceived = Date.now();
 
@@ -259,9 +284,14 @@ export class RPCPeer {
             console.warn(`[RPC:${this.tag}] Message type not allowed right now`, type);
             return;
         }
-        // Decrypt payload for non-setup messages using the connection-level decipher.
-        if (this.recvDecipher && !SETUP_AUTH_TYPES.includes(type)) {
-            payload = this.recvDecipher.update(payload);
+        // Decrypt payload for non-setup messages using the lane's decipher.
+        if (this.recvKey && !SETUP_AUTH_TYPES.includes(type)) {
+            let decipher = this.recvDeciphers.get(lane);
+            if (!decipher) {
+                decipher = modules.crypto.createDecipher(this.recvKey.securityKey, laneIv(this.recvKey.iv, lane));
+                this.recvDeciphers.set(lane, decipher);
+            }
+            payload = decipher.update(payload);
         }
         try {
             switch (type) {
@@ -352,7 +382,10 @@ export class RPCPeer {
         if (!this.opts.isSecure) {
             securityKey = modules.crypto.generateRandomKey();
             iv = modules.crypto.generateIv();
-            this.recvDecipher = modules.crypto.createDecipher(securityKey, iv);
+            // Native transports decrypt in place, off the JS thread
+            if (!this.opts.dataChannel.setFrameCipher?.('recv', securityKey, iv)) {
+                this.recvKey = { securityKey, iv };
+            }
         }
 
         const challenge = {
@@ -402,8 +435,8 @@ export class RPCPeer {
             this.onError(new Error('Security key and IV are required for non-secure connections but not provided by target'));
             return;
         }
-        if (securityKey && iv) {
-            this.sendCipher = modules.crypto.createCipher(securityKey, iv);
+        if (securityKey && iv && !this.opts.dataChannel.setFrameCipher?.('send', securityKey, iv)) {
+            this.sendKey = { securityKey, iv };
         }
         const response = { otp };
         const responsePayload = await modules.crypto.encryptPK(JSON.stringify(response), this.targetPublicKeyPem);
@@ -431,11 +464,18 @@ export class RPCPeer {
                     const id = v.__rpc_stream_id__;
                     const stream = new ReadableStream<Uint8Array>({
                         start: ctrl => {
+                            if (this.cancelledStreams.has(id)) {
+                                // Its frames came too early and were given up on
+                                ctrl.error(new Error('Stream data timed out'));
+                                return;
+                            }
                             console.debug(`[RPC:${this.tag}] Registering stream controller for id=${id}`);
                             this.streamControllers.set(id, ctrl);
+                            this.replayEarlyFrames(id);
                         },
                         cancel: () => {
                             console.log(`[RPC:${this.tag}] Stream ${id} cancelled by consumer`);
+                            this.cancelledStreams.add(id);
                             this.cancelStream(id);
                             this.streamControllers.delete(id);
                         }
@@ -609,12 +649,9 @@ export class RPCPeer {
         let ctrl = this.streamControllers.get(streamId);
 
         if (!ctrl) {
-            // Send CANCEL back once so the sender stops
-            if (!this.cancelledStreams.has(streamId)) {
-                this.cancelledStreams.add(streamId);
-                console.debug(`[RPC:${this.tag}] Unknown stream ${streamId}, sending CANCEL`);
-                this.cancelStream(streamId).catch(() => { });
-            }
+            // Already given up on, or held until the stream is announced
+            if (this.cancelledStreams.has(streamId) || this.holdEarlyFrame(streamId, type, buf)) return;
+            this.giveUpEarlyStream(streamId);
             return;
         }
 
@@ -646,6 +683,43 @@ export class RPCPeer {
         }
     }
 
+    // Keep a frame of a stream not announced yet; false when that's too much
+    private holdEarlyFrame(streamId: number, type: MessageType, buf: Uint8Array): boolean {
+        if (this.earlyStreamBytes + buf.byteLength > MAX_EARLY_STREAM_BYTES) return false;
+        let early = this.earlyStreamFrames.get(streamId);
+        if (!early) {
+            early = { frames: [], timer: setTimeout(() => this.giveUpEarlyStream(streamId), EARLY_STREAM_TIMEOUT_MS) };
+            this.earlyStreamFrames.set(streamId, early);
+        }
+        early.frames.push({ type, buf: buf.slice() });
+        this.earlyStreamBytes += buf.byteLength;
+        return true;
+    }
+
+    private takeEarlyFrames(streamId: number) {
+        const early = this.earlyStreamFrames.get(streamId);
+        if (!early) return [];
+        clearTimeout(early.timer);
+        this.earlyStreamFrames.delete(streamId);
+        for (const { buf } of early.frames) this.earlyStreamBytes -= buf.byteLength;
+        return early.frames;
+    }
+
+    private replayEarlyFrames(streamId: number) {
+        for (const { type, buf } of this.takeEarlyFrames(streamId)) {
+            this.handleStreamMessage(type, buf);
+        }
+    }
+
+    // Send CANCEL back once so the sender stops
+    private giveUpEarlyStream(streamId: number) {
+        this.takeEarlyFrames(streamId);
+        if (this.isClosed) return;
+        this.cancelledStreams.add(streamId);
+        console.debug(`[RPC:${this.tag}] Unknown stream ${streamId}, sending CANCEL`);
+        this.cancelStream(streamId).catch(() => { });
+    }
+
     private async sendError(callId: number, error: string) {
         const payload = new TextEncoder().encode(JSON.stringify({ callId, error }));
         await this.sendFrame(MessageType.ERROR, payload);
@@ -654,6 +728,8 @@ export class RPCPeer {
     private async sendStream(streamId: number, source: ReadableStream<Uint8Array>) {
         const reader = source.getReader();
         this.outgoingStreamReaders.set(streamId, reader);
+        // Off the control lane, so a file copy doesn't hold back RPC calls and input
+        const lane = isMediaStream(source) ? DataLane.Media : DataLane.Bulk;
 
         const pump = async () => {
             console.debug(`[RPC:${this.tag}] Stream pump started for stream=${streamId}`);
@@ -694,7 +770,7 @@ export class RPCPeer {
                     new DataView(payload.buffer).setUint32(0, streamId, false);
                     payload.set(value, 4);
 
-                    await this.sendFrame(MessageType.STREAM_CHUNK, payload);
+                    await this.sendFrame(MessageType.STREAM_CHUNK, payload, lane);
                     const t2 = Date.now();
 
                     totalReadMs += (t1 - t0);
@@ -730,7 +806,7 @@ export class RPCPeer {
                     console.debug(`[RPC:${this.tag}] Sending STREAM_END for stream=${streamId} (${chunkCount} chunks, ${totalBytes} bytes)`);
                     const end = new Uint8Array(4);
                     new DataView(end.buffer).setUint32(0, streamId, false);
-                    await this.sendFrame(MessageType.STREAM_END, end);
+                    await this.sendFrame(MessageType.STREAM_END, end, lane);
                     console.debug(`[RPC:${this.tag}] STREAM_END sent for stream=${streamId}`);
                 } else {
                     console.debug(`[RPC:${this.tag}] Skipping STREAM_END for stream=${streamId} — connection closed`);
@@ -757,18 +833,25 @@ export class RPCPeer {
         await this.sendFrame(MessageType.STREAM_CANCEL, buf);
     }
 
-    private async sendFrame(type: MessageType, payload: Uint8Array) {
+    private async sendFrame(type: MessageType, payload: Uint8Array, lane = DataLane.Control) {
         if (this.isClosed) {
             console.warn(`[RPC:${this.tag}] Attempted to send frame on closed connection`);
             return; // Silently ignore sends on closed connection
         }
-        // Encrypt payload for non-setup messages using the connection-level cipher.
-        if (this.sendCipher && !SETUP_AUTH_TYPES.includes(type)) {
-            payload = this.sendCipher.update(payload);
+        // Encrypt payload for non-setup messages using the cipher of the lane
+        // it's delivered on; nothing may be sent between asking and sending.
+        if (this.sendKey && !SETUP_AUTH_TYPES.includes(type)) {
+            const sendLane = this.opts.dataChannel.laneFor?.(lane) ?? DataLane.Control;
+            let cipher = this.sendCiphers.get(sendLane);
+            if (!cipher) {
+                cipher = modules.crypto.createCipher(this.sendKey.securityKey, laneIv(this.sendKey.iv, sendLane));
+                this.sendCiphers.set(sendLane, cipher);
+            }
+            payload = cipher.update(payload);
         }
         const framed = DataChannelParser.encode(type, 0x00, payload);
         try {
-            await this.opts.dataChannel.send(framed);
+            await this.opts.dataChannel.send(framed, { lane });
             // A successful send proves the data channel is alive.
             // The underlying transport (ReUDP/TCP) handles dead-peer detection.
             this.lastPingReceived = Date.now();
@@ -14,12 +14,39 @@ export type SignalMetadata = {
 
 export const DEFAULT_AGENT_PORT = 7736;
 
+/**
+ * Ordering domains of a data channel. Each lane is delivered in its own
+ * order, so a stall on one doesn't hold back the others; transports without
+ * lanes deliver everything in one order, as control.
+ */
+export enum DataLane {
+    Control = 0, // RPC requests, responses, input events
+    Media = 1,   // live media (e.g. screen frames): worth some bandwidth to avoid waiting on retransmits
+    Bulk = 2,    // file and thumbnail streams
+}
+
+/** Per-send hints a transport may act on; others ignore them. */
+export type DataSendOptions = {
+    lane?: DataLane;
+};
+
 export interface GenericDataChannel {
-    send: (data: Uint8Array) => Promise<void>;
-    onmessage: (ev: Uint8Array) => void;
+    send: (data: Uint8Array, options?: DataSendOptions) => Promise<void>;
+    /** `lane` is what the data was sent on; absent on transports without lanes. */
+    onmessage: (ev: Uint8Array, lane?: DataLane) => void;
     disconnect: () => void;
     onerror: (ev: Error | string) => void;
     ondisconnect: (ev?: Error) => void;
+    /**
+     * Optional: encrypt (send) or decrypt (recv) RPC frame payloads in the
+     * transport instead of in RPCPeer. False when the channel can't.
+     */
+    setFrameCipher?: (direction: 'send' | 'recv', secretKey: string, iv: string) => boolean;
+    /**
+     * Optional: the lane data sent on `lane` right now is delivered on, for
+     * a transport that falls back to fewer lanes with older peers.
+     */
+    laneFor?: (lane: DataLane) => DataLane;
 }
 
 export type SimpleSchema = {
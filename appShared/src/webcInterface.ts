@@ -1,7 +1,7 @@
 import { ReDatagram } from "./reUdpProtocol";
 import { DatagramCompat } from "./compat";
 import { ConnectionInterface } from "./netService";
-import { ConnectionType, GenericDataChannel, PeerCandidate, WebcInit, WebcPeerData, WebcReject } from "./types";
+import { ConnectionType, DataLane, DataSendOptions, GenericDataChannel, PeerCandidate, WebcInit, WebcPeerData, WebcReject } from "./types";
 import { filterValidBonjourIps, safeIp } from "./utils";
 
 
@@ -428,12 +428,12 @@ export abstract class WebcInterface extends ConnectionInterface {
     }
 
     createDataChannel(reDgram: ReDatagram): GenericDataChannel {
-        let messageHandler: ((ev: Uint8Array) => void) | null = null;
+        let messageHandler: ((ev: Uint8Array, lane?: DataLane) => void) | null = null;
         let errorHandler: ((ev: Error | string) => void) | null = null;
         let disconnectHandler: ((ev?: Error) => void) | null = null;
-        reDgram.onMessage = (msg: Uint8Array) => {
+        reDgram.onMessage = (msg: Uint8Array, lane: DataLane) => {
             if (messageHandler) {
-                messageHandler(msg);
+                messageHandler(msg, lane);
             }
         };
 
@@ -447,15 +447,23 @@ export abstract class WebcInterface extends ConnectionInterface {
         };
 
         return {
-            send: (data: Uint8Array) => {
-                return reDgram.send(data);
+            send: (data: Uint8Array, options?: DataSendOptions) => {
+                return reDgram.send(data, options);
+            },
+
+            setFrameCipher: (direction: 'send' | 'recv', secretKey: string, iv: string) => {
+                return reDgram.setFrameCipher(direction, secretKey, iv);
+            },
+
+            laneFor: (lane: DataLane) => {
+                return reDgram.laneFor(lane);
             },
 
             get onmessage() {
                 return messageHandler;
             },
 
-            set onmessage(handler: ((ev: ArrayBufferView) => void) | null) {
+            set onmessage(handler: ((ev: Uint8Array, lane?: DataLane) => void) | null) {
                 messageHandler = handler;
             },
 
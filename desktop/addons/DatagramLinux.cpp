@@ -0,0 +1,2873 @@
+#include <napi.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include "net/EventDispatcher.h"
+#include "net/FloodGuard.h"
+#include "net/FrameCipher.h"
+#include "net/ReUdpEngine.h"
+#include "net/SlabBuffer.h"
+#include "net/SocketStats.h"
+#include "net/Uring.h"
+
+// Older libc headers predate UDP segmentation offload
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+/**
+ * Batched UDP socket wrapper for Node.js on Linux.
+ *
+ * Same surface as DatagramWin so dgramCompat.ts can use either one, but
+ * built for bulk ReUDP transfers: datagrams move in recvmmsg()/sendmmsg()
+ * batches (or io_uring chains), with GSO/GRO where the kernel has them, and
+ * native sessions run the ReUDP engine (net/ReUdpEngine.h) next to the
+ * socket. docs/Development/reudp.md ("Platform-Specific Behavior") covers
+ * each feature.
+ *
+ * Threading: one I/O thread (reactor) for the whole process owns every
+ * socket's fd, queues, sessions and timers. JS threads only enqueue under a lock and wake it through an
+ * eventfd. Events from all sockets reach JS through one shared queue
+ * (net/EventDispatcher.h), so threads and wakeups stay flat however many
+ * peers the app talks to.
+ *
+ * Exposes:
+ *   createSocket(callback, options?: { batch?: boolean, maxBuffer?: number }) -> handle
+ *   bind(handle, port?) -> { address, family, port }
+ *   send(handle, data, port, address) -> credits   (address must be numeric IPv4; -1: full, wait for drain)
+ *   close(handle) -> void
+ *   address(handle) -> { address, family, port }
+ *   openSession(handle, { addresses: string[], port, lan, legacyPeer? }) -> sessionId
+ *   sessionSend(handle, sessionId, data, lane?: 0 | 1 | 2) -> boolean   (false: wait for sessionDrain; lanes: control, media (FEC-protected), bulk)
+ *   closeSession(handle, sessionId) -> void
+ *   sessionStats(handle, sessionId) -> { cwnd, srtt, pacingRate, mtu, ... } | null
+ *   setSessionCipher(handle, sessionId, 'send' | 'recv', key: 32 bytes, iv: 16 bytes) -> void   (net/FrameCipher.h)
+ *   setPeerFilter(handle, [{ addresses: string[], port }] | null) -> void
+ *   getStats(handle) -> { packets/bytes, drops, queue depths, handoff latency } | null   (net/SocketStats.h)
+ *   isDontFragment(handle) -> boolean   (datagrams go out with DF set; false once a base-size one needed fragmenting)
+ *   maxDatagramSize(handle, address) -> number   (most the route takes unfragmented; 0: unknown)
+ *   release(buffer) -> void   (hand a received buffer's memory back now)
+ *   setBackend('io_uring' | 'epoll') -> void   (before the I/O thread starts; default epoll)
+ *   reactorStats() -> { backend, syscalls, cpuMs }   (the process's I/O thread)
+ *
+ * Events, through the environment's shared ThreadSafeFunction:
+ *   onMessage(msg: Buffer, rinfo: { address, family, port })
+ *   onBatch(data: Buffer, table: Uint32Array, rinfos: rinfo[], times?: Float64Array)   (batch mode; table: [offset, length, rinfoIndex] per datagram)
+ *   onError(err: string)
+ *   onClose()
+ *   onDrain(credits)   (send queue has room again after send() ran out of credits)
+ *   onSessionReady(sessionId, isSuccess: boolean)
+ *   onSessionData(sessionId, data: Buffer, lane)   (in order within the lane)
+ *   onSessionDrain(sessionId)
+ *   onSessionClose(sessionId, err: string | null)
+ */
+
+static constexpr int RECV_BATCH = 32;           // datagrams per recvmmsg() call
+static constexpr int SEND_BATCH = 32;           // datagrams per sendmmsg() call
+static constexpr size_t RECV_SLOT_SIZE = 2048;  // ReUDP packets up to Ethernet's 1472 bytes; GRO slots take jumbo ones
+static constexpr size_t RECV_SLAB_SIZE = 128 * RECV_SLOT_SIZE; // 4 full recvmmsg() rounds per slab
+static constexpr size_t MAX_IDLE_SLABS = 32;    // pooled for reuse, shared by all sockets
+static constexpr size_t GRO_SLOT_SIZE = 65536;   // one coalesced UDP_GRO super-packet
+static constexpr size_t GRO_SLAB_SIZE = 16 * GRO_SLOT_SIZE;
+static constexpr int64_t PATH_MTU_CACHE_MS = reudp::MTU_RAISE_INTERVAL_MS; // how long a peer's probed packet size is reused
+static constexpr size_t MAX_IDLE_GRO_SLABS = 8;
+static constexpr size_t MAX_GSO_SEGMENTS = 64;    // UDP_MAX_SEGMENTS on older kernels
+static constexpr size_t MAX_GSO_BYTES = 65000;    // under the 65507-byte IPv4 UDP payload limit
+static constexpr int MAX_RECV_ROUNDS = 16;      // recvmmsg() calls per socket before serving the others
+static constexpr int REACTOR_EVENTS = 64;       // epoll events taken per reactor iteration
+static constexpr int SOCKET_BUFFER_SIZE = 2 * 1024 * 1024; // starting size; same as Datagram_ in netCompat.ts
+static constexpr int MAX_SOCKET_BUFFER_SIZE = 32 * 1024 * 1024; // default cap on autotuned buffers ("maxBuffer")
+static constexpr size_t IPV4_UDP_HEADERS = 28;  // what an interface MTU holds besides the datagram
+static constexpr int64_t BUFFER_GROW_INTERVAL_MS = 100; // receive buffer doubles at most this often on drops
+static constexpr size_t MAX_BATCH_DATAGRAMS = 8192; // JS is stalled past this; drop like a full kernel queue
+static constexpr size_t SEND_QUEUE_CAPACITY = 4096; // datagrams send() may queue (~5 MB of ReUDP packets)
+static constexpr size_t SEND_LOW_WATER = SEND_QUEUE_CAPACITY / 4; // drain fires once the queue falls below
+static constexpr size_t SESSION_HIGH_WATER = 8 * 1024 * 1024; // sessionSend() asks JS to wait past this backlog
+static constexpr size_t SESSION_LOW_WATER = 2 * 1024 * 1024;  // sessionDrain fires once the backlog falls below
+static constexpr size_t RECV_CTRL_SIZE = CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(sizeof(int)) +
+                                         CMSG_SPACE(sizeof(timespec)); // UDP_GRO, SO_RXQ_OVFL, IP_TOS, SO_TIMESTAMPNS
+static constexpr size_t SEND_CTRL_SIZE = CMSG_SPACE(sizeof(uint16_t)) + CMSG_SPACE(sizeof(int)); // UDP_SEGMENT, IP_TOS
+#if NET_HAS_URING
+static constexpr unsigned URING_ENTRIES = 256;      // submission ring; a send chain is at most SEND_BATCH
+static constexpr unsigned URING_CQ_ENTRIES = 4096;  // completions between two reaps (overflow is kept, not lost)
+static constexpr uint16_t URING_BUFFERS = 64;       // provided receive buffers per reactor (power of two)
+static constexpr uint16_t URING_BUFFER_GROUP = 0;
+// recvmsg_out header, source address, control messages, then the datagram
+static constexpr uint32_t URING_BUFFER_SIZE =
+    sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + RECV_CTRL_SIZE + GRO_SLOT_SIZE;
+#endif
+
+struct OutgoingDatagram
+{
+    std::vector<uint8_t> data;
+    sockaddr_in dest;
+    uint8_t ecn = reudp::ECN_NOT_ECT; // ECN field to send with
+};
+
+struct RemoteInfo
+{
+    in_addr_t address; // network byte order
+    uint16_t port;     // host byte order
+};
+
+// Datagrams received since the last JS delivery, all from the same slab
+struct MessageBatch
+{
+    net::Slab *slab = nullptr;   // one reference, handed to JS with the batch
+    size_t start = 0;            // slab range covered by the batch
+    size_t end = 0;
+    std::vector<uint32_t> table; // [offset from start, length, rinfo index] per datagram
+    std::vector<double> times;   // kernel arrival per datagram, ms since the epoch; 0 if not stamped
+    std::vector<RemoteInfo> remotes;
+
+    MessageBatch(net::Slab *s, size_t offset) : slab(s), start(offset), end(offset)
+    {
+        net::SlabPool::retain(slab);
+    }
+
+    MessageBatch(MessageBatch &&other) noexcept
+        : slab(other.slab), start(other.start), end(other.end),
+          table(std::move(other.table)), times(std::move(other.times)), remotes(std::move(other.remotes))
+    {
+        other.slab = nullptr;
+    }
+
+    MessageBatch(const MessageBatch &) = delete;
+    MessageBatch &operator=(const MessageBatch &) = delete;
+
+    ~MessageBatch()
+    {
+        if (slab)
+            net::SlabPool::release(slab);
+    }
+
+    size_t count() const { return table.size() / 3; }
+
+    uint32_t remoteIndex(const sockaddr_in &addr)
+    {
+        // Almost always one or two peers per socket, so a linear scan wins
+        for (size_t i = 0; i < remotes.size(); ++i)
+        {
+            if (remotes[i].address == addr.sin_addr.s_addr && remotes[i].port == ntohs(addr.sin_port))
+                return static_cast<uint32_t>(i);
+        }
+        remotes.push_back({addr.sin_addr.s_addr, ntohs(addr.sin_port)});
+        return static_cast<uint32_t>(remotes.size() - 1);
+    }
+
+    void append(size_t offset, size_t len, const sockaddr_in &from, int64_t arrivalNs)
+    {
+        table.push_back(static_cast<uint32_t>(offset - start));
+        table.push_back(static_cast<uint32_t>(len));
+        table.push_back(remoteIndex(from));
+        times.push_back(arrivalNs / 1e6);
+        end = offset + len;
+    }
+};
+
+static net::SlabPool &RecvSlabs()
+{
+    // Never destroyed: JS may still hold slab buffers during teardown
+    static auto *pool = new net::SlabPool(RECV_SLAB_SIZE, MAX_IDLE_SLABS);
+    return *pool;
+}
+
+static net::SlabPool &GroSlabs()
+{
+    static auto *pool = new net::SlabPool(GRO_SLAB_SIZE, MAX_IDLE_GRO_SLABS);
+    return *pool;
+}
+
+// One datagram of a recvmmsg() round, after splitting GRO super-packets
+struct RecvPacket
+{
+    size_t offset;   // in the socket's recvSlab
+    uint32_t length;
+    int msgIndex;    // recvmmsg() entry it came in, for the source address
+    bool isConsumed; // taken by a session or dropped by the peer filter, not for JS
+    uint8_t ecn;     // ECN field of its IP header (GRO only coalesces equal ones)
+    int64_t arrivalNs; // kernel receive timestamp (CLOCK_REALTIME), 0 if not stamped
+};
+
+// Source endpoint as one hash key: IPv4 address (network byte order) and port
+static uint64_t PeerKey(in_addr_t address, uint16_t port)
+{
+    return (static_cast<uint64_t>(address) << 16) | port;
+}
+
+using PeerSet = std::unordered_set<uint64_t>; // PeerKey()s
+
+// Native ReUDP session bound to one peer of a socket
+struct SessionEntry : std::enable_shared_from_this<SessionEntry>
+{
+    uint32_t id = 0;
+    std::vector<in_addr_t> allowedAddresses; // network byte order
+    uint16_t port = 0;                       // host byte order
+    sockaddr_in remote{};                    // follows the peer between allowed addresses
+    std::unique_ptr<reudp::Session> engine;  // I/O thread only (after creation)
+    bool isDone = false;                     // I/O thread only
+    bool isValidated = false;                // I/O thread only: the peer echoed our cookie, or is a legacy peer that said hello
+    bool isLegacyPeer = false;               // the peer may predate cookies (openSession's `legacyPeer`)
+    uint64_t reportedBytesSent = 0;          // I/O thread only
+    size_t reportedMtu = reudp::BASE_PACKET_SIZE; // I/O thread only
+
+    // Filled by sessionSend()/closeSession()/setSessionCipher(), drained by the I/O thread
+    struct Outgoing
+    {
+        std::vector<uint8_t> data;
+        uint8_t lane;
+    };
+    std::deque<Outgoing> inbox;
+    bool closeRequested = false;
+    std::vector<uint8_t> newSendKey; // key then IV, empty if unchanged
+    std::vector<uint8_t> newRecvKey;
+    std::mutex inboxMu;
+
+    // RPC frame encryption of each lane's byte stream each way (I/O thread only)
+    net::FrameCipher sendFrames[reudp::LANE_COUNT];
+    net::FrameCipher recvFrames[reudp::LANE_COUNT];
+
+    std::atomic<size_t> backlog{0}; // bytes accepted from JS but not yet packetized
+    std::atomic<bool> drainWanted{false};
+
+    // In-order payload of each lane waiting for the scheduled JS call
+    std::vector<uint8_t> pendingData[reudp::LANE_COUNT];
+    bool dataScheduled = false;
+    std::mutex dataMu;
+
+    // Engine stats as of the last I/O thread pass, for sessionStats()
+    reudp::SessionStats stats;
+    std::mutex statsMu;
+};
+
+struct EventData;
+static void DeliverEvent(Napi::Env env, EventData *data);
+using Dispatcher = net::EventDispatcher<EventData, DeliverEvent>;
+struct Reactor;
+struct SocketEntry;
+
+// What an io_uring submission was for; its address is the SQE's user_data
+struct UringOp
+{
+    enum Kind : uint8_t
+    {
+        Wake,    // read of the reactor's eventfd
+        Receive, // a socket's multishot RECVMSG
+        Send,    // one entry of a socket's SENDMSG chain
+        Cancel   // cancellation of a socket's receive at close
+    } kind;
+    SocketEntry *socket = nullptr;
+    int index = 0; // Send: sendMsgs entry
+};
+
+struct SocketEntry : std::enable_shared_from_this<SocketEntry>
+{
+    int fd = -1;
+    Reactor *reactor = nullptr;             // the I/O thread serving this socket
+    Napi::FunctionReference callback;       // JS thread only; reset once "close" is delivered
+    std::shared_ptr<Dispatcher> dispatcher; // the environment's event queue
+
+    std::string localAddress;
+    std::string localFamily;
+    int localPort = 0;
+    bool isBound = false;
+    bool batchMode = false;
+    std::atomic<bool> isClosed{false};
+    std::mutex mu;
+
+    // Batch mode: packets accumulate here until the scheduled JS call runs;
+    // a new batch starts whenever the I/O thread moves on to a fresh slab
+    std::vector<MessageBatch> pendingBatches;
+    size_t pendingCount = 0;
+    bool batchScheduled = false;
+    std::mutex batchMu;
+
+    // Datagrams queued by send(), flushed by the I/O thread with sendmmsg()
+    std::deque<OutgoingDatagram> sendQueue;
+    bool drainWanted = false; // send() ran out of credits; post drain below SEND_LOW_WATER
+    std::mutex sendMu;
+
+    // Offloads the kernel accepted at createSocket(); isGso is dropped by the
+    // I/O thread if a GSO send fails (e.g. no checksum offload on the route)
+    bool isGso = false;
+    bool isGro = false;
+    bool isRxqOvfl = false; // kernel reports its receive-queue drop count (SO_RXQ_OVFL)
+    bool isTimestamp = false; // kernel stamps each datagram's arrival (SO_TIMESTAMPNS)
+    // IP_PMTUDISC_PROBE: sessions may probe the path MTU. Dropped by the I/O
+    // thread if even a base-size packet is too big for the route unfragmented.
+    std::atomic<bool> isDontFragment{false};
+    bool isEcn = false; // IP_RECVTOS: sessions are ECN-capable; dropped if the kernel refuses an IP_TOS send
+
+    // Kernel buffer autotuning (I/O thread only once registered): sizes in
+    // effect, growing towards the sessions' windows up to the cap or until
+    // the kernel clamps a request (net.core.{r,w}mem_max)
+    int recvBufferSize = 0;
+    int sendBufferSize = 0;
+    bool isRecvBufferClamped = false;
+    bool isSendBufferClamped = false;
+    int maxBufferSize = MAX_SOCKET_BUFFER_SIZE;
+    uint32_t kernelDropTotal = 0; // SO_RXQ_OVFL count last read
+    uint32_t seenKernelDrops = 0; // part of it already acted on
+    int64_t lastRecvGrowth = 0;
+
+    std::shared_ptr<net::SocketStats> stats = std::make_shared<net::SocketStats>();
+
+    // recvmmsg() state (I/O thread only): datagrams land in fixed-size slots
+    // (RECV_SLOT_SIZE, or GRO_SLOT_SIZE with GRO) of recvSlab, which the
+    // socket holds one reference on. Entry i starts at recvOffsets[i]; the
+    // io_uring backend copies datagrams in back to back instead.
+    net::Slab *recvSlab = nullptr;
+    mmsghdr recvMsgs[RECV_BATCH];
+    iovec recvIov[RECV_BATCH];
+    sockaddr_in recvAddrs[RECV_BATCH];
+    char recvCtrl[RECV_BATCH][RECV_CTRL_SIZE];
+    size_t recvOffsets[RECV_BATCH];
+    std::vector<RecvPacket> recvPackets;
+
+    // sendmmsg() state (I/O thread only): one entry per datagram, or per GSO run
+    mmsghdr sendMsgs[SEND_BATCH];
+    iovec sendIov[SEND_BATCH * MAX_GSO_SEGMENTS];
+    char sendCtrl[SEND_BATCH][SEND_CTRL_SIZE];
+    size_t sendSpan[SEND_BATCH]; // datagrams covered by each entry
+    uint8_t sendEcn[SEND_BATCH]; // ECN field set by each entry's IP_TOS, 0 if none
+    size_t sendBytes[SEND_BATCH];
+
+    // Sessions: `sessions` is the lookup for JS calls, `activeSessions` the
+    // I/O thread's own list; new sessions pass through `addedSessions`.
+    std::unordered_map<uint32_t, std::shared_ptr<SessionEntry>> sessions;
+    std::vector<std::shared_ptr<SessionEntry>> addedSessions;
+    uint32_t nextSessionId = 1;
+    std::mutex sessionMu;
+    std::vector<std::shared_ptr<SessionEntry>> activeSessions; // I/O thread only
+    std::unordered_map<uint64_t, SessionEntry *> sessionIndex;  // I/O thread only: peer endpoint -> session
+
+    // Peer filter: set by setPeerFilter() under sessionMu, taken over by the
+    // I/O thread like new sessions. Null lets every datagram through.
+    std::shared_ptr<const PeerSet> newPeerFilter;
+    bool isPeerFilterChanged = false;
+    std::shared_ptr<const PeerSet> peerFilter; // I/O thread only
+
+    // Rate limit and cookies for session peers not yet validated (I/O thread only)
+    net::FloodGuard floodGuard;
+
+    // Hand-over with the reactor (Reactor::mu held)
+    bool isRegistered = false;  // passed to the reactor by createSocket()
+    bool isDetached = false;    // the reactor let go of it; fd may be closed
+    bool isWakePending = false; // queued in Reactor::woken
+
+    // Reactor bookkeeping (I/O thread only)
+    uint32_t readyEvents = 0;   // epoll events of the current iteration
+    bool isWoken = false;       // Wake()d since the last iteration
+    bool isQueued = false;      // already on the iteration's ready list
+    bool isReadable = false;    // edge seen, kernel queue not yet drained
+    bool wantWritable = false;  // EPOLLOUT armed after EAGAIN
+    int64_t timerDeadlineMs = reudp::NO_TIMEOUT; // earliest session timer
+
+    // io_uring backend (I/O thread only). The chain in flight covers
+    // sendFlight[flightIdx...]; its entries are built in sendMsgs as above.
+    msghdr uringRecvHdr{}; // name and control sizes for the multishot receive
+    UringOp recvOp{UringOp::Receive, this};
+    UringOp cancelOp{UringOp::Cancel, this};
+    UringOp sendOps[SEND_BATCH];
+    int uringOps = 0;     // submissions still to post their final completion
+    bool isRecvArmed = false;
+    int recvStaged = 0;   // entries of recvMsgs filled from completions, not yet delivered
+    std::deque<OutgoingDatagram> sendFlight;
+    size_t flightIdx = 0;
+    int flightEntries = 0; // SENDMSG entries of the chain in flight, 0 if none
+    int flightDone = 0;
+    int sendResults[SEND_BATCH];
+    bool isDetaching = false; // closed; waiting for uringOps to reach 0
+    bool isCancelSent = false;
+
+    ~SocketEntry()
+    {
+        if (recvSlab)
+            net::SlabPool::release(recvSlab);
+    }
+};
+
+static std::mutex globalMu;
+static uint32_t nextHandle = 1;
+static std::unordered_map<uint32_t, std::shared_ptr<SocketEntry>> sockets;
+
+static std::shared_ptr<SocketEntry> GetSocket(uint32_t handle)
+{
+    std::lock_guard<std::mutex> lock(globalMu);
+    auto it = sockets.find(handle);
+    if (it != sockets.end())
+        return it->second;
+    return nullptr;
+}
+
+static void RemoveSocket(uint32_t handle)
+{
+    std::lock_guard<std::mutex> lock(globalMu);
+    sockets.erase(handle);
+}
+
+// One epoll instance (or io_uring) and I/O thread for every socket of the
+// process. Other threads hand sockets over through the lists under `mu` and
+// signal wakeFd.
+struct Reactor
+{
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd: something was queued in `added` or `woken`
+    int startError = 0;
+#if NET_HAS_URING
+    std::unique_ptr<net::Uring> ring; // io_uring backend; epoll if null
+    UringOp wakeOp{UringOp::Wake};
+    uint64_t wakeCount = 0; // the ring's read of wakeFd lands here
+    int detaching = 0;      // I/O thread only: sockets waiting on their last completions
+#endif
+
+    std::mutex mu;
+    std::condition_variable detachedCv;
+    std::vector<std::shared_ptr<SocketEntry>> added;
+    std::vector<std::shared_ptr<SocketEntry>> woken;
+
+    std::vector<std::shared_ptr<SocketEntry>> sockets; // I/O thread only
+    std::vector<std::shared_ptr<SocketEntry>> ready;   // I/O thread only: to service this iteration
+
+    // For reactorStats(): syscalls the I/O thread made besides
+    // io_uring_enter() (counted by the ring), and its CPU clock
+    std::atomic<uint64_t> syscalls{0};
+    clockid_t cpuClock{};
+    bool hasCpuClock = false;
+
+    bool isUring() const
+    {
+#if NET_HAS_URING
+        return ring != nullptr;
+#else
+        return false;
+#endif
+    }
+};
+
+static std::atomic<bool> preferUring{false}; // setBackend()
+
+static void CountSyscall(Reactor *r)
+{
+    r->syscalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void ReactorLoop(Reactor *r);
+
+#if NET_HAS_URING
+// Ring and receive buffers for a reactor; false leaves it on epoll
+static bool StartUring(Reactor *r)
+{
+    auto ring = std::make_unique<net::Uring>();
+    if (ring->init(URING_ENTRIES, URING_CQ_ENTRIES) != 0 ||
+        !ring->addBuffers(URING_BUFFER_GROUP, URING_BUFFERS, URING_BUFFER_SIZE))
+        return false;
+    r->ring = std::move(ring);
+    return true;
+}
+#endif
+
+static Reactor *StartReactor()
+{
+    auto *r = new Reactor();
+#if NET_HAS_URING
+    if (preferUring && StartUring(r))
+    {
+        // Read through the ring, which waits for a count itself: blocking fd
+        r->wakeFd = eventfd(0, EFD_CLOEXEC);
+        if (r->wakeFd < 0)
+        {
+            r->startError = errno;
+            return r;
+        }
+    }
+#endif
+    if (!r->isUring())
+    {
+        r->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        r->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (r->epollFd < 0 || r->wakeFd < 0)
+        {
+            r->startError = errno;
+            return r;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.ptr = nullptr; // sockets carry their SocketEntry
+        epoll_ctl(r->epollFd, EPOLL_CTL_ADD, r->wakeFd, &ev);
+    }
+    std::thread thread(ReactorLoop, r);
+    r->hasCpuClock = pthread_getcpuclockid(thread.native_handle(), &r->cpuClock) == 0;
+    thread.detach();
+    return r;
+}
+
+// Started on first use and never destroyed: the thread runs until the
+// process exits
+static std::mutex reactorMu;
+static Reactor *reactor = nullptr;
+
+static Reactor &GetReactor()
+{
+    std::lock_guard<std::mutex> lock(reactorMu);
+    if (!reactor)
+        reactor = StartReactor();
+    return *reactor;
+}
+
+// ── Event data structs ──────────────────────────────────────────────
+
+struct MessageEventData
+{
+    net::Slab *slab = nullptr; // one reference, handed to JS with the buffer
+    size_t offset = 0;
+    size_t length = 0;
+    std::string address;
+    std::string family;
+    int port;
+};
+
+struct ErrorEventData
+{
+    std::string message;
+};
+
+struct EventData
+{
+    enum Type
+    {
+        Message,
+        Batch,
+        Error,
+        Close,
+        SessionReady,
+        SessionData,
+        SessionDrain,
+        SessionClose,
+        Drain
+    } type;
+    MessageEventData msg;
+    ErrorEventData err;
+    std::shared_ptr<SocketEntry> socket;   // whose callback (and, for Batch, pendingBatches)
+    std::shared_ptr<SessionEntry> session; // Session*: which session
+    bool isSuccess = false;                // SessionReady
+    uint32_t credits = 0;                  // Drain
+    std::shared_ptr<net::SocketStats> stats; // set by PostEvent()
+    int64_t postedUs = 0;
+
+    ~EventData()
+    {
+        if (msg.slab)
+            net::SlabPool::release(msg.slab);
+    }
+};
+
+static Napi::Object RemoteInfoToNapi(Napi::Env env, const RemoteInfo &remote)
+{
+    char addr[INET_ADDRSTRLEN] = {0};
+    in_addr in{};
+    in.s_addr = remote.address;
+    inet_ntop(AF_INET, &in, addr, sizeof(addr));
+    auto rinfo = Napi::Object::New(env);
+    rinfo.Set("address", std::string(addr));
+    rinfo.Set("family", "IPv4");
+    rinfo.Set("port", remote.port);
+    return rinfo;
+}
+
+static void DeliverEvent(Napi::Env env, EventData *data)
+{
+    if (data->stats)
+        data->stats->onDelivered(data->postedUs);
+    if (data->socket->callback.IsEmpty())
+    {
+        delete data;
+        return;
+    }
+    Napi::Function callback = data->socket->callback.Value();
+
+    try
+    {
+        switch (data->type)
+        {
+        case EventData::Message:
+        {
+            net::Slab *slab = data->msg.slab;
+            data->msg.slab = nullptr;
+            auto buf = net::SlabToBuffer(env, slab, data->msg.offset, data->msg.length);
+            auto rinfo = Napi::Object::New(env);
+            rinfo.Set("address", data->msg.address);
+            rinfo.Set("family", data->msg.family);
+            rinfo.Set("port", data->msg.port);
+            callback.Call({Napi::String::New(env, "message"), buf, rinfo});
+            break;
+        }
+        case EventData::Batch:
+        {
+            std::vector<MessageBatch> batches;
+            {
+                std::lock_guard<std::mutex> lock(data->socket->batchMu);
+                batches.swap(data->socket->pendingBatches);
+                data->socket->pendingCount = 0;
+                data->socket->batchScheduled = false;
+            }
+            // One call per slab; usually there is just the one
+            for (MessageBatch &batch : batches)
+            {
+                if (batch.table.empty())
+                    continue;
+                net::Slab *slab = batch.slab;
+                batch.slab = nullptr;
+                auto buf = net::SlabToBuffer(env, slab, batch.start, batch.end - batch.start);
+                auto table = Napi::Uint32Array::New(env, batch.table.size());
+                memcpy(table.Data(), batch.table.data(), batch.table.size() * sizeof(uint32_t));
+                auto rinfos = Napi::Array::New(env, batch.remotes.size());
+                for (size_t i = 0; i < batch.remotes.size(); ++i)
+                    rinfos.Set(static_cast<uint32_t>(i), RemoteInfoToNapi(env, batch.remotes[i]));
+                if (!data->socket->isTimestamp)
+                {
+                    callback.Call({Napi::String::New(env, "batch"), buf, table, rinfos});
+                    continue;
+                }
+                auto times = Napi::Float64Array::New(env, batch.times.size());
+                memcpy(times.Data(), batch.times.data(), batch.times.size() * sizeof(double));
+                callback.Call({Napi::String::New(env, "batch"), buf, table, rinfos, times});
+            }
+            break;
+        }
+        case EventData::Error:
+        {
+            callback.Call({Napi::String::New(env, "error"), Napi::String::New(env, data->err.message)});
+            break;
+        }
+        case EventData::Drain:
+        {
+            callback.Call({Napi::String::New(env, "drain"), Napi::Number::New(env, data->credits)});
+            break;
+        }
+        case EventData::Close:
+        {
+            // Last event of the socket: drop the callback here, on the JS thread
+            data->socket->callback.Reset();
+            callback.Call({Napi::String::New(env, "close")});
+            break;
+        }
+        case EventData::SessionReady:
+        {
+            callback.Call({Napi::String::New(env, "sessionReady"), Napi::Number::New(env, data->session->id),
+                           Napi::Boolean::New(env, data->isSuccess)});
+            break;
+        }
+        case EventData::SessionData:
+        {
+            std::vector<uint8_t> payloads[reudp::LANE_COUNT];
+            {
+                std::lock_guard<std::mutex> lock(data->session->dataMu);
+                for (uint8_t lane = 0; lane < reudp::LANE_COUNT; lane++)
+                    payloads[lane].swap(data->session->pendingData[lane]);
+                data->session->dataScheduled = false;
+            }
+            // One call per lane, control first
+            for (uint8_t lane = 0; lane < reudp::LANE_COUNT; lane++)
+            {
+                if (payloads[lane].empty())
+                    continue;
+                // Hand the coalesced payload over as is instead of copying it again
+                auto *owned = new std::vector<uint8_t>(std::move(payloads[lane]));
+                Napi::Buffer<uint8_t> buf;
+                try
+                {
+                    buf = Napi::Buffer<uint8_t>::NewOrCopy(
+                        env, owned->data(), owned->size(),
+                        [](Napi::Env, uint8_t *, std::vector<uint8_t> *p) { delete p; }, owned);
+                }
+                catch (...)
+                {
+                    delete owned;
+                    throw;
+                }
+                callback.Call({Napi::String::New(env, "sessionData"), Napi::Number::New(env, data->session->id), buf,
+                               Napi::Number::New(env, lane)});
+            }
+            break;
+        }
+        case EventData::SessionDrain:
+        {
+            callback.Call({Napi::String::New(env, "sessionDrain"), Napi::Number::New(env, data->session->id)});
+            break;
+        }
+        case EventData::SessionClose:
+        {
+            Napi::Value err = data->err.message.empty() ? env.Null() : Napi::String::New(env, data->err.message);
+            callback.Call({Napi::String::New(env, "sessionClose"), Napi::Number::New(env, data->session->id), err});
+            break;
+        }
+        }
+    }
+    catch (...)
+    {
+    }
+
+    delete data;
+}
+
+// ── Helpers ─────────────────────────────────────────────────────────
+
+static std::string ErrnoMessage(const char *what, int err)
+{
+    return std::string(what) + ": " + strerror(err);
+}
+
+// Queue an event for the JS thread, counted in the socket's stats until it
+// runs. Takes ownership of `evt`; false if the environment is gone.
+static bool PostEvent(SocketEntry *sp, EventData *evt)
+{
+    if (!evt->socket)
+        evt->socket = sp->shared_from_this();
+    evt->stats = sp->stats;
+    evt->postedUs = net::MonotonicUs();
+    sp->stats->onPosted();
+    if (sp->dispatcher->post(evt))
+        return true;
+    sp->stats->onPostFailed();
+    return false;
+}
+
+static void PostError(SocketEntry *sp, const std::string &message)
+{
+    auto *evt = new EventData();
+    evt->type = EventData::Error;
+    evt->err.message = message;
+    PostEvent(sp, evt);
+}
+
+// Credits left in the send queue; sessions may push it past capacity (sendMu held)
+static size_t SendCredits(const SocketEntry *sp)
+{
+    return sp->sendQueue.size() < SEND_QUEUE_CAPACITY ? SEND_QUEUE_CAPACITY - sp->sendQueue.size() : 0;
+}
+
+static void SignalReactor(Reactor &r)
+{
+    uint64_t one = 1;
+    ssize_t n = write(r.wakeFd, &one, sizeof(one));
+    (void)n; // EAGAIN means the counter is already non-zero, which is all we need
+}
+
+// Have the I/O thread look at `sp` on its next iteration (sends, sessions,
+// close). Wakes collapse: only the first since the reactor last took the
+// list signals it, and a socket is listed once.
+static void Wake(SocketEntry *sp)
+{
+    Reactor &r = *sp->reactor;
+    bool signal;
+    {
+        std::lock_guard<std::mutex> lock(r.mu);
+        if (sp->isWakePending || sp->isDetached)
+            return;
+        sp->isWakePending = true;
+        signal = r.woken.empty();
+        r.woken.push_back(sp->shared_from_this());
+    }
+    if (signal)
+        SignalReactor(r);
+}
+
+static int64_t NowMs()
+{
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// SO_TIMESTAMPNS's clock
+static int64_t RealtimeNs()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Packet size sessions found for each peer address (network byte order), and when
+struct PathMtu
+{
+    size_t size;
+    int64_t at;
+};
+static std::mutex pathMtuMu;
+static std::unordered_map<in_addr_t, PathMtu> pathMtus;
+
+// What a session to `address` should probe first; 0 if nothing recent
+static size_t CachedPathMtu(in_addr_t address, int64_t now)
+{
+    std::lock_guard<std::mutex> lock(pathMtuMu);
+    auto it = pathMtus.find(address);
+    if (it == pathMtus.end())
+        return 0;
+    if (now - it->second.at > PATH_MTU_CACHE_MS)
+    {
+        pathMtus.erase(it);
+        return 0;
+    }
+    return it->second.size;
+}
+
+// Largest datagram the route to `address` (network byte order) takes
+// without fragmenting: its interface MTU, or less if the kernel learned a
+// smaller path MTU. 0 if there's no route.
+static size_t RouteMaxDatagram(in_addr_t address)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return 0;
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = address;
+    to.sin_port = htons(9); // connect() on UDP only picks the route
+    int mtu = 0;
+    socklen_t len = sizeof(mtu);
+    bool isKnown = connect(fd, reinterpret_cast<sockaddr *>(&to), sizeof(to)) == 0 &&
+                   getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) == 0;
+    close(fd);
+    return isKnown && mtu > static_cast<int>(IPV4_UDP_HEADERS) ? mtu - IPV4_UDP_HEADERS : 0;
+}
+
+// The base size after a black hole forgets the peer's
+static void RememberPathMtu(in_addr_t address, size_t size, int64_t now)
+{
+    std::lock_guard<std::mutex> lock(pathMtuMu);
+    if (size > reudp::BASE_PACKET_SIZE)
+        pathMtus[address] = {size, now};
+    else
+        pathMtus.erase(address);
+}
+
+static void PostSessionEvent(SocketEntry *sp, SessionEntry *se, EventData::Type type,
+                             bool isSuccess = false, const std::string &message = std::string())
+{
+    auto *evt = new EventData();
+    evt->type = type;
+    evt->session = se->shared_from_this();
+    evt->isSuccess = isSuccess;
+    evt->err.message = message;
+    PostEvent(sp, evt);
+}
+
+// EPOLLOUT is only armed while a flush is waiting on it: edge-triggered,
+// it would otherwise fire each time the kernel frees send buffer space
+static void SetWritableInterest(SocketEntry *sp, bool enable)
+{
+    if (sp->wantWritable == enable)
+        return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET | (enable ? uint32_t(EPOLLOUT) : 0u);
+    ev.data.ptr = sp;
+    epoll_ctl(sp->reactor->epollFd, EPOLL_CTL_MOD, sp->fd, &ev);
+    CountSyscall(sp->reactor);
+    sp->wantWritable = enable;
+}
+
+// ── I/O thread ──────────────────────────────────────────────────────
+
+// One JS call per datagram, matching DatagramWin's default event shape
+static void PostMessages(SocketEntry *sp)
+{
+    for (const RecvPacket &pkt : sp->recvPackets)
+    {
+        if (pkt.isConsumed)
+            continue;
+        const sockaddr_in &from = sp->recvAddrs[pkt.msgIndex];
+
+        auto *evt = new EventData();
+        evt->type = EventData::Message;
+        net::SlabPool::retain(sp->recvSlab);
+        evt->msg.slab = sp->recvSlab;
+        evt->msg.offset = pkt.offset;
+        evt->msg.length = pkt.length;
+
+        char addr[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &from.sin_addr, addr, sizeof(addr));
+        evt->msg.address = addr;
+        evt->msg.family = "IPv4";
+        evt->msg.port = ntohs(from.sin_port);
+
+        PostEvent(sp, evt);
+    }
+}
+
+// Batch mode: append one recvmmsg() round to the pending batch and make
+// sure exactly one JS call is queued to pick it up. Only the table is
+// written; the datagrams stay where recvmmsg() put them.
+static void QueueBatch(const std::shared_ptr<SocketEntry> &sp)
+{
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(sp->batchMu);
+        auto &batches = sp->pendingBatches;
+        for (const RecvPacket &pkt : sp->recvPackets)
+        {
+            if (pkt.isConsumed)
+                continue;
+            if (sp->pendingCount >= MAX_BATCH_DATAGRAMS)
+            {
+                net::SocketStats::add(sp->stats->batchDrops);
+                continue;
+            }
+            if (batches.empty() || batches.back().slab != sp->recvSlab)
+                batches.emplace_back(sp->recvSlab, pkt.offset);
+            batches.back().append(pkt.offset, pkt.length, sp->recvAddrs[pkt.msgIndex], pkt.arrivalNs);
+            sp->pendingCount++;
+        }
+        if (!sp->batchScheduled && sp->pendingCount > 0)
+            schedule = sp->batchScheduled = true;
+    }
+    if (!schedule)
+        return;
+
+    auto *evt = new EventData();
+    evt->type = EventData::Batch;
+    evt->socket = sp;
+    if (!PostEvent(sp.get(), evt))
+    {
+        std::lock_guard<std::mutex> lock(sp->batchMu);
+        sp->batchScheduled = false;
+    }
+}
+
+// Decide on a datagram from a session's peer that hasn't shown it receives
+// at the address it sends from; true lets it through to the engine. A HELLO
+// echoing the cookie we made for its source validates the session. Where
+// openSession() allowed a peer older than cookies (v8), which can't echo
+// one, its HELLO or HELLO_ACK does too; what the packet claims to be never
+// decides that. The peer's own challenge to us goes through (the engine
+// rate-limits its answers). Anything else is answered with a cookie, never
+// longer than what it answers, and dropped.
+static bool ScreenPeer(SocketEntry *sp, SessionEntry *se, const RecvPacket &pkt, const sockaddr_in &from, int64_t now)
+{
+    const uint8_t *data = sp->recvSlab->data.get() + pkt.offset;
+    const uint16_t port = ntohs(from.sin_port);
+    reudp::HandshakeInfo handshake;
+    if (reudp::ReadHandshake(data, pkt.length, handshake) &&
+        ((se->isLegacyPeer && handshake.version < reudp::COOKIE_VERSION) ||
+         (handshake.hasCookie && sp->floodGuard.isValidCookie(handshake.cookie, from.sin_addr.s_addr, port, now))))
+    {
+        se->isValidated = true;
+        return true;
+    }
+    if (pkt.length >= reudp::HEADER_SIZE && data[0] == reudp::FLAG_COOKIE)
+        return true;
+    if (pkt.length < reudp::HEADER_SIZE)
+        return false;
+
+    OutgoingDatagram dgram;
+    dgram.data.resize(reudp::HEADER_SIZE);
+    reudp::WriteCookie(dgram.data.data(), sp->floodGuard.cookie(from.sin_addr.s_addr, port, now));
+    dgram.dest = from;
+    {
+        std::lock_guard<std::mutex> lock(sp->sendMu);
+        sp->sendQueue.push_back(std::move(dgram));
+    }
+    net::SocketStats::add(sp->stats->challenged);
+    return false;
+}
+
+// Hand datagrams from a session's peer to its engine, and drop those from
+// peers the filter doesn't know. Same acceptance rule as ReDatagram: the
+// port must match and the address must be one of the peer's known
+// addresses (each pair has its sessionIndex entry), which then becomes the
+// send target. Until the peer is validated (ScreenPeer()) its datagrams
+// first pass the socket's flood guard.
+static void RouteByPeer(SocketEntry *sp, int64_t now)
+{
+    if (sp->sessionIndex.empty() && !sp->peerFilter)
+        return;
+    // Kernel timestamps are wall-clock; sessions run on NowMs()
+    const int64_t realtimeNs = sp->isTimestamp ? RealtimeNs() : 0;
+    for (RecvPacket &pkt : sp->recvPackets)
+    {
+        const sockaddr_in &from = sp->recvAddrs[pkt.msgIndex];
+        uint64_t key = PeerKey(from.sin_addr.s_addr, ntohs(from.sin_port));
+        auto it = sp->sessionIndex.find(key);
+        if (it != sp->sessionIndex.end() && !it->second->isDone)
+        {
+            SessionEntry *se = it->second;
+            pkt.isConsumed = true;
+            if (!se->isValidated)
+            {
+                if (!sp->floodGuard.admit(from.sin_addr.s_addr, now))
+                {
+                    net::SocketStats::add(sp->stats->shed);
+                    continue;
+                }
+                if (!ScreenPeer(sp, se, pkt, from, now))
+                    continue;
+            }
+            se->remote.sin_addr = from.sin_addr;
+            int64_t arrivedAt = pkt.arrivalNs > 0 ? now - (realtimeNs - pkt.arrivalNs) / 1000000 : -1;
+            se->engine->onPacket(sp->recvSlab->data.get() + pkt.offset, pkt.length, now, pkt.ecn, arrivedAt);
+        }
+        else if (sp->peerFilter && !sp->peerFilter->count(key))
+        {
+            net::SocketStats::add(sp->stats->filtered);
+            pkt.isConsumed = true;
+        }
+    }
+}
+
+// Ancillary data of a received entry: the GRO segment size (0 if the kernel
+// did not coalesce it), its ECN field and arrival time, and the socket's
+// drop counter when it is non-zero
+static int ReadRecvControl(SocketEntry *sp, const msghdr &hdr, uint8_t &ecn, int64_t &arrivalNs)
+{
+    int segment = 0;
+    for (cmsghdr *cm = CMSG_FIRSTHDR(&hdr); cm; cm = CMSG_NXTHDR(const_cast<msghdr *>(&hdr), cm))
+    {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+        {
+            memcpy(&segment, CMSG_DATA(cm), sizeof(segment));
+        }
+        else if (cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_TOS)
+        {
+            ecn = *CMSG_DATA(cm) & reudp::ECN_MASK; // one byte on receive
+        }
+        else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_TIMESTAMPNS)
+        {
+            timespec ts{};
+            memcpy(&ts, CMSG_DATA(cm), sizeof(ts));
+            arrivalNs = static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+        else if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SO_RXQ_OVFL)
+        {
+            uint32_t drops = 0;
+            memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+            net::SocketStats::raise(sp->stats->kernelDrops, drops); // running total since the socket opened
+            sp->kernelDropTotal = drops;
+        }
+    }
+    return segment;
+}
+
+// Ask for a `size`-byte kernel buffer: the FORCE option goes past
+// net.core.{r,w}mem_max where the process may (CAP_NET_ADMIN), else the
+// kernel clamps to it. Returns getsockopt()'s answer, twice the size in
+// effect (the kernel's bookkeeping).
+static int SetSocketBuffer(int fd, int option, int forceOption, int size)
+{
+    if (setsockopt(fd, SOL_SOCKET, forceOption, &size, sizeof(size)) != 0)
+        setsockopt(fd, SOL_SOCKET, option, &size, sizeof(size));
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    getsockopt(fd, SOL_SOCKET, option, &actual, &len);
+    return actual;
+}
+
+// A buffer that came out smaller than asked for is clamped: asking for more
+// won't grow it, so autotuning leaves it be from then on
+static void SetRecvBuffer(SocketEntry *sp, int size)
+{
+    int actual = SetSocketBuffer(sp->fd, SO_RCVBUF, SO_RCVBUFFORCE, size);
+    sp->recvBufferSize = actual / 2;
+    sp->isRecvBufferClamped = sp->recvBufferSize < size;
+    net::SocketStats::raise(sp->stats->recvBuffer, static_cast<uint64_t>(actual));
+}
+
+static void SetSendBuffer(SocketEntry *sp, int size)
+{
+    int actual = SetSocketBuffer(sp->fd, SO_SNDBUF, SO_SNDBUFFORCE, size);
+    sp->sendBufferSize = actual / 2;
+    sp->isSendBufferClamped = sp->sendBufferSize < size;
+    net::SocketStats::raise(sp->stats->sendBuffer, static_cast<uint64_t>(actual));
+}
+
+static bool CanGrowRecvBuffer(const SocketEntry *sp) { return !sp->isRecvBufferClamped && sp->recvBufferSize < sp->maxBufferSize; }
+static bool CanGrowSendBuffer(const SocketEntry *sp) { return !sp->isSendBufferClamped && sp->sendBufferSize < sp->maxBufferSize; }
+
+// Smallest doubling of `size` that holds `target`, within the socket's cap
+static int GrownBufferSize(const SocketEntry *sp, int size, size_t target)
+{
+    size_t grown = static_cast<size_t>(size);
+    while (grown < target && grown < static_cast<size_t>(sp->maxBufferSize))
+        grown *= 2;
+    return static_cast<int>(std::min(grown, static_cast<size_t>(sp->maxBufferSize)));
+}
+
+// Grow both kernel buffers to twice what the socket's sessions may have in
+// flight (`windowBytes`: cwnd × packet size, summed), so a full window and
+// the burst after it fit between reactor wakeups. Never shrinks them.
+static void TuneBuffers(SocketEntry *sp, size_t windowBytes)
+{
+    size_t target = 2 * windowBytes;
+    if (target > static_cast<size_t>(sp->sendBufferSize) && CanGrowSendBuffer(sp))
+        SetSendBuffer(sp, GrownBufferSize(sp, sp->sendBufferSize, target));
+    if (target > static_cast<size_t>(sp->recvBufferSize) && CanGrowRecvBuffer(sp))
+        SetRecvBuffer(sp, GrownBufferSize(sp, sp->recvBufferSize, target));
+}
+
+// The kernel dropped datagrams for want of receive buffer since the last
+// look. Double the buffer (at most every BUFFER_GROW_INTERVAL_MS) and, while
+// it can still grow, have the sessions report the drops to their peers, so
+// these losses are not taken for congestion on the path. Once it is at the
+// cap or the kernel clamps it, more drops are congestion like any other.
+// The kernel doesn't say whose datagrams they were: every session hears of
+// all of them.
+static void HandleKernelDrops(SocketEntry *sp, int64_t now)
+{
+    uint32_t fresh = sp->kernelDropTotal - sp->seenKernelDrops;
+    sp->seenKernelDrops = sp->kernelDropTotal;
+    if (!CanGrowRecvBuffer(sp))
+        return;
+    if (now - sp->lastRecvGrowth >= BUFFER_GROW_INTERVAL_MS)
+    {
+        sp->lastRecvGrowth = now;
+        SetRecvBuffer(sp, GrownBufferSize(sp, sp->recvBufferSize, static_cast<size_t>(sp->recvBufferSize) * 2));
+        if (sp->isRecvBufferClamped)
+            return;
+    }
+    for (auto &se : sp->activeSessions)
+        se->engine->onLocalDrops(fresh);
+}
+
+// Make room for a `slotSize` datagram in the socket's receive slab
+static void EnsureRecvRoom(SocketEntry *sp, size_t slotSize)
+{
+    if (sp->recvSlab && sp->recvSlab->available() >= slotSize)
+        return;
+    if (sp->recvSlab)
+        net::SlabPool::release(sp->recvSlab);
+    sp->recvSlab = sp->isGro ? GroSlabs().acquire() : RecvSlabs().acquire();
+}
+
+// Split, count, route and deliver `n` received entries: recvMsgs[i] and
+// recvAddrs[i] describe entry i, whose bytes start at recvOffsets[i]
+static void DeliverReceived(const std::shared_ptr<SocketEntry> &sp, int n)
+{
+    sp->recvPackets.clear();
+    uint64_t bytes = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        const msghdr &hdr = sp->recvMsgs[i].msg_hdr;
+        uint8_t ecn = reudp::ECN_NOT_ECT;
+        int64_t arrivalNs = 0;
+        int segmentSize = hdr.msg_controllen > 0 ? ReadRecvControl(sp.get(), hdr, ecn, arrivalNs) : 0;
+        // Larger than a slot: not ours, or a path MTU probe too big to take; the tail is lost
+        if (hdr.msg_flags & MSG_TRUNC)
+        {
+            net::SocketStats::add(sp->stats->truncated);
+            continue;
+        }
+        size_t offset = sp->recvOffsets[i];
+        uint32_t len = sp->recvMsgs[i].msg_len;
+        bytes += len;
+        uint32_t segment = static_cast<uint32_t>(segmentSize);
+        if (segment == 0 || segment >= len)
+        {
+            sp->recvPackets.push_back({offset, len, i, false, ecn, arrivalNs});
+            continue;
+        }
+        for (uint32_t at = 0; at < len; at += segment)
+            sp->recvPackets.push_back({offset + at, std::min(segment, len - at), i, false, ecn, arrivalNs});
+    }
+    net::SocketStats::add(sp->stats->packetsReceived, sp->recvPackets.size());
+    net::SocketStats::add(sp->stats->bytesReceived, bytes);
+
+    int64_t now = NowMs();
+    if (sp->kernelDropTotal != sp->seenKernelDrops)
+        HandleKernelDrops(sp.get(), now);
+    RouteByPeer(sp.get(), now);
+    if (sp->batchMode)
+        QueueBatch(sp);
+    else
+        PostMessages(sp.get());
+}
+
+// Receive until the kernel queue is empty or this socket has had its share
+// of the iteration. Returns false in the latter case: the socket is
+// edge-triggered, so no new event will come for what is left behind.
+static bool DrainReceive(const std::shared_ptr<SocketEntry> &sp)
+{
+    const size_t slotSize = sp->isGro ? GRO_SLOT_SIZE : RECV_SLOT_SIZE;
+    for (int round = 0; round < MAX_RECV_ROUNDS; ++round)
+    {
+        if (sp->isClosed)
+            return true;
+        // Receive straight into the next free slots of the current slab
+        EnsureRecvRoom(sp.get(), slotSize);
+        size_t base = sp->recvSlab->used;
+        int slots = static_cast<int>(std::min<size_t>(RECV_BATCH, sp->recvSlab->available() / slotSize));
+        for (int i = 0; i < slots; ++i)
+        {
+            sp->recvOffsets[i] = base + i * slotSize;
+            sp->recvIov[i].iov_base = sp->recvSlab->data.get() + sp->recvOffsets[i];
+            sp->recvIov[i].iov_len = slotSize;
+            msghdr &hdr = sp->recvMsgs[i].msg_hdr;
+            memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &sp->recvAddrs[i];
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_iov = &sp->recvIov[i];
+            hdr.msg_iovlen = 1;
+            if (sp->isGro || sp->isRxqOvfl || sp->isEcn || sp->isTimestamp)
+            {
+                hdr.msg_control = sp->recvCtrl[i];
+                hdr.msg_controllen = sizeof(sp->recvCtrl[i]);
+            }
+        }
+
+        int n = recvmmsg(sp->fd, sp->recvMsgs, slots, MSG_DONTWAIT, nullptr);
+        CountSyscall(sp->reactor);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                PostError(sp.get(), ErrnoMessage("Receive failed", errno));
+            return true;
+        }
+        if (n == 0)
+            return true;
+        // Later slots went unused; the next round starts right after the last datagram
+        sp->recvSlab->used = std::min(sp->recvSlab->capacity,
+                                      (base + (n - 1) * slotSize + sp->recvMsgs[n - 1].msg_len + 7) & ~size_t(7));
+        DeliverReceived(sp, n);
+
+        // A short batch means the kernel queue is empty
+        if (n < slots)
+            return true;
+    }
+    return false;
+}
+
+// Whether `d` can extend a GSO run: same peer and ECN field, and the run's
+// segment size (only the final segment may be shorter)
+static bool JoinsGsoRun(const OutgoingDatagram &first, const OutgoingDatagram &last, const OutgoingDatagram &d,
+                        size_t count, size_t bytes)
+{
+    return count < MAX_GSO_SEGMENTS && bytes + d.data.size() <= MAX_GSO_BYTES &&
+           last.data.size() == first.data.size() && d.data.size() <= first.data.size() && !d.data.empty() &&
+           d.dest.sin_addr.s_addr == first.dest.sin_addr.s_addr && d.dest.sin_port == first.dest.sin_port &&
+           d.ecn == first.ecn;
+}
+
+// Fill up to SEND_BATCH sendMsgs entries from pending[idx...]; with GSO an
+// entry carries a whole run of same-sized datagrams to one peer as a single
+// super-buffer. Returns the entry count.
+static int BuildSendBatch(SocketEntry *sp, std::deque<OutgoingDatagram> &pending, size_t idx)
+{
+    int count = 0;
+    size_t iovUsed = 0;
+    for (size_t next = idx; next < pending.size() && count < SEND_BATCH; ++count)
+    {
+        OutgoingDatagram &first = pending[next];
+        size_t span = 1;
+        size_t bytes = first.data.size();
+        if (sp->isGso)
+        {
+            while (next + span < pending.size() &&
+                   JoinsGsoRun(first, pending[next + span - 1], pending[next + span], span, bytes))
+                bytes += pending[next + span++].data.size();
+        }
+
+        iovec *iov = &sp->sendIov[iovUsed];
+        for (size_t k = 0; k < span; ++k)
+        {
+            iov[k].iov_base = pending[next + k].data.data();
+            iov[k].iov_len = pending[next + k].data.size();
+        }
+        iovUsed += span;
+
+        msghdr &hdr = sp->sendMsgs[count].msg_hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_name = &first.dest;
+        hdr.msg_namelen = sizeof(sockaddr_in);
+        hdr.msg_iov = iov;
+        hdr.msg_iovlen = span;
+        sp->sendBytes[count] = bytes;
+        sp->sendEcn[count] = sp->isEcn ? first.ecn : reudp::ECN_NOT_ECT;
+        if (span > 1 || sp->sendEcn[count] != reudp::ECN_NOT_ECT)
+        {
+            memset(sp->sendCtrl[count], 0, sizeof(sp->sendCtrl[count]));
+            hdr.msg_control = sp->sendCtrl[count];
+            hdr.msg_controllen = sizeof(sp->sendCtrl[count]);
+            size_t used = 0;
+            cmsghdr *cm = CMSG_FIRSTHDR(&hdr);
+            if (span > 1)
+            {
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t segment = static_cast<uint16_t>(first.data.size());
+                memcpy(CMSG_DATA(cm), &segment, sizeof(segment));
+                used += CMSG_SPACE(sizeof(uint16_t));
+                cm = CMSG_NXTHDR(&hdr, cm);
+            }
+            if (sp->sendEcn[count] != reudp::ECN_NOT_ECT)
+            {
+                cm->cmsg_level = IPPROTO_IP;
+                cm->cmsg_type = IP_TOS;
+                cm->cmsg_len = CMSG_LEN(sizeof(int));
+                int tos = sp->sendEcn[count];
+                memcpy(CMSG_DATA(cm), &tos, sizeof(tos));
+                used += CMSG_SPACE(sizeof(int));
+            }
+            hdr.msg_controllen = used;
+        }
+        sp->sendSpan[count] = span;
+        next += span;
+    }
+    return count;
+}
+
+// Post drain once send() ran out of credits and the queue fell below SEND_LOW_WATER
+static void PostDrainIfWanted(SocketEntry *sp)
+{
+    uint32_t credits = 0;
+    {
+        std::lock_guard<std::mutex> lock(sp->sendMu);
+        if (!sp->drainWanted || sp->sendQueue.size() > SEND_LOW_WATER)
+            return;
+        sp->drainWanted = false;
+        credits = static_cast<uint32_t>(SendCredits(sp));
+    }
+    auto *evt = new EventData();
+    evt->type = EventData::Drain;
+    evt->credits = credits;
+    PostEvent(sp, evt);
+}
+
+// The kernel refused send entry `index` as too big for its route with DF
+// set. Past the base size that is a probe, or a packet size the route no
+// longer takes: the session it came from learns so at once. At the base
+// size DF itself is in the way (a tunnel narrower than 1328 bytes, say):
+// the socket lets the kernel fragment from now on, and its sessions stop
+// probing. Returns true if the entry should go out again as it is.
+static bool HandleSendTooBig(SocketEntry *sp, int index)
+{
+    const msghdr &hdr = sp->sendMsgs[index].msg_hdr;
+    const size_t size = hdr.msg_iov[0].iov_len;
+    const int64_t now = NowMs();
+    if (size > reudp::BASE_PACKET_SIZE)
+    {
+        const auto *dest = static_cast<const sockaddr_in *>(hdr.msg_name);
+        auto it = sp->sessionIndex.find(PeerKey(dest->sin_addr.s_addr, ntohs(dest->sin_port)));
+        if (it != sp->sessionIndex.end() && !it->second->isDone)
+            it->second->engine->onSendTooBig(size, now);
+        return false;
+    }
+    if (!sp->isDontFragment)
+        return false;
+    int pmtuWant = IP_PMTUDISC_WANT;
+    if (setsockopt(sp->fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtuWant, sizeof(pmtuWant)) != 0)
+        return false;
+    sp->isDontFragment = false;
+    for (auto &se : sp->activeSessions)
+        se->engine->disableMtuProbing();
+    return true;
+}
+
+static void FlushSends(SocketEntry *sp)
+{
+    std::deque<OutgoingDatagram> pending;
+    {
+        std::lock_guard<std::mutex> lock(sp->sendMu);
+        pending.swap(sp->sendQueue);
+    }
+
+    size_t idx = 0;
+    while (idx < pending.size())
+    {
+        int count = BuildSendBatch(sp, pending, idx);
+        int sent = sendmmsg(sp->fd, sp->sendMsgs, count, MSG_DONTWAIT);
+        CountSyscall(sp->reactor);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // Kernel buffer full: put the rest back in front of anything
+                // queued meanwhile and retry once the socket is writable.
+                std::lock_guard<std::mutex> lock(sp->sendMu);
+                sp->sendQueue.insert(sp->sendQueue.begin(),
+                                     std::make_move_iterator(pending.begin() + idx),
+                                     std::make_move_iterator(pending.end()));
+                SetWritableInterest(sp, true);
+                return;
+            }
+            if (sp->sendSpan[0] > 1 && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP || errno == EMSGSIZE))
+            {
+                // The route can't segment for us after all, or not segments
+                // this big (which only fragmenting can send); resend one by one
+                sp->isGso = false;
+                continue;
+            }
+            if (sp->sendEcn[0] != reudp::ECN_NOT_ECT && errno == EINVAL)
+            {
+                // No IP_TOS on send: go on unmarked, and sessions stop marking once the peer reports no ECN
+                sp->isEcn = false;
+                continue;
+            }
+            if (errno == EMSGSIZE && HandleSendTooBig(sp, 0))
+                continue;
+            // Per-datagram failure (unreachable host, ENOBUFS, ...). Like a lost
+            // packet: drop it and let ReUDP retransmit rather than failing the socket.
+            net::SocketStats::add(sp->stats->sendErrors, sp->sendSpan[0]);
+            idx += sp->sendSpan[0];
+            continue;
+        }
+        for (int i = 0; i < sent; ++i)
+        {
+            idx += sp->sendSpan[i];
+            net::SocketStats::add(sp->stats->packetsSent, sp->sendSpan[i]);
+            net::SocketStats::add(sp->stats->bytesSent, sp->sendBytes[i]);
+        }
+    }
+    SetWritableInterest(sp, false);
+    PostDrainIfWanted(sp);
+}
+
+// ── Sessions (I/O thread) ───────────────────────────────────────────
+
+static void StartSession(SocketEntry *sp, SessionEntry *se, int64_t now)
+{
+    reudp::Session::Callbacks cb;
+    cb.transmit = [sp, se](const uint8_t *data, size_t len)
+    {
+        OutgoingDatagram dgram;
+        dgram.data.assign(data, data + len);
+        dgram.dest = se->remote;
+        dgram.ecn = se->engine->ecnCodepoint();
+        std::lock_guard<std::mutex> lock(sp->sendMu);
+        sp->sendQueue.push_back(std::move(dgram));
+    };
+    cb.deliver = [sp, se](const uint8_t *data, size_t len, uint8_t lane)
+    {
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(se->dataMu);
+            std::vector<uint8_t> &pending = se->pendingData[lane];
+            size_t at = pending.size();
+            pending.insert(pending.end(), data, data + len);
+            se->recvFrames[lane].apply(pending.data() + at, len);
+            if (!se->dataScheduled)
+                schedule = se->dataScheduled = true;
+        }
+        if (schedule)
+            PostSessionEvent(sp, se, EventData::SessionData);
+    };
+    cb.ready = [sp, se](bool isSuccess)
+    {
+        PostSessionEvent(sp, se, EventData::SessionReady, isSuccess);
+    };
+    cb.closed = [sp, se](const std::string &error)
+    {
+        se->isDone = true;
+        PostSessionEvent(sp, se, EventData::SessionClose, false, error);
+    };
+    se->engine->setCallbacks(std::move(cb));
+    if (sp->isDontFragment)
+    {
+        size_t routeMax = RouteMaxDatagram(se->remote.sin_addr.s_addr);
+        se->engine->enableMtuProbing(CachedPathMtu(se->remote.sin_addr.s_addr, now), routeMax ? routeMax : reudp::MAX_PACKET_SIZE);
+    }
+    if (sp->isEcn)
+        se->engine->enableEcn();
+    se->engine->start(now);
+}
+
+// Index a session under each of its peer's endpoints. An endpoint already
+// taken stays with the older session, as with the linear match it replaces.
+static void IndexSession(SocketEntry *sp, SessionEntry *se)
+{
+    for (in_addr_t address : se->allowedAddresses)
+        sp->sessionIndex.emplace(PeerKey(address, se->port), se);
+}
+
+// Take over and start sessions opened since the last iteration, and a new
+// peer filter, before any receive, so the peer's first packets already
+// find them
+static void AdoptSessions(SocketEntry *sp)
+{
+    std::vector<std::shared_ptr<SessionEntry>> added;
+    {
+        std::lock_guard<std::mutex> lock(sp->sessionMu);
+        if (sp->isPeerFilterChanged)
+        {
+            sp->peerFilter = std::move(sp->newPeerFilter);
+            sp->isPeerFilterChanged = false;
+        }
+        if (sp->addedSessions.empty())
+            return;
+        added.swap(sp->addedSessions);
+    }
+    int64_t now = NowMs();
+    for (auto &se : added)
+    {
+        StartSession(sp, se.get(), now);
+        IndexSession(sp, se.get());
+        sp->activeSessions.push_back(std::move(se));
+    }
+}
+
+// Feed queued sends and close requests to each engine, run due timers and
+// push out what became deliverable. Called once per I/O loop iteration.
+static void RunSessions(SocketEntry *sp)
+{
+    if (sp->activeSessions.empty())
+        return;
+
+    int64_t now = NowMs();
+    bool anyDone = false;
+    size_t windowBytes = 0;
+    for (auto &se : sp->activeSessions)
+    {
+        std::deque<SessionEntry::Outgoing> inbox;
+        bool closeRequested;
+        {
+            std::lock_guard<std::mutex> lock(se->inboxMu);
+            inbox.swap(se->inbox);
+            closeRequested = se->closeRequested;
+            // A key also covers frames queued just before it, but those are
+            // handshake frames, which stay in the clear either way
+            for (uint8_t lane = 0; lane < reudp::LANE_COUNT; lane++)
+            {
+                if (!se->newSendKey.empty())
+                    se->sendFrames[lane].setKey(se->newSendKey.data(), se->newSendKey.data() + net::AesCtr::KEY_SIZE, lane);
+                if (!se->newRecvKey.empty())
+                    se->recvFrames[lane].setKey(se->newRecvKey.data(), se->newRecvKey.data() + net::AesCtr::KEY_SIZE, lane);
+            }
+            se->newSendKey.clear();
+            se->newRecvKey.clear();
+        }
+        for (auto &out : inbox)
+        {
+            // Encrypt on the lane the engine will really send it on
+            se->sendFrames[se->engine->laneFor(out.lane)].apply(out.data.data(), out.data.size());
+            se->engine->send(std::move(out.data), now, out.lane);
+        }
+        if (closeRequested)
+            se->engine->close(now);
+        se->engine->poll(now);
+        se->engine->flush();
+
+        reudp::SessionStats stats = se->engine->stats();
+        {
+            std::lock_guard<std::mutex> lock(se->statsMu);
+            se->stats = stats;
+        }
+        if (stats.mtu != se->reportedMtu)
+        {
+            se->reportedMtu = stats.mtu;
+            RememberPathMtu(se->remote.sin_addr.s_addr, stats.mtu, now);
+        }
+
+        uint64_t sent = stats.bytesSent;
+        size_t packetized = static_cast<size_t>(sent - se->reportedBytesSent);
+        se->reportedBytesSent = sent;
+        size_t backlog = se->backlog.fetch_sub(packetized) - packetized;
+        if ((backlog < SESSION_LOW_WATER || se->isDone) && se->drainWanted.exchange(false))
+            PostSessionEvent(sp, se.get(), EventData::SessionDrain);
+
+        windowBytes += static_cast<size_t>(stats.cwnd * stats.mtu);
+        anyDone |= se->isDone;
+    }
+    TuneBuffers(sp, windowBytes);
+    if (!anyDone)
+        return;
+
+    std::lock_guard<std::mutex> lock(sp->sessionMu);
+    auto &active = sp->activeSessions;
+    for (auto &se : active)
+    {
+        if (se->isDone)
+            sp->sessions.erase(se->id);
+    }
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [](const std::shared_ptr<SessionEntry> &se) { return se->isDone; }),
+                 active.end());
+    // Endpoints a finished session held may belong to a later one
+    sp->sessionIndex.clear();
+    for (auto &se : active)
+        IndexSession(sp, se.get());
+}
+
+// Earliest session timer of the socket, NO_TIMEOUT if none
+static int64_t SessionDeadline(SocketEntry *sp)
+{
+    int64_t next = reudp::NO_TIMEOUT;
+    for (auto &se : sp->activeSessions)
+        next = std::min(next, se->engine->nextTimeout());
+    return next;
+}
+
+// Have the reactor service `sp` in this iteration
+static void QueueReady(Reactor *r, SocketEntry *sp)
+{
+    if (!sp->isQueued)
+    {
+        sp->isQueued = true;
+        r->ready.push_back(sp->shared_from_this());
+    }
+}
+
+// ── io_uring backend (I/O thread) ───────────────────────────────────
+
+#if NET_HAS_URING
+
+// Read of the eventfd; re-armed on every completion
+static void ArmWake(Reactor *r)
+{
+    io_uring_sqe *sqe = r->ring->sqe();
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = r->wakeFd;
+    sqe->addr = reinterpret_cast<uint64_t>(&r->wakeCount);
+    sqe->len = sizeof(r->wakeCount);
+    sqe->off = static_cast<uint64_t>(-1);
+    sqe->user_data = reinterpret_cast<uint64_t>(&r->wakeOp);
+}
+
+// One multishot RECVMSG per socket; it completes once per datagram, each
+// in a buffer the kernel picks from the reactor's provided-buffer ring
+static void ArmReceive(SocketEntry *sp)
+{
+    io_uring_sqe *sqe = sp->reactor->ring->sqe();
+    if (!sqe)
+        return;
+    sp->uringRecvHdr.msg_namelen = sizeof(sockaddr_in);
+    sp->uringRecvHdr.msg_controllen = (sp->isGro || sp->isRxqOvfl || sp->isEcn || sp->isTimestamp) ? RECV_CTRL_SIZE : 0;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sp->fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&sp->uringRecvHdr);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = reinterpret_cast<uint64_t>(&sp->recvOp);
+    sp->isRecvArmed = true;
+    sp->uringOps++;
+}
+
+// Deliver the entries staged from receive completions so far
+static void ReceiveStaged(const std::shared_ptr<SocketEntry> &sp)
+{
+    int n = sp->recvStaged;
+    sp->recvStaged = 0;
+    if (n == 0 || sp->isClosed)
+        return;
+    // Sessions opened since the socket's last pass must see their peer's first packets
+    AdoptSessions(sp.get());
+    DeliverReceived(sp, n);
+}
+
+// Copy a received datagram out of its ring buffer (`bytes` long, as laid
+// out by the kernel) into the socket's slab as the next recvMsgs entry, so
+// the ring buffer can go straight back. Datagrams are packed back to back
+// rather than into fixed slots. A full round is delivered on the spot.
+static void StageDatagram(SocketEntry *sp, const uint8_t *buf, int bytes)
+{
+    const size_t slotSize = sp->isGro ? GRO_SLOT_SIZE : RECV_SLOT_SIZE;
+    if (sp->recvStaged == RECV_BATCH || !sp->recvSlab || sp->recvSlab->available() < slotSize)
+    {
+        ReceiveStaged(sp->shared_from_this());
+        EnsureRecvRoom(sp, slotSize);
+    }
+
+    io_uring_recvmsg_out out;
+    memcpy(&out, buf, sizeof(out));
+    const uint8_t *name = buf + sizeof(out);
+    const uint8_t *control = name + sp->uringRecvHdr.msg_namelen;
+    const uint8_t *payload = control + sp->uringRecvHdr.msg_controllen;
+    size_t inBuffer = static_cast<size_t>(std::max<ptrdiff_t>(0, buf + bytes - payload));
+
+    int k = sp->recvStaged++;
+    memset(&sp->recvAddrs[k], 0, sizeof(sp->recvAddrs[k]));
+    memcpy(&sp->recvAddrs[k], name, std::min<size_t>(out.namelen, sizeof(sockaddr_in)));
+    msghdr &hdr = sp->recvMsgs[k].msg_hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_control = sp->recvCtrl[k];
+    hdr.msg_controllen = std::min<size_t>(out.controllen, RECV_CTRL_SIZE);
+    memcpy(sp->recvCtrl[k], control, hdr.msg_controllen);
+    hdr.msg_flags = static_cast<int>(out.flags);
+    // Same size limit as a recvmmsg() slot
+    if (out.payloadlen > slotSize || inBuffer < out.payloadlen)
+        hdr.msg_flags |= MSG_TRUNC;
+
+    size_t len = (hdr.msg_flags & MSG_TRUNC) ? 0 : out.payloadlen;
+    net::Slab *slab = sp->recvSlab;
+    sp->recvOffsets[k] = slab->used;
+    memcpy(slab->data.get() + slab->used, payload, len);
+    sp->recvMsgs[k].msg_len = static_cast<unsigned>(len);
+    slab->used = std::min(slab->capacity, (slab->used + len + 7) & ~size_t(7));
+}
+
+static void OnReceive(Reactor *r, SocketEntry *sp, const io_uring_cqe &cqe)
+{
+    // Without F_MORE the receive has ended (ENOBUFS, cancelled, error); the
+    // socket's next pass re-arms it
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        sp->isRecvArmed = false;
+        sp->uringOps--;
+    }
+    if (cqe.flags & IORING_CQE_F_BUFFER)
+    {
+        auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res >= 0 && !sp->isDetaching)
+            StageDatagram(sp, r->ring->buffer(id), cqe.res);
+        r->ring->recycle(id);
+    }
+    else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED && !sp->isClosed)
+    {
+        PostError(sp, ErrnoMessage("Receive failed", -cqe.res));
+    }
+}
+
+// Submit the next batch of queued sends as one chain of linked SENDMSG, so
+// the datagrams leave in queue order. One chain per socket is in flight at a
+// time; the socket's next pass after it completes submits the following one.
+static void SubmitSends(SocketEntry *sp)
+{
+    if (sp->flightEntries > 0)
+        return;
+    if (sp->flightIdx >= sp->sendFlight.size())
+    {
+        // Everything taken so far is out: same drain point as FlushSends()
+        sp->sendFlight.clear();
+        sp->flightIdx = 0;
+        PostDrainIfWanted(sp);
+        std::lock_guard<std::mutex> lock(sp->sendMu);
+        sp->sendFlight.swap(sp->sendQueue);
+    }
+    if (sp->sendFlight.empty())
+        return;
+
+    net::Uring &ring = *sp->reactor->ring;
+    int count = BuildSendBatch(sp, sp->sendFlight, sp->flightIdx);
+    if (!ring.reserve(count))
+        return;
+    for (int i = 0; i < count; ++i)
+    {
+        io_uring_sqe *sqe = ring.sqe();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = sp->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&sp->sendMsgs[i].msg_hdr);
+        sqe->len = 1;
+        if (i + 1 < count)
+            sqe->flags = IOSQE_IO_LINK;
+        sp->sendOps[i] = {UringOp::Send, sp, i};
+        sqe->user_data = reinterpret_cast<uint64_t>(&sp->sendOps[i]);
+    }
+    sp->uringOps += count;
+    sp->flightEntries = count;
+    sp->flightDone = 0;
+}
+
+// Settle the chain in flight once its last entry completes. A failed entry
+// cancels the rest of the chain (ECANCELED), which goes out again in the next.
+static void OnSendDone(SocketEntry *sp, int index, int res)
+{
+    sp->uringOps--;
+    sp->sendResults[index] = res;
+    if (++sp->flightDone < sp->flightEntries)
+        return;
+
+    int count = sp->flightEntries;
+    sp->flightEntries = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        int result = sp->sendResults[i];
+        if (result >= 0)
+        {
+            sp->flightIdx += sp->sendSpan[i];
+            net::SocketStats::add(sp->stats->packetsSent, sp->sendSpan[i]);
+            net::SocketStats::add(sp->stats->bytesSent, sp->sendBytes[i]);
+            continue;
+        }
+        if (result == -ECANCELED || result == -EAGAIN || result == -EINTR)
+            break;
+        if (sp->sendSpan[i] > 1 && (result == -EIO || result == -EINVAL || result == -EOPNOTSUPP || result == -EMSGSIZE))
+        {
+            // As in FlushSends(): resend the run one by one
+            sp->isGso = false;
+            break;
+        }
+        if (sp->sendEcn[i] != reudp::ECN_NOT_ECT && result == -EINVAL)
+        {
+            sp->isEcn = false;
+            break;
+        }
+        if (result == -EMSGSIZE && HandleSendTooBig(sp, i))
+            break;
+        // Per-datagram failure: dropped like a lost packet
+        net::SocketStats::add(sp->stats->sendErrors, sp->sendSpan[i]);
+        sp->flightIdx += sp->sendSpan[i];
+    }
+}
+
+// Cancel a closing socket's receive so its last completion comes in
+static void CancelReceive(Reactor *r, SocketEntry *sp)
+{
+    io_uring_sqe *sqe = r->ring->sqe();
+    if (!sqe)
+        return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = reinterpret_cast<uint64_t>(&sp->recvOp);
+    sqe->user_data = reinterpret_cast<uint64_t>(&sp->cancelOp);
+    sp->uringOps++;
+    sp->isCancelSent = true;
+}
+
+static void OnCompletion(Reactor *r, const io_uring_cqe &cqe)
+{
+    auto *op = reinterpret_cast<UringOp *>(static_cast<uintptr_t>(cqe.user_data));
+    SocketEntry *sp = op->socket;
+    switch (op->kind)
+    {
+    case UringOp::Wake:
+        // Like the epoll path, the count is consumed before the hand-over
+        // lists are taken, so a Wake() racing with this iteration signals again
+        ArmWake(r);
+        return;
+    case UringOp::Receive:
+        OnReceive(r, sp, cqe);
+        break;
+    case UringOp::Send:
+        OnSendDone(sp, op->index, cqe.res);
+        break;
+    case UringOp::Cancel:
+        sp->uringOps--;
+        break;
+    }
+    if (!sp->isDetaching)
+        QueueReady(r, sp);
+    else if (op->kind == UringOp::Send)
+        SubmitSends(sp); // the rest of its queue still goes out
+}
+
+// Submit what the last iteration queued, wait for completions (or the
+// earliest session timer) and dispatch them. 0 or errno.
+static int UringWait(Reactor *r, int timeoutMs)
+{
+    int err = r->ring->enter(timeoutMs);
+    if (err != 0 && err != ETIME && err != EINTR && err != EBUSY && err != EAGAIN)
+        return err;
+    r->ring->reap([r](const io_uring_cqe &cqe) { OnCompletion(r, cqe); });
+    r->ring->publishBuffers();
+    return 0;
+}
+
+#endif // NET_HAS_URING
+
+// One socket's share of a reactor iteration: whatever epoll or the ring
+// reported for it, what other threads queued (sends, sessions, close) and
+// its session timers.
+static void ServiceSocket(const std::shared_ptr<SocketEntry> &sp)
+{
+    uint32_t events = sp->readyEvents;
+    bool woken = sp->isWoken;
+    sp->readyEvents = 0;
+    sp->isWoken = sp->isQueued = false;
+
+    AdoptSessions(sp.get());
+#if NET_HAS_URING
+    if (sp->reactor->isUring())
+    {
+        ReceiveStaged(sp);
+        if (!sp->isRecvArmed && !sp->isClosed)
+            ArmReceive(sp.get());
+        RunSessions(sp.get());
+        SubmitSends(sp.get());
+        sp->timerDeadlineMs = SessionDeadline(sp.get());
+        return;
+    }
+#endif
+    if (events & EPOLLOUT)
+        FlushSends(sp.get());
+    if (events & (EPOLLIN | EPOLLERR))
+        sp->isReadable = true;
+    if (sp->isReadable)
+        sp->isReadable = !DrainReceive(sp);
+
+    RunSessions(sp.get());
+    // Flush before honouring close so a trailing BYE still goes out
+    bool hasSends;
+    {
+        std::lock_guard<std::mutex> lock(sp->sendMu);
+        hasSends = !sp->sendQueue.empty();
+    }
+    if (hasSends && (woken || !sp->wantWritable))
+        FlushSends(sp.get());
+    sp->timerDeadlineMs = SessionDeadline(sp.get());
+}
+
+// Take a closed socket out of the reactor and let close() go on
+static void DetachSocket(Reactor *r, SocketEntry *sp)
+{
+    if (!r->isUring())
+    {
+        epoll_ctl(r->epollFd, EPOLL_CTL_DEL, sp->fd, nullptr);
+        CountSyscall(r);
+    }
+    auto &list = r->sockets;
+    list.erase(std::remove_if(list.begin(), list.end(),
+                              [sp](const std::shared_ptr<SocketEntry> &e) { return e.get() == sp; }),
+               list.end());
+    {
+        std::lock_guard<std::mutex> lock(r->mu);
+        sp->isDetached = true;
+    }
+    r->detachedCv.notify_all();
+}
+
+// A closed socket's last pass is done. On epoll it leaves at once; on
+// io_uring its receive is cancelled first, and it leaves once the ring has
+// posted the final completion of everything it submitted (the send chain in
+// flight and the rest of the queue go out before that, like a final flush).
+static void RetireSocket(Reactor *r, SocketEntry *sp)
+{
+#if NET_HAS_URING
+    if (r->isUring())
+    {
+        sp->isDetaching = true;
+        sp->recvStaged = 0;
+        if (sp->isRecvArmed)
+            CancelReceive(r, sp);
+        r->detaching++;
+        return;
+    }
+#endif
+    DetachSocket(r, sp);
+}
+
+#if NET_HAS_URING
+// Detach closing sockets the ring is done with
+static void SweepDetaching(Reactor *r)
+{
+    std::vector<SocketEntry *> done;
+    for (auto &sp : r->sockets)
+    {
+        if (!sp->isDetaching)
+            continue;
+        if (sp->uringOps == 0)
+            done.push_back(sp.get());
+        else if (sp->isRecvArmed && !sp->isCancelSent)
+            CancelReceive(r, sp.get());
+    }
+    for (SocketEntry *sp : done)
+    {
+        r->detaching--;
+        DetachSocket(r, sp);
+    }
+}
+#endif
+
+// Reactor wait timeout: until the earliest session timer of any socket,
+// none if a socket still has datagrams waiting, -1 if nothing is due
+static int ReactorTimeout(Reactor *r)
+{
+    int64_t next = reudp::NO_TIMEOUT;
+    for (auto &sp : r->sockets)
+    {
+        if (sp->isReadable)
+            return 0;
+        next = std::min(next, sp->timerDeadlineMs);
+    }
+    if (next == reudp::NO_TIMEOUT)
+        return -1;
+    return static_cast<int>(std::max<int64_t>(0, next - NowMs()));
+}
+
+// Wait for socket events (or the earliest session timer) and queue the
+// sockets they are for. 0 or errno.
+static int EpollWait(Reactor *r, int timeoutMs)
+{
+    epoll_event events[REACTOR_EVENTS];
+    int n = epoll_wait(r->epollFd, events, REACTOR_EVENTS, timeoutMs);
+    CountSyscall(r);
+    if (n < 0)
+        return errno == EINTR ? 0 : errno;
+
+    // Socket events first. The eventfd is read before the hand-over lists
+    // are taken, so a Wake() racing with this iteration signals again.
+    for (int i = 0; i < n; ++i)
+    {
+        auto *sp = static_cast<SocketEntry *>(events[i].data.ptr);
+        if (!sp)
+        {
+            uint64_t count;
+            ssize_t rd = read(r->wakeFd, &count, sizeof(count));
+            (void)rd;
+            CountSyscall(r);
+            continue;
+        }
+        sp->readyEvents |= events[i].events;
+        QueueReady(r, sp);
+    }
+    return 0;
+}
+
+static void ReactorLoop(Reactor *r)
+{
+    std::vector<std::shared_ptr<SocketEntry>> woken;
+#if NET_HAS_URING
+    // Submitted from this thread: completion work runs on the submitter
+    if (r->isUring())
+        ArmWake(r);
+#endif
+
+    while (true)
+    {
+        int err;
+#if NET_HAS_URING
+        if (r->isUring())
+            err = UringWait(r, ReactorTimeout(r));
+        else
+#endif
+            err = EpollWait(r, ReactorTimeout(r));
+        if (err != 0)
+        {
+            std::string message = ErrnoMessage(r->isUring() ? "io_uring_enter failed" : "epoll_wait failed", err);
+            for (auto &sp : r->sockets)
+                PostError(sp.get(), message);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(r->mu);
+            for (auto &sp : r->added)
+            {
+                // Its receive is armed on its first pass
+                if (r->isUring())
+                    QueueReady(r, sp.get());
+                r->sockets.push_back(std::move(sp));
+            }
+            r->added.clear();
+            woken.swap(r->woken);
+            for (auto &sp : woken)
+                sp->isWakePending = false;
+        }
+        for (auto &sp : woken)
+        {
+            if (sp->isDetached || sp->isDetaching)
+                continue;
+            sp->isWoken = true;
+            QueueReady(r, sp.get());
+        }
+        // Leftover datagrams and due session timers
+        int64_t now = NowMs();
+        for (auto &sp : r->sockets)
+        {
+            if (!sp->isDetaching && (sp->isReadable || sp->timerDeadlineMs <= now))
+                QueueReady(r, sp.get());
+        }
+
+        for (auto &sp : r->ready)
+        {
+            bool isClosing = sp->isWoken && sp->isClosed;
+            ServiceSocket(sp);
+            if (isClosing)
+                RetireSocket(r, sp.get());
+        }
+        r->ready.clear();
+        woken.clear();
+#if NET_HAS_URING
+        if (r->detaching > 0)
+            SweepDetaching(r);
+#endif
+    }
+}
+
+// ── Shutdown ────────────────────────────────────────────────────────
+
+// Waits for the reactor's final pass over the socket (which flushes its
+// sends), after which the I/O thread no longer touches it
+static void ShutdownSocket(SocketEntry *entry)
+{
+    entry->isClosed = true;
+    if (entry->isRegistered)
+    {
+        Reactor &r = *entry->reactor;
+        Wake(entry);
+        std::unique_lock<std::mutex> lock(r.mu);
+        r.detachedCv.wait(lock, [entry] { return entry->isDetached; });
+    }
+
+    if (entry->fd >= 0)
+        close(entry->fd);
+    entry->fd = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(entry->sendMu);
+        entry->sendQueue.clear();
+    }
+    entry->sendFlight.clear();
+    if (entry->recvSlab)
+    {
+        net::SlabPool::release(entry->recvSlab);
+        entry->recvSlab = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(entry->sessionMu);
+    entry->sessions.clear();
+    entry->addedSessions.clear();
+    entry->activeSessions.clear();
+    entry->sessionIndex.clear();
+    entry->peerFilter.reset();
+    entry->newPeerFilter.reset();
+}
+
+// Detaches the socket from the I/O thread when the Node environment goes
+// away without close() (app quit). Registered per socket after the shared
+// dispatcher's hook: cleanup hooks run in reverse order, so this runs before
+// Node tears the dispatcher's TSFN down.
+static void ShutdownOnExit(void *arg)
+{
+    auto *entry = static_cast<SocketEntry *>(arg);
+    std::lock_guard<std::mutex> lock(entry->mu);
+    if (!entry->isClosed)
+        ShutdownSocket(entry);
+    entry->callback.Reset();
+}
+
+// Socket and per-socket kernel features; errno on failure
+static int OpenSocket(SocketEntry *sp)
+{
+    sp->fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sp->fd < 0)
+        return errno;
+    int on = 1;
+
+    // Segmentation offloads (Linux 4.18 / 5.0+). GSO is per send, so only
+    // probe for it; GRO is switched on for the socket.
+    int gsoSize = 0;
+    socklen_t gsoLen = sizeof(gsoSize);
+    sp->isGso = getsockopt(sp->fd, SOL_UDP, UDP_SEGMENT, &gsoSize, &gsoLen) == 0;
+    sp->isGro = setsockopt(sp->fd, SOL_UDP, UDP_GRO, &on, sizeof(on)) == 0;
+    sp->isRxqOvfl = setsockopt(sp->fd, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on)) == 0;
+    sp->isTimestamp = setsockopt(sp->fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+    int pmtuProbe = IP_PMTUDISC_PROBE;
+    sp->isDontFragment = setsockopt(sp->fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtuProbe, sizeof(pmtuProbe)) == 0;
+    sp->isEcn = setsockopt(sp->fd, IPPROTO_IP, IP_RECVTOS, &on, sizeof(on)) == 0;
+    // Room for LAN-speed bursts between reactor wakeups; RunSessions() grows
+    // them from there as the sessions' windows open
+    SetRecvBuffer(sp, std::min(SOCKET_BUFFER_SIZE, sp->maxBufferSize));
+    SetSendBuffer(sp, std::min(SOCKET_BUFFER_SIZE, sp->maxBufferSize));
+    if (sp->isGro)
+        sp->recvPackets.reserve(RECV_BATCH * (GRO_SLOT_SIZE / 512));
+    else
+        sp->recvPackets.reserve(RECV_BATCH);
+    return 0;
+}
+
+// Hand the socket to its reactor. Sends before bind() implicitly bind to an
+// ephemeral port, so sockets join from createSocket() rather than bind().
+static void RegisterSocket(const std::shared_ptr<SocketEntry> &sp)
+{
+    Reactor &r = *sp->reactor;
+    if (r.isUring())
+    {
+        // The ring waits for readiness itself; on O_NONBLOCK sockets some
+        // kernels fail its requests with EAGAIN instead
+        fcntl(sp->fd, F_SETFL, fcntl(sp->fd, F_GETFL) & ~O_NONBLOCK);
+    }
+    else
+    {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = sp.get();
+        epoll_ctl(r.epollFd, EPOLL_CTL_ADD, sp->fd, &ev);
+    }
+    {
+        std::lock_guard<std::mutex> lock(r.mu);
+        r.added.push_back(sp);
+        sp->isRegistered = true;
+    }
+    SignalReactor(r);
+}
+
+// ── createSocket(callback, options?) → handle ──────────────────────
+
+Napi::Value CreateSocket(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsFunction())
+    {
+        Napi::TypeError::New(env, "Expected callback function").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    bool batchMode = false;
+    int maxBufferSize = MAX_SOCKET_BUFFER_SIZE;
+    if (info.Length() >= 2 && info[1].IsObject())
+    {
+        auto options = info[1].As<Napi::Object>();
+        batchMode = options.Has("batch") && options.Get("batch").ToBoolean().Value();
+        if (options.Has("maxBuffer") && options.Get("maxBuffer").IsNumber())
+        {
+            int64_t maxBuffer = options.Get("maxBuffer").As<Napi::Number>().Int64Value();
+            maxBufferSize = static_cast<int>(std::clamp<int64_t>(maxBuffer, 64 * 1024, INT32_MAX / 2));
+        }
+    }
+
+    Reactor &reactor = GetReactor();
+    if (reactor.startError)
+    {
+        Napi::Error::New(env, ErrnoMessage("Failed to start I/O thread", reactor.startError))
+            .ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto entry = std::make_shared<SocketEntry>();
+    entry->maxBufferSize = maxBufferSize;
+    entry->reactor = &reactor;
+    entry->batchMode = batchMode;
+    int err = OpenSocket(entry.get());
+    if (err != 0)
+    {
+        ShutdownSocket(entry.get());
+        Napi::Error::New(env, ErrnoMessage("Failed to create socket", err)).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Events go through the environment's shared queue to this callback
+    entry->dispatcher = Dispatcher::ForEnv(env, "DatagramLinuxCallback");
+    entry->callback = Napi::Persistent(info[0].As<Napi::Function>());
+    napi_add_env_cleanup_hook(env, ShutdownOnExit, entry.get());
+
+    uint32_t handle;
+    {
+        std::lock_guard<std::mutex> lock(globalMu);
+        handle = nextHandle++;
+        sockets[handle] = entry;
+    }
+
+    RegisterSocket(entry);
+
+    return Napi::Number::New(env, handle);
+}
+
+// ── bind(handle, port?) → { address, family, port } ────────────────
+
+Napi::Value Bind(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected handle").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    auto entry = GetSocket(handle);
+    if (!entry || entry->isClosed)
+    {
+        Napi::Error::New(env, "Invalid socket handle").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    int port = 0;
+    if (info.Length() >= 2 && info[1].IsNumber())
+        port = info[1].As<Napi::Number>().Int32Value();
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(entry->fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        Napi::Error::New(env, ErrnoMessage("Bind failed", errno)).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    // Read back the actual bound port
+    socklen_t len = sizeof(addr);
+    getsockname(entry->fd, reinterpret_cast<sockaddr *>(&addr), &len);
+
+    entry->localAddress = "0.0.0.0";
+    entry->localFamily = "IPv4";
+    entry->localPort = ntohs(addr.sin_port);
+    entry->isBound = true;
+
+    auto result = Napi::Object::New(env);
+    result.Set("address", entry->localAddress);
+    result.Set("family", entry->localFamily);
+    result.Set("port", entry->localPort);
+    return result;
+}
+
+// ── send(handle, data, port, address) ──────────────────────────────
+
+Napi::Value Send(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 4)
+    {
+        Napi::TypeError::New(env, "Expected (handle, data, port, address)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    auto entry = GetSocket(handle);
+    if (!entry || entry->isClosed)
+    {
+        Napi::Error::New(env, "Socket is closed or invalid").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // Get data
+    uint8_t *dataPtr = nullptr;
+    size_t dataLen = 0;
+    if (info[1].IsBuffer())
+    {
+        auto buf = info[1].As<Napi::Buffer<uint8_t>>();
+        dataPtr = buf.Data();
+        dataLen = buf.Length();
+    }
+    else if (info[1].IsTypedArray())
+    {
+        auto arr = info[1].As<Napi::TypedArray>();
+        dataPtr = static_cast<uint8_t *>(arr.ArrayBuffer().Data()) + arr.ByteOffset();
+        dataLen = arr.ByteLength();
+    }
+    else
+    {
+        Napi::TypeError::New(env, "Expected Buffer or Uint8Array for data").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int port = info[2].As<Napi::Number>().Int32Value();
+    std::string address = info[3].As<Napi::String>().Utf8Value();
+
+    OutgoingDatagram dgram;
+    memset(&dgram.dest, 0, sizeof(dgram.dest));
+    dgram.dest.sin_family = AF_INET;
+    dgram.dest.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address.c_str(), &dgram.dest.sin_addr) != 1)
+    {
+        Napi::TypeError::New(env, "Expected a numeric IPv4 address").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool wasEmpty;
+    size_t credits;
+    {
+        std::lock_guard<std::mutex> lock(entry->sendMu);
+        if (SendCredits(entry.get()) == 0)
+        {
+            // Full: nothing queued, JS retries on drain
+            entry->drainWanted = true;
+            net::SocketStats::add(entry->stats->sendFull);
+            return Napi::Number::New(env, -1);
+        }
+        dgram.data.assign(dataPtr, dataPtr + dataLen);
+        wasEmpty = entry->sendQueue.empty();
+        entry->sendQueue.push_back(std::move(dgram));
+        credits = SendCredits(entry.get());
+        if (credits == 0)
+            entry->drainWanted = true;
+    }
+    // The I/O thread drains the whole queue per wakeup, so only the first
+    // datagram of a burst needs to signal it.
+    if (wasEmpty)
+        Wake(entry.get());
+
+    return Napi::Number::New(env, static_cast<double>(credits));
+}
+
+// ── address(handle) → { address, family, port } ────────────────────
+
+Napi::Value Address(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    auto entry = GetSocket(handle);
+    if (!entry)
+    {
+        Napi::Error::New(env, "Invalid socket handle").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto result = Napi::Object::New(env);
+    result.Set("address", entry->localAddress);
+    result.Set("family", entry->localFamily);
+    result.Set("port", entry->localPort);
+    return result;
+}
+
+// ── close(handle) ──────────────────────────────────────────────────
+
+Napi::Value Close(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    auto entry = GetSocket(handle);
+    if (!entry)
+        return env.Undefined();
+
+    {
+        std::lock_guard<std::mutex> lock(entry->mu);
+        if (entry->isClosed)
+            return env.Undefined();
+        ShutdownSocket(entry.get());
+    }
+
+    // Notify JS of close, after anything the I/O thread posted before it
+    auto *evt = new EventData();
+    evt->type = EventData::Close;
+    if (!PostEvent(entry.get(), evt))
+        entry->callback.Reset();
+
+    napi_remove_env_cleanup_hook(env, ShutdownOnExit, entry.get());
+
+    RemoveSocket(handle);
+
+    return env.Undefined();
+}
+
+// ── openSession(handle, { addresses, port, lan, legacyPeer? }) → sessionId
+
+Napi::Value OpenSession(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsObject())
+    {
+        Napi::TypeError::New(env, "Expected (handle, options)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    uint32_t handle = info[0].As<Napi::Number>().Uint32Value();
+    auto entry = GetSocket(handle);
+    if (!entry || entry->isClosed)
+    {
+        Napi::Error::New(env, "Socket is closed or invalid").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto options = info[1].As<Napi::Object>();
+    Napi::Value addresses = options.Get("addresses");
+    Napi::Value port = options.Get("port");
+    if (!addresses.IsArray() || addresses.As<Napi::Array>().Length() == 0 || !port.IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected { addresses: string[], port: number }").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto session = std::make_shared<SessionEntry>();
+    auto list = addresses.As<Napi::Array>();
+    for (uint32_t i = 0; i < list.Length(); ++i)
+    {
+        in_addr addr{};
+        std::string text = list.Get(i).ToString().Utf8Value();
+        if (inet_pton(AF_INET, text.c_str(), &addr) != 1)
+        {
+            Napi::TypeError::New(env, "Expected a numeric IPv4 address").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        session->allowedAddresses.push_back(addr.s_addr);
+    }
+    session->port = static_cast<uint16_t>(port.As<Napi::Number>().Uint32Value());
+    session->remote.sin_family = AF_INET;
+    session->remote.sin_port = htons(session->port);
+    session->remote.sin_addr.s_addr = session->allowedAddresses[0];
+
+    bool isLan = options.Has("lan") && options.Get("lan").ToBoolean().Value();
+    session->isLegacyPeer = options.Has("legacyPeer") && options.Get("legacyPeer").ToBoolean().Value();
+    session->engine = std::make_unique<reudp::Session>(isLan ? reudp::LAN_PROFILE : reudp::WAN_PROFILE);
+
+    {
+        std::lock_guard<std::mutex> lock(entry->sessionMu);
+        session->id = entry->nextSessionId++;
+        entry->sessions[session->id] = session;
+        entry->addedSessions.push_back(session);
+    }
+    Wake(entry.get());
+
+    return Napi::Number::New(env, session->id);
+}
+
+static std::shared_ptr<SessionEntry> GetSession(SocketEntry *sp, uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(sp->sessionMu);
+    auto it = sp->sessions.find(id);
+    if (it != sp->sessions.end())
+        return it->second;
+    return nullptr;
+}
+
+// ── sessionSend(handle, sessionId, data, lane?) → boolean ──────────
+
+Napi::Value SessionSend(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsTypedArray())
+    {
+        Napi::TypeError::New(env, "Expected (handle, sessionId, data, lane?)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    auto session = entry ? GetSession(entry.get(), info[1].As<Napi::Number>().Uint32Value()) : nullptr;
+    if (!session || entry->isClosed)
+    {
+        Napi::Error::New(env, "Session is closed or invalid").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    auto arr = info[2].As<Napi::TypedArray>();
+    const uint8_t *dataPtr = static_cast<const uint8_t *>(arr.ArrayBuffer().Data()) + arr.ByteOffset();
+    size_t dataLen = arr.ByteLength();
+    if (dataLen == 0)
+        return Napi::Boolean::New(env, true);
+    uint32_t lane = info.Length() > 3 && info[3].IsNumber() ? info[3].As<Napi::Number>().Uint32Value() : reudp::LANE_CONTROL;
+    if (lane >= reudp::LANE_COUNT)
+    {
+        Napi::RangeError::New(env, "Unknown lane").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(session->inboxMu);
+        wasEmpty = session->inbox.empty();
+        session->inbox.push_back({std::vector<uint8_t>(dataPtr, dataPtr + dataLen), static_cast<uint8_t>(lane)});
+    }
+    size_t backlog = session->backlog.fetch_add(dataLen) + dataLen;
+    bool hasRoom = backlog < SESSION_HIGH_WATER;
+    if (!hasRoom)
+        session->drainWanted = true;
+    // Also wake after arming drainWanted, so a backlog that already fell
+    // below the low-water mark still produces the drain event.
+    if (wasEmpty || !hasRoom)
+        Wake(entry.get());
+
+    return Napi::Boolean::New(env, hasRoom);
+}
+
+// ── closeSession(handle, sessionId) ────────────────────────────────
+
+Napi::Value CloseSession(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    auto session = entry ? GetSession(entry.get(), info[1].As<Napi::Number>().Uint32Value()) : nullptr;
+    if (!session)
+        return env.Undefined();
+
+    {
+        std::lock_guard<std::mutex> lock(session->inboxMu);
+        session->closeRequested = true;
+    }
+    Wake(entry.get());
+
+    return env.Undefined();
+}
+
+// ── sessionStats(handle, sessionId) → stats | null ─────────────────
+
+Napi::Value SessionStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    auto session = entry ? GetSession(entry.get(), info[1].As<Napi::Number>().Uint32Value()) : nullptr;
+    if (!session)
+        return env.Null();
+
+    reudp::SessionStats stats;
+    {
+        std::lock_guard<std::mutex> lock(session->statsMu);
+        stats = session->stats;
+    }
+    auto result = Napi::Object::New(env);
+    result.Set("bytesSent", static_cast<double>(stats.bytesSent));
+    result.Set("bytesReceived", static_cast<double>(stats.bytesReceived));
+    result.Set("packetsSent", static_cast<double>(stats.packetsSent));
+    result.Set("packetsReceived", static_cast<double>(stats.packetsReceived));
+    result.Set("retransmits", static_cast<double>(stats.retransmits));
+    result.Set("cwnd", stats.cwnd);
+    result.Set("ssthresh", stats.ssthresh);
+    result.Set("srtt", stats.srtt);
+    result.Set("rto", static_cast<double>(stats.rto));
+    result.Set("inFlight", static_cast<double>(stats.inFlight));
+    result.Set("queuedBytes", static_cast<double>(stats.queuedBytes));
+    result.Set("pacingRate", stats.pacingRate);
+    result.Set("pacingDelays", static_cast<double>(stats.pacingDelays));
+    result.Set("lossRate", stats.lossRate);
+    result.Set("paritySent", static_cast<double>(stats.paritySent));
+    result.Set("fecRecovered", static_cast<double>(stats.fecRecovered));
+    result.Set("mtu", static_cast<double>(stats.mtu));
+    result.Set("bottleneckRate", stats.bottleneckRate);
+    result.Set("minRtt", stats.minRtt);
+    result.Set("isEcn", stats.isEcn);
+    result.Set("ceReported", static_cast<double>(stats.ceReported));
+    result.Set("localDrops", static_cast<double>(stats.localDrops));
+    result.Set("lossesExcused", static_cast<double>(stats.lossesExcused));
+    result.Set("cookiesAnswered", static_cast<double>(stats.cookiesAnswered));
+    return result;
+}
+
+// ── setSessionCipher(handle, sessionId, direction, key, iv) ────────
+
+Napi::Value SetSessionCipher(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsString() ||
+        !info[3].IsTypedArray() || !info[4].IsTypedArray())
+    {
+        Napi::TypeError::New(env, "Expected (handle, sessionId, direction, key, iv)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string direction = info[2].As<Napi::String>().Utf8Value();
+    auto key = info[3].As<Napi::TypedArray>();
+    auto iv = info[4].As<Napi::TypedArray>();
+    if ((direction != "send" && direction != "recv") || key.ByteLength() != net::AesCtr::KEY_SIZE ||
+        iv.ByteLength() != net::AesCtr::IV_SIZE)
+    {
+        Napi::TypeError::New(env, "Expected 'send' | 'recv', a 32-byte key and a 16-byte IV").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    auto session = entry ? GetSession(entry.get(), info[1].As<Napi::Number>().Uint32Value()) : nullptr;
+    if (!session || entry->isClosed)
+    {
+        Napi::Error::New(env, "Session is closed or invalid").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const uint8_t *keyPtr = static_cast<const uint8_t *>(key.ArrayBuffer().Data()) + key.ByteOffset();
+    const uint8_t *ivPtr = static_cast<const uint8_t *>(iv.ArrayBuffer().Data()) + iv.ByteOffset();
+    {
+        std::lock_guard<std::mutex> lock(session->inboxMu);
+        std::vector<uint8_t> &slot = direction == "send" ? session->newSendKey : session->newRecvKey;
+        slot.assign(keyPtr, keyPtr + net::AesCtr::KEY_SIZE);
+        slot.insert(slot.end(), ivPtr, ivPtr + net::AesCtr::IV_SIZE);
+    }
+    Wake(entry.get());
+
+    return env.Undefined();
+}
+
+// ── setPeerFilter(handle, peers | null) ────────────────────────────
+
+Napi::Value SetPeerFilter(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !(info[1].IsArray() || info[1].IsNull()))
+    {
+        Napi::TypeError::New(env, "Expected (handle, peers | null)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    if (!entry || entry->isClosed)
+    {
+        Napi::Error::New(env, "Socket is closed or invalid").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::shared_ptr<PeerSet> filter;
+    if (info[1].IsArray())
+    {
+        filter = std::make_shared<PeerSet>();
+        auto peers = info[1].As<Napi::Array>();
+        for (uint32_t i = 0; i < peers.Length(); ++i)
+        {
+            Napi::Value peer = peers.Get(i);
+            Napi::Value addresses = peer.IsObject() ? peer.As<Napi::Object>().Get("addresses") : env.Undefined();
+            Napi::Value port = peer.IsObject() ? peer.As<Napi::Object>().Get("port") : env.Undefined();
+            if (!addresses.IsArray() || !port.IsNumber())
+            {
+                Napi::TypeError::New(env, "Expected { addresses: string[], port: number }").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            auto list = addresses.As<Napi::Array>();
+            for (uint32_t j = 0; j < list.Length(); ++j)
+            {
+                in_addr addr{};
+                std::string text = list.Get(j).ToString().Utf8Value();
+                if (inet_pton(AF_INET, text.c_str(), &addr) != 1)
+                {
+                    Napi::TypeError::New(env, "Expected a numeric IPv4 address").ThrowAsJavaScriptException();
+                    return env.Undefined();
+                }
+                filter->insert(PeerKey(addr.s_addr, static_cast<uint16_t>(port.As<Napi::Number>().Uint32Value())));
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(entry->sessionMu);
+        entry->newPeerFilter = filter;
+        entry->isPeerFilterChanged = true;
+    }
+    Wake(entry.get());
+
+    return env.Undefined();
+}
+
+// ── getStats(handle) → stats | null ────────────────────────────────
+
+Napi::Value GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    if (!entry)
+        return env.Null();
+
+    size_t sendQueue, pendingDatagrams;
+    {
+        std::lock_guard<std::mutex> lock(entry->sendMu);
+        sendQueue = entry->sendQueue.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(entry->batchMu);
+        pendingDatagrams = entry->pendingCount;
+    }
+    return net::SocketStatsToNapi(env, *entry->stats, sendQueue, pendingDatagrams, entry->isRxqOvfl);
+}
+
+// ── isDontFragment(handle) → boolean ───────────────────────────────
+
+Napi::Value IsDontFragment(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    if (!entry)
+        return Napi::Boolean::New(env, false);
+    return Napi::Boolean::New(env, entry->isDontFragment.load());
+}
+
+// ── maxDatagramSize(handle, address) → number ───────────────────────
+
+Napi::Value MaxDatagramSize(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[1].IsString())
+    {
+        Napi::TypeError::New(env, "Expected (handle, address)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    in_addr addr{};
+    if (inet_pton(AF_INET, info[1].As<Napi::String>().Utf8Value().c_str(), &addr) != 1)
+        return Napi::Number::New(env, 0);
+    return Napi::Number::New(env, static_cast<double>(RouteMaxDatagram(addr.s_addr)));
+}
+
+// ── release(buffer) ────────────────────────────────────────────────
+
+Napi::Value Release(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() >= 1)
+        net::ReleaseSlabBuffer(info[0]);
+    return env.Undefined();
+}
+
+// ── setBackend('io_uring' | 'epoll') → void ───────────────────────
+
+// Backend for the I/O thread, which runs until the process exits: this only
+// takes effect when called before the first socket.
+Napi::Value SetBackend(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    std::string backend = info.Length() >= 1 && info[0].IsString() ? info[0].As<Napi::String>().Utf8Value() : "";
+    if (backend != "io_uring" && backend != "epoll")
+    {
+        Napi::TypeError::New(env, "Expected 'io_uring' or 'epoll'").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    preferUring = backend == "io_uring";
+    return env.Undefined();
+}
+
+// ── reactorStats() → { backend, syscalls, cpuMs } ─────────────────
+
+// The process's I/O thread: its backend (null before the first socket),
+// the syscalls it made and the CPU time it used
+Napi::Value ReactorStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    std::lock_guard<std::mutex> lock(reactorMu);
+    uint64_t syscalls = 0;
+    double cpuMs = 0;
+    auto result = Napi::Object::New(env);
+    if (reactor && !reactor->startError)
+    {
+        result.Set("backend", reactor->isUring() ? "io_uring" : "epoll");
+        syscalls = reactor->syscalls.load(std::memory_order_relaxed);
+#if NET_HAS_URING
+        if (reactor->ring)
+            syscalls += reactor->ring->enterCount();
+#endif
+        timespec ts{};
+        if (reactor->hasCpuClock && clock_gettime(reactor->cpuClock, &ts) == 0)
+            cpuMs = ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+    }
+    else
+        result.Set("backend", env.Null());
+    result.Set("syscalls", static_cast<double>(syscalls));
+    result.Set("cpuMs", cpuMs);
+    return result;
+}
+
+// ── Module init ─────────────────────────────────────────────────────
+
+Napi::Object Init(Napi::Env env, Napi::Object exports)
+{
+    exports.Set("createSocket", Napi::Function::New(env, CreateSocket));
+    exports.Set("bind", Napi::Function::New(env, Bind));
+    exports.Set("send", Napi::Function::New(env, Send));
+    exports.Set("address", Napi::Function::New(env, Address));
+    exports.Set("close", Napi::Function::New(env, Close));
+    exports.Set("openSession", Napi::Function::New(env, OpenSession));
+    exports.Set("sessionSend", Napi::Function::New(env, SessionSend));
+    exports.Set("closeSession", Napi::Function::New(env, CloseSession));
+    exports.Set("sessionStats", Napi::Function::New(env, SessionStats));
+    exports.Set("setSessionCipher", Napi::Function::New(env, SetSessionCipher));
+    exports.Set("setPeerFilter", Napi::Function::New(env, SetPeerFilter));
+    exports.Set("getStats", Napi::Function::New(env, GetStats));
+    exports.Set("isDontFragment", Napi::Function::New(env, IsDontFragment));
+    exports.Set("maxDatagramSize", Napi::Function::New(env, MaxDatagramSize));
+    exports.Set("release", Napi::Function::New(env, Release));
+    exports.Set("setBackend", Napi::Function::New(env, SetBackend));
+    exports.Set("reactorStats", Napi::Function::New(env, ReactorStats));
+    return exports;
+}
+
+NODE_API_MODULE(DatagramLinux, Init)
@@ -6,8 +6,17 @@
 #include <winrt/Windows.Networking.Sockets.h>
 #include <winrt/Windows.Storage.Streams.h>
 #include <string>
+#include <cstring>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include "net/EventDispatcher.h"
+#include "net/SlabBuffer.h"
+#include "net/SocketStats.h"
 
 using namespace winrt;
 using namespace Windows::Foundation;
@@ -22,31 +31,134 @@ using namespace Windows::Storage::Streams;
  * MSIX AppContainer network capabilities (internetClientServer,
  * privateNetworkClientServer) unlike Win32 Winsock (Node.js dgram).
  *
+ * Threading: datagrams arrive on the system thread pool; send() only queues,
+ * and one sender thread takes turns over every socket doing the WinRT
+ * writes. Events from all sockets reach JS through one shared queue
+ * (net/EventDispatcher.h).
+ *
  * Exposes:
- *   createSocket() -> handle
+ *   createSocket(callback, options?: { batch?: boolean }) -> handle
  *   bind(handle, port?) -> { address, family, port }
- *   send(handle, data, port, address) -> void
+ *   send(handle, data, port, address) -> credits   (-1: queue full, wait for drain)
  *   close(handle) -> void
  *   address(handle) -> { address, family, port }
+ *   getStats(handle) -> { packets/bytes, drops, queue depths, handoff latency } | null   (net/SocketStats.h)
+ *   release(buffer) -> void   (hand a received buffer's memory back now)
  *
- * Events via ThreadSafeFunction:
+ * Events, through the environment's shared ThreadSafeFunction:
  *   onMessage(msg: Buffer, rinfo: { address, family, port })
+ *   onBatch(data: Buffer, table: Uint32Array, rinfos: rinfo[])   (batch mode; table: [offset, length, rinfoIndex] per datagram)
  *   onError(err: string)
  *   onClose()
+ *   onDrain(credits)   (send queue has room again after send() ran out of credits)
  */
 
-struct SocketEntry
+static constexpr size_t MAX_BATCH_DATAGRAMS = 8192; // JS is stalled past this; drop like a full socket buffer
+static constexpr size_t RECV_SLAB_SIZE = 256 * 1024; // holds any datagram; ~200 ReUDP packets
+static constexpr size_t MAX_IDLE_SLABS = 32;          // pooled for reuse, shared by all sockets
+static constexpr size_t SEND_QUEUE_CAPACITY = 4096;   // datagrams send() may queue (~5 MB of ReUDP packets)
+static constexpr size_t SEND_LOW_WATER = SEND_QUEUE_CAPACITY / 4; // drain fires once the queue falls below
+static constexpr size_t SEND_SLICE = 64; // datagrams the sender writes for one socket before moving on
+
+static net::SlabPool &RecvSlabs()
+{
+    // Never destroyed: JS may still hold slab buffers during teardown
+    static auto *pool = new net::SlabPool(RECV_SLAB_SIZE, MAX_IDLE_SLABS);
+    return *pool;
+}
+
+struct OutgoingDatagram
+{
+    std::vector<uint8_t> data;
+    std::string address;
+    int port = 0;
+};
+
+// Datagrams received since the last JS delivery, all from the same slab
+struct MessageBatch
+{
+    net::Slab *slab = nullptr;   // one reference, handed to JS with the batch
+    size_t start = 0;            // slab range covered by the batch
+    size_t end = 0;
+    std::vector<uint32_t> table; // [offset from start, length, rinfo index] per datagram
+    std::vector<std::pair<std::string, int>> remotes;
+
+    MessageBatch(net::Slab *s, size_t offset) : slab(s), start(offset), end(offset)
+    {
+        net::SlabPool::retain(slab);
+    }
+
+    MessageBatch(MessageBatch &&other) noexcept
+        : slab(other.slab), start(other.start), end(other.end),
+          table(std::move(other.table)), remotes(std::move(other.remotes))
+    {
+        other.slab = nullptr;
+    }
+
+    MessageBatch(const MessageBatch &) = delete;
+    MessageBatch &operator=(const MessageBatch &) = delete;
+
+    ~MessageBatch()
+    {
+        if (slab)
+            net::SlabPool::release(slab);
+    }
+
+    size_t count() const { return table.size() / 3; }
+
+    uint32_t remoteIndex(const std::string &address, int port)
+    {
+        // Almost always one or two peers per socket, so a linear scan wins
+        for (size_t i = 0; i < remotes.size(); ++i)
+        {
+            if (remotes[i].second == port && remotes[i].first == address)
+                return static_cast<uint32_t>(i);
+        }
+        remotes.emplace_back(address, port);
+        return static_cast<uint32_t>(remotes.size() - 1);
+    }
+};
+
+struct EventData;
+static void DeliverEvent(Napi::Env env, EventData *data);
+using Dispatcher = net::EventDispatcher<EventData, DeliverEvent>;
+
+struct SocketEntry : std::enable_shared_from_this<SocketEntry>
 {
     DatagramSocket socket{nullptr};
-    Napi::ThreadSafeFunction tsfn;
+    Napi::FunctionReference callback;       // JS thread only; reset once "close" is delivered
+    std::shared_ptr<Dispatcher> dispatcher; // the environment's event queue
     event_token messageToken;
     std::string localAddress;
     std::string localFamily;
     int localPort = 0;
     bool isBound = false;
     bool isClosed = false;
+    bool batchMode = false;
     std::mutex mu;
 
+    // Batch mode: packets accumulate here until the scheduled JS call runs;
+    // a new batch starts whenever reception moves on to a fresh slab
+    std::vector<MessageBatch> pendingBatches;
+    size_t pendingCount = 0;
+    bool batchScheduled = false;
+    std::mutex batchMu;
+
+    // Slab datagrams are currently read into; the socket holds one reference
+    net::Slab *recvSlab = nullptr;
+    std::mutex recvMu;
+
+    // Datagrams queued by send(), written by the shared sender thread
+    std::deque<OutgoingDatagram> sendQueue;
+    bool drainWanted = false; // send() ran out of credits; post drain below SEND_LOW_WATER
+    bool isSendStopping = false;
+    bool isSendScheduled = false; // in the sender's ready list, or being written
+    bool isWriting = false;       // the sender is in a WinRT write for this socket
+    std::mutex sendMu;
+    std::condition_variable sendCv; // signalled when a write finishes
+
+    std::shared_ptr<net::SocketStats> stats = std::make_shared<net::SocketStats>();
+
     // Cached output streams per remote endpoint ("address:port" → stream)
     std::unordered_map<std::string, IOutputStream> outputStreams;
     std::mutex streamMu;
@@ -70,6 +182,12 @@ struct SocketEntry
         std::lock_guard<std::mutex> lock(streamMu);
         outputStreams.clear();
     }
+
+    ~SocketEntry()
+    {
+        if (recvSlab)
+            net::SlabPool::release(recvSlab);
+    }
 };
 
 static std::mutex globalMu;
@@ -95,7 +213,9 @@ static void RemoveSocket(uint32_t handle)
 
 struct MessageEventData
 {
-    std::vector<uint8_t> buffer;
+    net::Slab *slab = nullptr; // one reference, handed to JS with the buffer
+    size_t offset = 0;
+    size_t length = 0;
     std::string address;
     std::string family;
     int port;
@@ -115,17 +235,35 @@ struct EventData
     enum Type
     {
         Message,
+        Batch,
         Error,
-        Close
+        Close,
+        Drain
     } type;
     MessageEventData msg;
     ErrorEventData err;
+    std::shared_ptr<SocketEntry> socket; // whose callback (and, for Batch, pendingBatches)
+    uint32_t credits = 0;                // Drain
+    std::shared_ptr<net::SocketStats> stats; // set by PostEvent()
+    int64_t postedUs = 0;
+
+    ~EventData()
+    {
+        if (msg.slab)
+            net::SlabPool::release(msg.slab);
+    }
 };
 
-static void CallJS(Napi::Env env, Napi::Function callback, EventData *data)
+static void DeliverEvent(Napi::Env env, EventData *data)
 {
-    if (!data)
+    if (data->stats)
+        data->stats->onDelivered(data->postedUs);
+    if (data->socket->callback.IsEmpty())
+    {
+        delete data;
         return;
+    }
+    Napi::Function callback = data->socket->callback.Value();
 
     try
     {
@@ -133,7 +271,9 @@ static void CallJS(Napi::Env env, Napi::Function callback, EventData *data)
         {
         case EventData::Message:
         {
-            auto buf = Napi::Buffer<uint8_t>::Copy(env, data->msg.buffer.data(), data->msg.buffer.size());
+            net::Slab *slab = data->msg.slab;
+            data->msg.slab = nullptr;
+            auto buf = net::SlabToBuffer(env, slab, data->msg.offset, data->msg.length);
             auto rinfo = Napi::Object::New(env);
             rinfo.Set("address", data->msg.address);
             rinfo.Set("family", data->msg.family);
@@ -141,13 +281,52 @@ static void CallJS(Napi::Env env, Napi::Function callback, EventData *data)
             callback.Call({Napi::String::New(env, "message"), buf, rinfo});
             break;
         }
+        case EventData::Batch:
+        {
+            std::vector<MessageBatch> batches;
+            {
+                std::lock_guard<std::mutex> lock(data->socket->batchMu);
+                batches.swap(data->socket->pendingBatches);
+                data->socket->pendingCount = 0;
+                data->socket->batchScheduled = false;
+            }
+            // One call per slab; usually there is just the one
+            for (MessageBatch &batch : batches)
+            {
+                if (batch.table.empty())
+                    continue;
+                net::Slab *slab = batch.slab;
+                batch.slab = nullptr;
+                auto buf = net::SlabToBuffer(env, slab, batch.start, batch.end - batch.start);
+                auto table = Napi::Uint32Array::New(env, batch.table.size());
+                memcpy(table.Data(), batch.table.data(), batch.table.size() * sizeof(uint32_t));
+                auto rinfos = Napi::Array::New(env, batch.remotes.size());
+                for (size_t i = 0; i < batch.remotes.size(); ++i)
+                {
+                    auto rinfo = Napi::Object::New(env);
+                    rinfo.Set("address", batch.remotes[i].first);
+                    rinfo.Set("family", "IPv4");
+                    rinfo.Set("port", batch.remotes[i].second);
+                    rinfos.Set(static_cast<uint32_t>(i), rinfo);
+                }
+                callback.Call({Napi::String::New(env, "batch"), buf, table, rinfos});
+            }
+            break;
+        }
         case EventData::Error:
         {
             callback.Call({Napi::String::New(env, "error"), Napi::String::New(env, data->err.message)});
             break;
         }
+        case EventData::Drain:
+        {
+            callback.Call({Napi::String::New(env, "drain"), Napi::Number::New(env, data->credits)});
+            break;
+        }
         case EventData::Close:
         {
+            // Last event of the socket: drop the callback here, on the JS thread
+            data->socket->callback.Reset();
             callback.Call({Napi::String::New(env, "close")});
             break;
         }
@@ -172,6 +351,95 @@ static std::string WideToUtf8(const std::wstring &wstr)
     return out;
 }
 
+// Queue an event for the JS thread, counted in the socket's stats until it
+// runs. Takes ownership of `evt`; false if the environment is gone.
+static bool PostEvent(SocketEntry *sp, EventData *evt)
+{
+    if (!evt->socket)
+        evt->socket = sp->shared_from_this();
+    evt->stats = sp->stats;
+    evt->postedUs = net::MonotonicUs();
+    sp->stats->onPosted();
+    if (sp->dispatcher->post(evt))
+        return true;
+    sp->stats->onPostFailed();
+    return false;
+}
+
+// Drops the socket's callback when the Node environment goes away without
+// close() (app quit), while it can still be released. Registered after the
+// shared dispatcher's hook, so it runs first.
+static void ReleaseOnExit(void *arg)
+{
+    auto *entry = static_cast<SocketEntry *>(arg);
+    entry->callback.Reset();
+}
+
+// Reads the datagram into the socket's current slab, moving on to a fresh
+// one when it is full. Returns the slab with a reference for the caller.
+static net::Slab *ReadIntoSlab(SocketEntry *sp, const DataReader &reader, uint32_t len, size_t &offset)
+{
+    std::lock_guard<std::mutex> lock(sp->recvMu);
+    if (!sp->recvSlab || sp->recvSlab->available() < len)
+    {
+        if (sp->recvSlab)
+            net::SlabPool::release(sp->recvSlab);
+        sp->recvSlab = RecvSlabs().acquire();
+    }
+    net::Slab *slab = sp->recvSlab;
+    offset = slab->used;
+    if (len > 0)
+        reader.ReadBytes(winrt::array_view<uint8_t>(slab->data.get() + offset, slab->data.get() + offset + len));
+    slab->used += len;
+    net::SlabPool::retain(slab);
+    return slab;
+}
+
+// Batch mode: append one datagram to the pending batch and make sure
+// exactly one JS call is queued to pick it up.
+static void QueueBatch(const std::shared_ptr<SocketEntry> &sp, const DataReader &reader, uint32_t len,
+                       const DatagramSocketMessageReceivedEventArgs &args)
+{
+    std::string address = WideToUtf8(std::wstring(args.RemoteAddress().CanonicalName()));
+    int port = std::stoi(WideToUtf8(std::wstring(args.RemotePort())));
+
+    bool schedule = false;
+    {
+        // Held across the read so a batch's datagrams stay contiguous in the slab
+        std::lock_guard<std::mutex> lock(sp->batchMu);
+        if (sp->pendingCount >= MAX_BATCH_DATAGRAMS)
+        {
+            net::SocketStats::add(sp->stats->batchDrops);
+            return;
+        }
+        size_t offset = 0;
+        net::Slab *slab = ReadIntoSlab(sp.get(), reader, len, offset);
+        auto &batches = sp->pendingBatches;
+        if (batches.empty() || batches.back().slab != slab)
+            batches.emplace_back(slab, offset);
+        net::SlabPool::release(slab);
+        MessageBatch &batch = batches.back();
+        batch.table.push_back(static_cast<uint32_t>(offset - batch.start));
+        batch.table.push_back(len);
+        batch.table.push_back(batch.remoteIndex(address, port));
+        batch.end = offset + len;
+        sp->pendingCount++;
+        if (!sp->batchScheduled)
+            schedule = sp->batchScheduled = true;
+    }
+    if (!schedule)
+        return;
+
+    auto *evt = new EventData();
+    evt->type = EventData::Batch;
+    evt->socket = sp;
+    if (!PostEvent(sp.get(), evt))
+    {
+        std::lock_guard<std::mutex> lock(sp->batchMu);
+        sp->batchScheduled = false;
+    }
+}
+
 // ── createSocket(callback) → handle ─────────────────────────────────
 
 Napi::Value CreateSocket(const Napi::CallbackInfo &info)
@@ -189,16 +457,15 @@ Napi::Value CreateSocket(const Napi::CallbackInfo &info)
         auto entry = std::make_shared<SocketEntry>();
         entry->socket = DatagramSocket();
 
-        // Create thread-safe function for callbacks
-        entry->tsfn = Napi::ThreadSafeFunction::New(
-            env,
-            info[0].As<Napi::Function>(),
-            "DatagramWinCallback",
-            0,               // unlimited queue
-            1,               // one thread
-            [](Napi::Env) {} // weak so the event-loop can exit
-        );
-        entry->tsfn.Unref(env); // Allow process to exit even if socket hasn't been cleaned up
+        if (info.Length() >= 2 && info[1].IsObject())
+        {
+            auto options = info[1].As<Napi::Object>();
+            entry->batchMode = options.Has("batch") && options.Get("batch").ToBoolean().Value();
+        }
+
+        // Events go through the environment's shared queue to this callback
+        entry->dispatcher = Dispatcher::ForEnv(env, "DatagramWinCallback");
+        entry->callback = Napi::Persistent(info[0].As<Napi::Function>());
 
         // Capture a weak_ptr so that the C++/WinRT lambda doesn't prevent cleanup
         std::weak_ptr<SocketEntry> weak = entry;
@@ -214,29 +481,33 @@ Napi::Value CreateSocket(const Napi::CallbackInfo &info)
                 {
                     auto reader = args.GetDataReader();
                     uint32_t len = reader.UnconsumedBufferLength();
+                    net::SocketStats::add(sp->stats->packetsReceived);
+                    net::SocketStats::add(sp->stats->bytesReceived, len);
 
-                    auto *evt = new EventData();
-                    evt->type = EventData::Message;
-                    evt->msg.buffer.resize(len);
-                    if (len > 0)
+                    if (sp->batchMode)
                     {
-                        // Read bytes into our vector
-                        for (uint32_t i = 0; i < len; ++i)
-                            evt->msg.buffer[i] = reader.ReadByte();
+                        QueueBatch(sp, reader, len, args);
+                        return;
                     }
 
+                    auto *evt = new EventData();
+                    evt->type = EventData::Message;
+                    evt->msg.slab = ReadIntoSlab(sp.get(), reader, len, evt->msg.offset);
+                    evt->msg.length = len;
+
                     auto remoteAddress = args.RemoteAddress();
                     auto remotePort = args.RemotePort();
                     evt->msg.address = WideToUtf8(std::wstring(remoteAddress.CanonicalName()));
                     evt->msg.family = "IPv4";
                     evt->msg.port = std::stoi(WideToUtf8(std::wstring(remotePort)));
 
-                    sp->tsfn.BlockingCall(evt, CallJS);
+                    PostEvent(sp.get(), evt);
                 }
                 catch (...)
                 {
                 }
             });
+        napi_add_env_cleanup_hook(env, ReleaseOnExit, entry.get());
 
         uint32_t handle;
         {
@@ -319,7 +590,152 @@ Napi::Value Bind(const Napi::CallbackInfo &info)
     }
 }
 
-// ── send(handle, data, port, address) ──────────────────────────────
+// ── Sender thread ───────────────────────────────────────────────────
+
+static void PostError(SocketEntry *sp, const std::string &message)
+{
+    auto *evt = new EventData();
+    evt->type = EventData::Error;
+    evt->err.message = message;
+    PostEvent(sp, evt);
+}
+
+static bool WriteDatagram(SocketEntry *sp, const OutgoingDatagram &dgram)
+{
+    try
+    {
+        std::string key = dgram.address + ":" + std::to_string(dgram.port);
+        HostName remoteHost(to_hstring(dgram.address));
+        hstring remotePort = to_hstring(dgram.port);
+
+        // Get cached output stream or create one (avoids repeated async calls)
+        auto outputStream = sp->getOrCreateStream(remoteHost, remotePort, key);
+
+        DataWriter writer(outputStream);
+        writer.WriteBytes(winrt::array_view<const uint8_t>(dgram.data.data(), dgram.data.data() + dgram.data.size()));
+
+        writer.StoreAsync().get();
+
+        // Detach so DataWriter doesn't close the cached stream
+        writer.DetachStream();
+        return true;
+    }
+    catch (const hresult_error &e)
+    {
+        // Too big for the route: dropped like a lost packet, the socket is fine
+        if (SocketError::GetStatus(e.code()) != SocketErrorStatus::MessageTooLong)
+            PostError(sp, "Send failed: " + WideToUtf8(e.message().c_str()));
+    }
+    catch (const std::exception &e)
+    {
+        PostError(sp, std::string("Send failed: ") + e.what());
+    }
+    return false;
+}
+
+// Sockets with queued datagrams, served in turn by the one sender thread
+struct SendWorker
+{
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::shared_ptr<SocketEntry>> ready;
+};
+
+static void SendLoop(SendWorker *w);
+
+static SendWorker &GetSendWorker()
+{
+    // Never destroyed: the thread runs until the process exits
+    static SendWorker *worker = []
+    {
+        auto *w = new SendWorker();
+        std::thread(SendLoop, w).detach();
+        return w;
+    }();
+    return *worker;
+}
+
+static void ScheduleSend(const std::shared_ptr<SocketEntry> &sp)
+{
+    SendWorker &w = GetSendWorker();
+    {
+        std::lock_guard<std::mutex> lock(w.mu);
+        w.ready.push_back(sp);
+    }
+    w.cv.notify_one();
+}
+
+// Writes up to SEND_SLICE of the socket's datagrams in order. Returns true if
+// more are waiting; otherwise the socket leaves the schedule (sendMu decides,
+// so a send() racing with this reschedules it).
+static bool WriteSlice(SocketEntry *sp)
+{
+    for (size_t i = 0; i < SEND_SLICE; ++i)
+    {
+        OutgoingDatagram dgram;
+        {
+            std::lock_guard<std::mutex> lock(sp->sendMu);
+            if (sp->isSendStopping || sp->sendQueue.empty())
+            {
+                sp->isSendScheduled = false;
+                return false;
+            }
+            dgram = std::move(sp->sendQueue.front());
+            sp->sendQueue.pop_front();
+            sp->isWriting = true;
+        }
+
+        if (WriteDatagram(sp, dgram))
+        {
+            net::SocketStats::add(sp->stats->packetsSent);
+            net::SocketStats::add(sp->stats->bytesSent, dgram.data.size());
+        }
+        else
+        {
+            net::SocketStats::add(sp->stats->sendErrors);
+        }
+
+        uint32_t credits = 0;
+        {
+            std::lock_guard<std::mutex> lock(sp->sendMu);
+            sp->isWriting = false;
+            if (sp->drainWanted && sp->sendQueue.size() <= SEND_LOW_WATER)
+            {
+                sp->drainWanted = false;
+                credits = static_cast<uint32_t>(SEND_QUEUE_CAPACITY - sp->sendQueue.size());
+            }
+        }
+        sp->sendCv.notify_all();
+        if (credits == 0)
+            continue;
+        auto *evt = new EventData();
+        evt->type = EventData::Drain;
+        evt->credits = credits;
+        PostEvent(sp, evt);
+    }
+    return true;
+}
+
+// Takes turns over every socket with queued datagrams, so one busy peer
+// cannot hold up the others for more than a slice
+static void SendLoop(SendWorker *w)
+{
+    winrt::init_apartment();
+    for (;;)
+    {
+        std::shared_ptr<SocketEntry> sp;
+        {
+            std::unique_lock<std::mutex> lock(w->mu);
+            w->cv.wait(lock, [w] { return !w->ready.empty(); });
+            sp = std::move(w->ready.front());
+            w->ready.pop_front();
+        }
+        if (WriteSlice(sp.get()))
+            ScheduleSend(sp);
+    }
+}
+
+// ── send(handle, data, port, address) → credits ────────────────────
 
 Napi::Value Send(const Napi::CallbackInfo &info)
 {
@@ -360,47 +776,33 @@ Napi::Value Send(const Napi::CallbackInfo &info)
         return env.Undefined();
     }
 
-    int port = info[2].As<Napi::Number>().Int32Value();
-    std::string address = info[3].As<Napi::String>().Utf8Value();
-
-    try
-    {
-        std::string key = address + ":" + std::to_string(port);
-        HostName remoteHost(to_hstring(address));
-        hstring remotePort = to_hstring(port);
-
-        // Get cached output stream or create one (avoids repeated async calls)
-        auto outputStream = entry->getOrCreateStream(remoteHost, remotePort, key);
-
-        DataWriter writer(outputStream);
-        // Write raw bytes directly from pointer (no copy)
-        writer.WriteBytes(winrt::array_view<const uint8_t>(dataPtr, dataPtr + dataLen));
-
-        writer.StoreAsync().get();
-
-        // Detach so DataWriter doesn't close the cached stream
-        writer.DetachStream();
+    OutgoingDatagram dgram;
+    dgram.port = info[2].As<Napi::Number>().Int32Value();
+    dgram.address = info[3].As<Napi::String>().Utf8Value();
 
-        return env.Undefined();
-    }
-    catch (const hresult_error &e)
+    size_t credits;
+    bool schedule;
     {
-        std::weak_ptr<SocketEntry> weak = entry;
-        auto sp = weak.lock();
-        if (sp && sp->tsfn)
+        std::lock_guard<std::mutex> lock(entry->sendMu);
+        if (entry->sendQueue.size() >= SEND_QUEUE_CAPACITY)
         {
-            auto *evt = new EventData();
-            evt->type = EventData::Error;
-            evt->err.message = "Send failed: " + WideToUtf8(e.message().c_str());
-            sp->tsfn.BlockingCall(evt, CallJS);
+            // Full: nothing queued, JS retries on drain
+            entry->drainWanted = true;
+            net::SocketStats::add(entry->stats->sendFull);
+            return Napi::Number::New(env, -1);
         }
-        return env.Undefined();
-    }
-    catch (const std::exception &e)
-    {
-        Napi::Error::New(env, std::string("Send failed: ") + e.what()).ThrowAsJavaScriptException();
-        return env.Undefined();
+        dgram.data.assign(dataPtr, dataPtr + dataLen);
+        entry->sendQueue.push_back(std::move(dgram));
+        credits = SEND_QUEUE_CAPACITY - entry->sendQueue.size();
+        if (credits == 0)
+            entry->drainWanted = true;
+        schedule = !entry->isSendScheduled;
+        entry->isSendScheduled = true;
     }
+    if (schedule)
+        ScheduleSend(entry);
+
+    return Napi::Number::New(env, static_cast<double>(credits));
 }
 
 // ── address(handle) → { address, family, port } ────────────────────
@@ -442,6 +844,15 @@ Napi::Value Close(const Napi::CallbackInfo &info)
         entry->isClosed = true;
     }
 
+    // Stop sending before the streams go away; unsent datagrams are dropped.
+    // A write already in progress finishes first.
+    {
+        std::unique_lock<std::mutex> lock(entry->sendMu);
+        entry->isSendStopping = true;
+        entry->sendQueue.clear();
+        entry->sendCv.wait(lock, [&entry] { return !entry->isWriting; });
+    }
+
     // Clear cached output streams
     entry->clearStreams();
 
@@ -463,27 +874,54 @@ Napi::Value Close(const Napi::CallbackInfo &info)
     {
     }
 
-    // Notify JS of close
+    // Notify JS of close, after anything posted before it
     try
     {
         auto *evt = new EventData();
         evt->type = EventData::Close;
-        entry->tsfn.BlockingCall(evt, CallJS);
+        if (!PostEvent(entry.get(), evt))
+            entry->callback.Reset();
     }
     catch (...)
     {
     }
+    napi_remove_env_cleanup_hook(env, ReleaseOnExit, entry.get());
 
-    try
+    RemoveSocket(handle);
+
+    return env.Undefined();
+}
+
+// ── getStats(handle) → stats | null ────────────────────────────────
+
+Napi::Value GetStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    auto entry = GetSocket(info[0].As<Napi::Number>().Uint32Value());
+    if (!entry)
+        return env.Null();
+
+    size_t sendQueue, pendingDatagrams;
     {
-        entry->tsfn.Release();
+        std::lock_guard<std::mutex> lock(entry->sendMu);
+        sendQueue = entry->sendQueue.size();
     }
-    catch (...)
     {
+        std::lock_guard<std::mutex> lock(entry->batchMu);
+        pendingDatagrams = entry->pendingCount;
     }
+    // WinRT does not expose the socket's receive drops
+    return net::SocketStatsToNapi(env, *entry->stats, sendQueue, pendingDatagrams, false);
+}
 
-    RemoveSocket(handle);
+// ── release(buffer) ────────────────────────────────────────────────
 
+Napi::Value Release(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    if (info.Length() >= 1)
+        net::ReleaseSlabBuffer(info[0]);
     return env.Undefined();
 }
 
@@ -496,6 +934,8 @@ Napi::Object Init(Napi::Env env, Napi::Object exports)
     exports.Set("send", Napi::Function::New(env, Send));
     exports.Set("address", Napi::Function::New(env, Address));
     exports.Set("close", Napi::Function::New(env, Close));
+    exports.Set("getStats", Napi::Function::New(env, GetStats));
+    exports.Set("release", Napi::Function::New(env, Release));
     return exports;
 }
 
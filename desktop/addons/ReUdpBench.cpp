@@ -0,0 +1,625 @@
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "net/ReUdpEngine.h"
+#include "net/NetEmu.h"
+
+/**
+ * ReUDP benchmark harness.
+ *
+ * Runs two native ReUDP sessions (the same engine the datagram addons use,
+ * with the constants of reUdpProtocol.ts) against each other over a pair of
+ * emulated links, on a virtual clock: no sockets, no sleeping, and the same
+ * seed always gives the same run. One side streams a fixed amount of data in
+ * fixed-size messages on one lane, optionally next to a background transfer
+ * on the bulk lane; the other checks every byte, and the result is printed
+ * as JSON:
+ *
+ *   completed, durationMs, goodputMbps, retransmitRatio,
+ *   latencyMs { p50, p90, p99, max }   (message handed to the session → delivered)
+ *   bulkDelivered                      (background bytes delivered meanwhile)
+ *   sender / receiver session stats, forward / reverse link stats,
+ *   trace [ { t, cwnd, ssthresh, srtt, rto, inFlight, pacingRate, mtu, bottleneckRate, minRtt } ]
+ *
+ * Build:  node-gyp configure -- -Dreudp_bench=1 && node-gyp build
+ * Usage:  ReUdpBench [--scenario=NAME] [--key=value ...]
+ *
+ *   --scenario   lan | wifi | wan | lossy (defaults below; flags override)
+ *   --profile    lan | wan          ReUDP network profile
+ *   --cc         aimd | bbr         congestion control (default: the profile's)
+ *   --bytes      total payload (suffix K/M/G allowed)
+ *   --message    bytes per send() call
+ *   --lane       control | media | bulk   lane of the measured stream (media: FEC parity groups)
+ *   --bulk       background bytes kept queued on the bulk lane while it runs (0: none)
+ *   --fps        send one message per 1/fps s, like a screen stream (0: as fast as the window allows)
+ *   --seed       RNG seed
+ *   --delay      one-way delay, ms
+ *   --jitter     extra one-way delay, uniform 0..jitter ms
+ *   --loss       drop probability (0..1)
+ *   --reorder    reorder probability, --reorder-delay ms held back
+ *   --duplicate  duplication probability
+ *   --rate       bottleneck Mbit/s (0: unlimited), --queue buffer bytes
+ *   --mtu        largest datagram the path carries (0: any); larger ones vanish without notice
+ *   --shrink-mtu path MTU from --shrink-at s on, like a route change (a black hole for larger packets)
+ *   --probe      1: path MTU probing, as on sockets that set don't-fragment; 0: 1300-byte packets
+ *   --ecn        1: sessions send ECN-capable and echo CE marks; 0: not ECN-capable
+ *   --ecn-mark   bottleneck backlog bytes past which ECN-capable packets are CE-marked (0: never)
+ *   --trace      cwnd trace interval, ms (0: off)
+ *   --timeout    give up after this much virtual time, s
+ *
+ * Impairments apply to both directions. Exits non-zero if the transfer did
+ * not complete or the data arrived corrupted.
+ */
+
+namespace
+{
+
+struct Options
+{
+    std::string scenario = "lan";
+    std::string profile;
+    std::string cc; // empty: the profile's
+    uint64_t bytes = 16ull * 1024 * 1024;
+    size_t message = 64 * 1024;
+    uint8_t lane = reudp::LANE_CONTROL;
+    uint64_t bulk = 0;
+    double fps = 0;
+    uint64_t seed = 1;
+    net::LinkConfig link;
+    size_t shrinkMtu = 0;
+    double shrinkAtS = 0;
+    bool isProbing = true;
+    bool isEcn = true;
+    int64_t traceMs = 100;
+    int64_t timeoutS = 600;
+};
+
+struct Scenario
+{
+    const char *name;
+    const char *profile;
+    net::LinkConfig link;
+};
+
+// delay, jitter, loss, reorder, reorderDelay, duplicate, rate, queue, mtu (Ethernet over IPv4)
+const Scenario SCENARIOS[] = {
+    {"lan", "lan", {0.2, 0.1, 0, 0, 0, 0, 1000, 512 * 1024, 1472}},
+    {"wifi", "lan", {2, 3, 0.005, 0.01, 0, 0, 200, 256 * 1024, 1472}},
+    {"wan", "wan", {25, 5, 0.002, 0.001, 0, 0, 50, 128 * 1024, 1472}},
+    {"lossy", "wan", {40, 10, 0.03, 0.02, 0, 0.005, 20, 64 * 1024, 1472}},
+};
+
+uint64_t ParseSize(const std::string &v)
+{
+    char *end = nullptr;
+    double n = std::strtod(v.c_str(), &end);
+    switch (end && *end ? *end : 0)
+    {
+    case 'k': case 'K': n *= 1024; break;
+    case 'm': case 'M': n *= 1024 * 1024; break;
+    case 'g': case 'G': n *= 1024.0 * 1024 * 1024; break;
+    default: break;
+    }
+    return static_cast<uint64_t>(n);
+}
+
+[[noreturn]] void Usage(const std::string &error)
+{
+    std::fprintf(stderr, "ReUdpBench: %s\nSee the comment at the top of addons/ReUdpBench.cpp for options.\n", error.c_str());
+    std::exit(2);
+}
+
+Options ParseArgs(int argc, char **argv)
+{
+    std::map<std::string, std::string> args;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string a = argv[i];
+        size_t eq = a.find('=');
+        if (a.rfind("--", 0) != 0 || eq == std::string::npos)
+            Usage("expected --key=value, got " + a);
+        args[a.substr(2, eq - 2)] = a.substr(eq + 1);
+    }
+
+    Options o;
+    if (args.count("scenario"))
+        o.scenario = args["scenario"];
+    const Scenario *scenario = nullptr;
+    for (const auto &s : SCENARIOS)
+        if (o.scenario == s.name)
+            scenario = &s;
+    if (!scenario)
+        Usage("unknown scenario " + o.scenario);
+    o.profile = scenario->profile;
+    o.link = scenario->link;
+
+    for (const auto &[key, value] : args)
+    {
+        double num = std::atof(value.c_str());
+        if (key == "scenario") continue;
+        else if (key == "profile") o.profile = value;
+        else if (key == "cc") o.cc = value;
+        else if (key == "bytes") o.bytes = ParseSize(value);
+        else if (key == "message") o.message = static_cast<size_t>(ParseSize(value));
+        else if (key == "lane")
+        {
+            const char *names[] = {"control", "media", "bulk"};
+            auto it = std::find(std::begin(names), std::end(names), value);
+            if (it == std::end(names))
+                Usage("lane must be control, media or bulk");
+            o.lane = static_cast<uint8_t>(it - std::begin(names));
+        }
+        else if (key == "bulk") o.bulk = ParseSize(value);
+        else if (key == "fps") o.fps = num;
+        else if (key == "seed") o.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (key == "delay") o.link.delayMs = num;
+        else if (key == "jitter") o.link.jitterMs = num;
+        else if (key == "loss") o.link.loss = num;
+        else if (key == "reorder") o.link.reorder = num;
+        else if (key == "reorder-delay") o.link.reorderDelayMs = num;
+        else if (key == "duplicate") o.link.duplicate = num;
+        else if (key == "rate") o.link.rateMbps = num;
+        else if (key == "queue") o.link.queueBytes = static_cast<size_t>(ParseSize(value));
+        else if (key == "mtu") o.link.mtu = static_cast<size_t>(num);
+        else if (key == "shrink-mtu") o.shrinkMtu = static_cast<size_t>(num);
+        else if (key == "shrink-at") o.shrinkAtS = num;
+        else if (key == "probe") o.isProbing = num != 0;
+        else if (key == "ecn") o.isEcn = num != 0;
+        else if (key == "ecn-mark") o.link.ecnMarkBytes = static_cast<size_t>(ParseSize(value));
+        else if (key == "trace") o.traceMs = static_cast<int64_t>(num);
+        else if (key == "timeout") o.timeoutS = static_cast<int64_t>(num);
+        else Usage("unknown option --" + key);
+    }
+    if (o.profile != "lan" && o.profile != "wan")
+        Usage("profile must be lan or wan");
+    if (!o.cc.empty() && o.cc != "aimd" && o.cc != "bbr")
+        Usage("cc must be aimd or bbr");
+    if (o.bytes == 0 || o.message == 0)
+        Usage("bytes and message must be positive");
+    return o;
+}
+
+// Payload byte at stream offset i; the receiver recomputes it to verify
+inline uint8_t PatternByte(uint64_t i)
+{
+    return static_cast<uint8_t>((i * 131) ^ (i >> 11));
+}
+
+struct TracePoint
+{
+    int64_t t;
+    reudp::SessionStats stats;
+};
+
+class Json
+{
+public:
+    Json &key(const char *k)
+    {
+        comma();
+        out_ += '"';
+        out_ += k;
+        out_ += "\":";
+        isFirst_ = true; // the value follows without a comma
+        return *this;
+    }
+    Json &open(char c)
+    {
+        comma();
+        out_ += c;
+        isFirst_ = true;
+        return *this;
+    }
+    Json &close(char c)
+    {
+        out_ += c;
+        isFirst_ = false;
+        return *this;
+    }
+    Json &value(double v)
+    {
+        comma();
+        char buf[32];
+        if (!std::isfinite(v))
+            v = 0;
+        if (v == std::floor(v) && std::fabs(v) < 1e15)
+            std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(v));
+        else
+            std::snprintf(buf, sizeof(buf), "%.6g", v);
+        out_ += buf;
+        return *this;
+    }
+    Json &value(const std::string &v)
+    {
+        comma();
+        out_ += '"' + v + '"';
+        return *this;
+    }
+    Json &boolean(bool v)
+    {
+        comma();
+        out_ += v ? "true" : "false";
+        return *this;
+    }
+    Json &field(const char *k, double v) { return key(k).value(v); }
+    const std::string &str() const { return out_; }
+
+private:
+    void comma()
+    {
+        if (!isFirst_)
+            out_ += ',';
+        isFirst_ = false;
+    }
+
+    std::string out_;
+    bool isFirst_ = true;
+};
+
+void WriteSessionStats(Json &j, const char *name, const reudp::SessionStats &s)
+{
+    j.key(name).open('{')
+        .field("bytesSent", double(s.bytesSent))
+        .field("bytesReceived", double(s.bytesReceived))
+        .field("packetsSent", double(s.packetsSent))
+        .field("packetsReceived", double(s.packetsReceived))
+        .field("retransmits", double(s.retransmits))
+        .field("cwnd", s.cwnd)
+        .field("ssthresh", s.ssthresh)
+        .field("srtt", s.srtt)
+        .field("rto", double(s.rto))
+        .field("pacingDelays", double(s.pacingDelays))
+        .field("lossRate", s.lossRate)
+        .field("paritySent", double(s.paritySent))
+        .field("fecRecovered", double(s.fecRecovered))
+        .field("mtu", double(s.mtu))
+        .field("bottleneckRate", s.bottleneckRate)
+        .field("minRtt", s.minRtt)
+        .key("isEcn").boolean(s.isEcn)
+        .field("ceReported", double(s.ceReported))
+        .close('}');
+}
+
+void WriteLinkStats(Json &j, const char *name, const net::LinkStats &s)
+{
+    j.key(name).open('{')
+        .field("packets", double(s.packets))
+        .field("bytes", double(s.bytes))
+        .field("tooBig", double(s.tooBig))
+        .field("lost", double(s.lost))
+        .field("queueDrops", double(s.queueDrops))
+        .field("ceMarked", double(s.ceMarked))
+        .field("reordered", double(s.reordered))
+        .field("duplicated", double(s.duplicated))
+        .field("delivered", double(s.delivered))
+        .close('}');
+}
+
+double Percentile(std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    size_t i = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(i, 1)) - 1];
+}
+
+class Bench
+{
+public:
+    explicit Bench(const Options &o)
+        : o_(o),
+          forward_(o.link, o.seed * 2 + 1),
+          reverse_(o.link, o.seed * 2 + 2)
+    {
+        reudp::NetworkProfile profile = o.profile == "wan" ? reudp::WAN_PROFILE : reudp::LAN_PROFILE;
+        if (!o.cc.empty())
+            profile.congestionControl = o.cc == "bbr" ? reudp::CongestionControl::Bbr : reudp::CongestionControl::Aimd;
+        cc_ = profile.congestionControl == reudp::CongestionControl::Bbr ? "bbr" : "aimd";
+        sender_ = std::make_unique<reudp::Session>(profile);
+        receiver_ = std::make_unique<reudp::Session>(profile);
+
+        reudp::Session::Callbacks s;
+        s.transmit = [this](const uint8_t *d, size_t n) { forward_.send(d, n, nowUs_, sender_->ecnCodepoint()); };
+        s.closed = [this](const std::string &error) { if (!isComplete_) failure_ = "sender closed: " + error; };
+        sender_->setCallbacks(std::move(s));
+
+        if (o.isProbing)
+        {
+            sender_->enableMtuProbing();
+            receiver_->enableMtuProbing();
+        }
+        if (o.isEcn)
+        {
+            sender_->enableEcn();
+            receiver_->enableEcn();
+        }
+
+        reudp::Session::Callbacks r;
+        r.transmit = [this](const uint8_t *d, size_t n) { reverse_.send(d, n, nowUs_, receiver_->ecnCodepoint()); };
+        r.deliver = [this](const uint8_t *d, size_t n, uint8_t lane) { onDeliver(d, n, lane); };
+        r.closed = [this](const std::string &error) { if (!isComplete_) failure_ = "receiver closed: " + error; };
+        receiver_->setCallbacks(std::move(r));
+    }
+
+    bool run()
+    {
+        const int64_t limitUs = o_.timeoutS * 1000000;
+        sender_->start(0);
+        receiver_->start(0);
+        int64_t nextTraceUs = 0;
+        if (o_.fps > 0)
+            nextMessageUs_ = 0;
+        int64_t shrinkAtUs = o_.shrinkMtu > 0 ? static_cast<int64_t>(o_.shrinkAtS * 1e6) : INT64_MAX;
+
+        while (!isComplete_ && failure_.empty())
+        {
+            if (sender_->isReady())
+                feed();
+
+            int64_t next = std::min({forward_.nextArrival(), reverse_.nextArrival(),
+                                     timerUs(*sender_), timerUs(*receiver_),
+                                     sender_->isReady() ? nextMessageUs_ : INT64_MAX});
+            if (o_.traceMs > 0)
+                next = std::min(next, nextTraceUs);
+            next = std::min(next, shrinkAtUs);
+            if (next == INT64_MAX || next > limitUs)
+            {
+                failure_ = next == INT64_MAX ? "stalled" : "timed out";
+                break;
+            }
+            nowUs_ = std::max(nowUs_, next);
+            int64_t now = nowUs_ / 1000;
+            if (nowUs_ >= shrinkAtUs)
+            {
+                forward_.setMtu(o_.shrinkMtu);
+                reverse_.setMtu(o_.shrinkMtu);
+                shrinkAtUs = INT64_MAX;
+            }
+
+            std::vector<uint8_t> pkt;
+            uint8_t ecn = 0;
+            bool hasInput = false;
+            while (receiver_->isClosed() == false && forward_.receive(nowUs_, pkt, ecn))
+            {
+                receiver_->onPacket(pkt.data(), pkt.size(), now, ecn);
+                hasInput = true;
+            }
+            if (hasInput)
+                receiver_->flush();
+            hasInput = false;
+            while (sender_->isClosed() == false && reverse_.receive(nowUs_, pkt, ecn))
+            {
+                sender_->onPacket(pkt.data(), pkt.size(), now, ecn);
+                hasInput = true;
+            }
+            if (hasInput)
+                sender_->flush();
+
+            if (timerUs(*sender_) <= nowUs_)
+                sender_->poll(now);
+            if (timerUs(*receiver_) <= nowUs_)
+                receiver_->poll(now);
+
+            if (o_.traceMs > 0 && nowUs_ >= nextTraceUs)
+            {
+                trace_.push_back({now, sender_->stats()});
+                nextTraceUs = (nowUs_ / (o_.traceMs * 1000) + 1) * o_.traceMs * 1000;
+            }
+        }
+        senderStats_ = sender_->stats();
+        receiverStats_ = receiver_->stats();
+        sender_->close(nowUs_ / 1000);
+        receiver_->close(nowUs_ / 1000);
+        return isComplete_ && !isCorrupt_;
+    }
+
+    void report(Json &j)
+    {
+        double durationMs = (doneUs_ - firstSendUs_) / 1000.0;
+        std::vector<double> latencies = latencies_;
+        std::sort(latencies.begin(), latencies.end());
+
+        j.open('{');
+        j.key("scenario").value(o_.scenario);
+        j.key("profile").value(o_.profile);
+        j.key("cc").value(cc_);
+        j.field("seed", double(o_.seed));
+        j.field("bytes", double(o_.bytes));
+        j.field("message", double(o_.message));
+        j.field("lane", o_.lane);
+        j.field("bulk", double(o_.bulk));
+        j.field("fps", o_.fps);
+        j.key("link").open('{')
+            .field("delayMs", o_.link.delayMs)
+            .field("jitterMs", o_.link.jitterMs)
+            .field("loss", o_.link.loss)
+            .field("reorder", o_.link.reorder)
+            .field("reorderDelayMs", o_.link.reorderDelayMs)
+            .field("duplicate", o_.link.duplicate)
+            .field("rateMbps", o_.link.rateMbps)
+            .field("queueBytes", double(o_.link.queueBytes))
+            .field("mtu", double(o_.link.mtu))
+            .field("ecnMarkBytes", double(o_.link.ecnMarkBytes))
+            .field("shrinkMtu", double(o_.shrinkMtu))
+            .field("shrinkAtS", o_.shrinkAtS)
+            .close('}');
+        j.key("completed").boolean(isComplete_);
+        j.key("intact").boolean(!isCorrupt_);
+        if (!failure_.empty())
+            j.key("failure").value(failure_);
+        j.field("bytesDelivered", double(delivered_));
+        j.field("bulkDelivered", double(bulkDelivered_));
+        j.field("durationMs", isComplete_ ? durationMs : 0);
+        j.field("goodputMbps", isComplete_ && durationMs > 0 ? o_.bytes * 8 / (durationMs * 1000) : 0);
+        j.field("retransmitRatio", senderStats_.packetsSent ? double(senderStats_.retransmits) / senderStats_.packetsSent : 0);
+        j.key("latencyMs").open('{')
+            .field("p50", Percentile(latencies, 0.5))
+            .field("p90", Percentile(latencies, 0.9))
+            .field("p99", Percentile(latencies, 0.99))
+            .field("max", latencies.empty() ? 0 : latencies.back())
+            .close('}');
+        WriteSessionStats(j, "sender", senderStats_);
+        WriteSessionStats(j, "receiver", receiverStats_);
+        WriteLinkStats(j, "forward", forward_.stats());
+        WriteLinkStats(j, "reverse", reverse_.stats());
+        j.key("trace").open('[');
+        for (const auto &p : trace_)
+        {
+            j.open('{')
+                .field("t", double(p.t))
+                .field("cwnd", p.stats.cwnd)
+                .field("ssthresh", p.stats.ssthresh)
+                .field("srtt", p.stats.srtt)
+                .field("rto", double(p.stats.rto))
+                .field("inFlight", double(p.stats.inFlight))
+                .field("pacingRate", p.stats.pacingRate)
+                .field("mtu", double(p.stats.mtu))
+                .field("bottleneckRate", p.stats.bottleneckRate)
+                .field("minRtt", p.stats.minRtt)
+                .close('}');
+        }
+        j.close(']');
+        j.close('}');
+    }
+
+private:
+    // Keep a couple of messages queued in the session, like the addon's send
+    // credits; with --fps, queue one message per frame interval instead. The
+    // background transfer, if any, keeps its own lane busy the same way.
+    void feed()
+    {
+        while (queued_ < o_.bytes)
+        {
+            if (o_.fps > 0)
+            {
+                if (nowUs_ < nextMessageUs_)
+                    break;
+                nextMessageUs_ += static_cast<int64_t>(1e6 / o_.fps);
+            }
+            else if (sender_->queuedBytes(o_.lane) >= 2 * o_.message)
+            {
+                break;
+            }
+            size_t n = static_cast<size_t>(std::min<uint64_t>(o_.message, o_.bytes - queued_));
+            if (queued_ == 0)
+                firstSendUs_ = nowUs_;
+            enqueue(MEASURED, queued_, n, o_.lane);
+            queued_ += n;
+        }
+        if (queued_ >= o_.bytes)
+            nextMessageUs_ = INT64_MAX;
+        while (bulkQueued_ < o_.bulk && sender_->queuedBytes(reudp::LANE_BULK) < 2 * o_.message)
+        {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(o_.message, o_.bulk - bulkQueued_));
+            enqueue(BACKGROUND, bulkQueued_, n, reudp::LANE_BULK);
+            bulkQueued_ += n;
+        }
+    }
+
+    void enqueue(int stream, uint64_t offset, size_t n, uint8_t lane)
+    {
+        std::vector<uint8_t> msg(n);
+        for (size_t i = 0; i < n; i++)
+            msg[i] = PatternByte(offset + i);
+        // Delivered on the lane the session really sends it on
+        messages_[sender_->laneFor(lane)].push_back({stream, offset, n, 0, nowUs_});
+        sender_->send(std::move(msg), nowUs_ / 1000, lane);
+    }
+
+    // Each lane is in order on its own: match its bytes against the messages queued on it
+    void onDeliver(const uint8_t *d, size_t n, uint8_t lane)
+    {
+        std::deque<Message> &messages = messages_[lane];
+        while (n > 0 && !isCorrupt_)
+        {
+            if (messages.empty())
+            {
+                isCorrupt_ = true;
+                break;
+            }
+            Message &m = messages.front();
+            size_t k = std::min(n, m.size - m.done);
+            for (size_t i = 0; i < k && !isCorrupt_; i++)
+                isCorrupt_ = d[i] != PatternByte(m.offset + m.done + i);
+            m.done += k;
+            d += k;
+            n -= k;
+            (m.stream == MEASURED ? delivered_ : bulkDelivered_) += k;
+            if (m.done < m.size)
+                continue;
+            if (m.stream == MEASURED)
+                latencies_.push_back((nowUs_ - m.sentUs) / 1000.0);
+            messages.pop_front();
+        }
+        if (delivered_ >= o_.bytes && !isComplete_)
+        {
+            isComplete_ = true;
+            doneUs_ = nowUs_;
+        }
+    }
+
+    static int64_t timerUs(const reudp::Session &s)
+    {
+        int64_t t = s.nextTimeout();
+        return t == reudp::NO_TIMEOUT ? INT64_MAX : t * 1000;
+    }
+
+    enum Stream
+    {
+        MEASURED,
+        BACKGROUND,
+    };
+
+    struct Message
+    {
+        int stream;
+        uint64_t offset; // in its stream
+        size_t size;
+        size_t done; // bytes delivered
+        int64_t sentUs;
+    };
+
+    Options o_;
+    std::string cc_;    // congestion control in use
+    net::Link forward_; // sender → receiver
+    net::Link reverse_; // receiver → sender
+    std::unique_ptr<reudp::Session> sender_;
+    std::unique_ptr<reudp::Session> receiver_;
+    int64_t nowUs_ = 0;
+    int64_t firstSendUs_ = 0;
+    int64_t doneUs_ = 0;
+    int64_t nextMessageUs_ = INT64_MAX; // next frame, with --fps
+    uint64_t queued_ = 0;
+    uint64_t delivered_ = 0;
+    uint64_t bulkQueued_ = 0;
+    uint64_t bulkDelivered_ = 0;
+    bool isComplete_ = false;
+    bool isCorrupt_ = false;
+    std::string failure_;
+    std::deque<Message> messages_[reudp::LANE_COUNT];
+    std::vector<double> latencies_;
+    std::vector<TracePoint> trace_;
+    reudp::SessionStats senderStats_;
+    reudp::SessionStats receiverStats_;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options o = ParseArgs(argc, argv);
+    Bench bench(o);
+    bool isOk = bench.run();
+    Json j;
+    bench.report(j);
+    std::printf("%s\n", j.str().c_str());
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define NET_AES_NI 1
+#endif
+
+/**
+ * AES-256-CTR keystream, applied in place.
+ *
+ * Same construction as Node's 'aes-256-ctr' cipher: the 16-byte IV is the
+ * initial counter block and counts up as one 128-bit big-endian integer,
+ * and apply() continues the stream where the last call stopped, like
+ * cipher.update(). Encryption and decryption are the same operation.
+ *
+ * Blocks go through AES-NI where the CPU has it (checked once at runtime;
+ * the code is compiled for it regardless of -march) and through a portable
+ * table implementation elsewhere. The fallback's table lookups are not
+ * constant-time.
+ *
+ * Not thread-safe: one instance per stream direction, used by one thread.
+ */
+
+namespace net
+{
+
+class AesCtr
+{
+public:
+    static constexpr size_t KEY_SIZE = 32;
+    static constexpr size_t IV_SIZE = 16;
+
+    AesCtr(const uint8_t *key, const uint8_t *iv)
+    {
+        ExpandKey(key, roundKeys_);
+        for (int i = 0; i < 8; ++i)
+        {
+            counter_.hi = (counter_.hi << 8) | iv[i];
+            counter_.lo = (counter_.lo << 8) | iv[8 + i];
+        }
+        xorBlocks_ = HasAesNi() ? XorBlocksNi : XorBlocksPortable;
+    }
+
+    /** XOR the next `len` keystream bytes into `data`. */
+    void apply(uint8_t *data, size_t len)
+    {
+        // Rest of the block the previous call started
+        while (len > 0 && keystreamUsed_ < BLOCK)
+        {
+            *data++ ^= keystream_[keystreamUsed_++];
+            len--;
+        }
+
+        size_t blocks = len / BLOCK;
+        xorBlocks_(roundKeys_, counter_, data, blocks);
+        data += blocks * BLOCK;
+        len -= blocks * BLOCK;
+
+        if (len > 0)
+        {
+            memset(keystream_, 0, BLOCK);
+            xorBlocks_(roundKeys_, counter_, keystream_, 1);
+            for (keystreamUsed_ = 0; keystreamUsed_ < len; ++keystreamUsed_)
+                data[keystreamUsed_] ^= keystream_[keystreamUsed_];
+        }
+    }
+
+private:
+    static constexpr size_t BLOCK = 16;
+    static constexpr size_t BATCH = 8; // blocks per encrypt call; keeps the AES-NI pipeline full
+    static constexpr int ROUNDS = 14;
+
+    using RoundKeys = uint8_t[ROUNDS + 1][BLOCK];
+
+    struct Counter
+    {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+
+        void next(uint8_t *block)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                block[i] = static_cast<uint8_t>(hi >> (56 - 8 * i));
+                block[8 + i] = static_cast<uint8_t>(lo >> (56 - 8 * i));
+            }
+            if (++lo == 0)
+                ++hi;
+        }
+    };
+
+    // XOR the keystream of `blocks` successive counter values into `data`
+    using XorBlocksFn = void (*)(const RoundKeys &, Counter &, uint8_t *, size_t);
+
+    static const uint8_t *SBox()
+    {
+        static const uint8_t box[256] = {
+            0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+            0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+            0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+            0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+            0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+            0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+            0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+            0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+            0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+            0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+            0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+            0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+            0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+            0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+            0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+            0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+        };
+        return box;
+    }
+
+    // FIPS-197 key expansion; the byte layout is also what AESENC takes
+    static void ExpandKey(const uint8_t *key, RoundKeys &rk)
+    {
+        const uint8_t *sbox = SBox();
+        uint8_t *w = &rk[0][0];
+        memcpy(w, key, KEY_SIZE);
+        uint8_t rcon = 1;
+        for (size_t i = KEY_SIZE; i < sizeof(RoundKeys); i += 4)
+        {
+            uint8_t t[4] = {w[i - 4], w[i - 3], w[i - 2], w[i - 1]};
+            if (i % KEY_SIZE == 0)
+            {
+                uint8_t first = t[0];
+                t[0] = sbox[t[1]] ^ rcon;
+                t[1] = sbox[t[2]];
+                t[2] = sbox[t[3]];
+                t[3] = sbox[first];
+                rcon = static_cast<uint8_t>((rcon << 1) ^ ((rcon & 0x80) ? 0x1b : 0));
+            }
+            else if (i % KEY_SIZE == 16)
+            {
+                for (uint8_t &b : t)
+                    b = sbox[b];
+            }
+            for (int j = 0; j < 4; ++j)
+                w[i + j] = w[i - KEY_SIZE + j] ^ t[j];
+        }
+    }
+
+    // SubBytes + MixColumns of one byte, as a little-endian column word
+    static const uint32_t *Table()
+    {
+        static const struct Te
+        {
+            uint32_t t[256];
+            Te()
+            {
+                const uint8_t *sbox = SBox();
+                for (int i = 0; i < 256; ++i)
+                {
+                    uint32_t s = sbox[i];
+                    uint32_t s2 = ((s << 1) ^ ((s & 0x80) ? 0x1b : 0)) & 0xff;
+                    t[i] = s2 | (s << 8) | (s << 16) | ((s2 ^ s) << 24);
+                }
+            }
+        } te;
+        return te.t;
+    }
+
+    static uint32_t Rotl8(uint32_t v, int n) { return (v << (8 * n)) | (v >> (32 - 8 * n)); }
+
+    static void XorBlocksPortable(const RoundKeys &rk, Counter &counter, uint8_t *data, size_t blocks)
+    {
+        const uint8_t *sbox = SBox();
+        const uint32_t *te = Table();
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            uint8_t s[BLOCK];
+            counter.next(s);
+            for (size_t i = 0; i < BLOCK; ++i)
+                s[i] ^= rk[0][i];
+            for (int round = 1; round < ROUNDS; ++round)
+            {
+                // Column c takes row r from column c + r (ShiftRows)
+                uint8_t next[BLOCK];
+                for (int c = 0; c < 4; ++c)
+                {
+                    uint32_t col = te[s[4 * c]] ^ Rotl8(te[s[4 * ((c + 1) & 3) + 1]], 1) ^
+                                   Rotl8(te[s[4 * ((c + 2) & 3) + 2]], 2) ^ Rotl8(te[s[4 * ((c + 3) & 3) + 3]], 3);
+                    for (int r = 0; r < 4; ++r)
+                        next[4 * c + r] = static_cast<uint8_t>(col >> (8 * r)) ^ rk[round][4 * c + r];
+                }
+                memcpy(s, next, BLOCK);
+            }
+            uint8_t *block = data + b * BLOCK;
+            for (int c = 0; c < 4; ++c)
+            {
+                for (int r = 0; r < 4; ++r)
+                    block[4 * c + r] ^= sbox[s[4 * ((c + r) & 3) + r]] ^ rk[ROUNDS][4 * c + r];
+            }
+        }
+    }
+
+#ifdef NET_AES_NI
+    static bool HasAesNi()
+    {
+        static const bool hasAesNi = __builtin_cpu_supports("aes") && __builtin_cpu_supports("ssse3");
+        return hasAesNi;
+    }
+
+    __attribute__((target("aes,ssse3"))) static void XorBlocksNi(const RoundKeys &rk, Counter &counter, uint8_t *data,
+                                                                  size_t blocks)
+    {
+        __m128i keys[ROUNDS + 1];
+        for (int i = 0; i <= ROUNDS; ++i)
+            keys[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rk[i]));
+        const __m128i byteSwap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        while (blocks > 0)
+        {
+            size_t n = blocks < BATCH ? blocks : BATCH;
+            __m128i s[BATCH];
+            for (size_t i = 0; i < n; ++i)
+            {
+                __m128i block = _mm_set_epi64x(static_cast<int64_t>(counter.hi), static_cast<int64_t>(counter.lo));
+                s[i] = _mm_xor_si128(_mm_shuffle_epi8(block, byteSwap), keys[0]);
+                if (++counter.lo == 0)
+                    ++counter.hi;
+            }
+            // Round-major, so independent blocks overlap in the AES unit
+            for (int round = 1; round < ROUNDS; ++round)
+            {
+                for (size_t i = 0; i < n; ++i)
+                    s[i] = _mm_aesenc_si128(s[i], keys[round]);
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                auto *p = reinterpret_cast<__m128i *>(data + i * BLOCK);
+                _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), _mm_aesenclast_si128(s[i], keys[ROUNDS])));
+            }
+            data += n * BLOCK;
+            blocks -= n;
+        }
+    }
+#else
+    static bool HasAesNi() { return false; }
+    static void XorBlocksNi(const RoundKeys &rk, Counter &counter, uint8_t *data, size_t blocks)
+    {
+        XorBlocksPortable(rk, counter, data, blocks);
+    }
+#endif
+
+    RoundKeys roundKeys_;
+    Counter counter_;
+    uint8_t keystream_[BLOCK] = {};
+    size_t keystreamUsed_ = BLOCK; // all of keystream_ spent
+    XorBlocksFn xorBlocks_;
+};
+
+} // namespace net
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <napi.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * One event queue into the JS thread for every socket of an environment.
+ *
+ * Native threads post() events from any socket; they collect in one outbox
+ * and a single threadsafe-function call hands over whatever accumulated by
+ * the time JS runs, however many sockets it came from. So the number of
+ * TSFN queues and JS wakeups stays flat as sockets are added, and events
+ * keep the order they were posted in.
+ *
+ * `Deliver(env, event)` runs each event on the JS thread and deletes it;
+ * it finds the socket's own callback through the event.
+ * Events still queued when the environment goes away are deleted undelivered.
+ * Created on first use per environment and owned by its instance data;
+ * sockets keep a shared_ptr so late posts from native threads stay safe.
+ */
+
+namespace net
+{
+
+template <typename Event, void (*Deliver)(Napi::Env, Event *)>
+class EventDispatcher : public std::enable_shared_from_this<EventDispatcher<Event, Deliver>>
+{
+public:
+    static std::shared_ptr<EventDispatcher> ForEnv(Napi::Env env, const char *resourceName)
+    {
+        auto *holder = env.GetInstanceData<std::shared_ptr<EventDispatcher>>();
+        if (holder)
+            return *holder;
+
+        auto dispatcher = std::shared_ptr<EventDispatcher>(new EventDispatcher());
+        dispatcher->tsfn_ = Napi::ThreadSafeFunction::New(
+            env,
+            Napi::Function::New(env, [](const Napi::CallbackInfo &) {}),
+            resourceName,
+            0, // unlimited queue
+            1);
+        dispatcher->tsfn_.Unref(env); // weak so the event loop can exit
+        // Registered before any socket's hook, so it runs after all of them
+        napi_add_env_cleanup_hook(env, Shutdown, dispatcher.get());
+        env.SetInstanceData(new std::shared_ptr<EventDispatcher>(dispatcher));
+        return dispatcher;
+    }
+
+    EventDispatcher(const EventDispatcher &) = delete;
+    EventDispatcher &operator=(const EventDispatcher &) = delete;
+
+    /** Any thread. Takes ownership; false (event deleted) once the env is gone. */
+    bool post(Event *event)
+    {
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (isClosed_)
+            {
+                delete event;
+                return false;
+            }
+            outbox_.push_back(event);
+            if (!isScheduled_)
+                schedule = isScheduled_ = true;
+        }
+        if (!schedule)
+            return true;
+
+        auto *self = new std::shared_ptr<EventDispatcher>(this->shared_from_this());
+        if (tsfn_.NonBlockingCall(self, Dispatch) == napi_ok)
+            return true;
+        delete self;
+        // Closing: nothing will pick the outbox up any more
+        std::vector<Event *> dropped;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            dropped.swap(outbox_);
+            isScheduled_ = false;
+        }
+        for (Event *e : dropped)
+            delete e;
+        return false;
+    }
+
+private:
+    EventDispatcher() = default;
+
+    static void Dispatch(Napi::Env env, Napi::Function, std::shared_ptr<EventDispatcher> *self)
+    {
+        std::vector<Event *> events;
+        {
+            std::lock_guard<std::mutex> lock((*self)->mu_);
+            events.swap((*self)->outbox_);
+            (*self)->isScheduled_ = false;
+        }
+        for (Event *e : events)
+        {
+            if (!env)
+            {
+                delete e;
+                continue;
+            }
+            Napi::HandleScope scope(env); // one batch can carry thousands of events
+            Deliver(env, e);
+        }
+        delete self;
+    }
+
+    static void Shutdown(void *arg)
+    {
+        auto *dispatcher = static_cast<EventDispatcher *>(arg);
+        {
+            std::lock_guard<std::mutex> lock(dispatcher->mu_);
+            dispatcher->isClosed_ = true;
+        }
+        dispatcher->tsfn_.Release();
+    }
+
+    Napi::ThreadSafeFunction tsfn_;
+    std::mutex mu_;
+    std::vector<Event *> outbox_;
+    bool isScheduled_ = false;
+    bool isClosed_ = false;
+};
+
+} // namespace net
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <random>
+
+#include "AesCtr.h"
+
+/**
+ * Flood shedding and stateless cookies for datagrams from sources a socket
+ * hasn't validated yet.
+ *
+ * admit() runs a token bucket per source address, in a fixed table of
+ * SLOTS buckets picked by a keyed hash, with one bucket for the whole
+ * socket behind them. Neither one loud source nor many spoofed ones get
+ * more than a bounded number of packets per second past it, and the table
+ * never grows. Sources whose slots collide share a bucket; a slot goes to a
+ * new address once its old one has been quiet long enough to refill.
+ *
+ * cookie() makes the 4-byte value a source must echo to show it receives at
+ * its address: the first bytes of AES-256 over the address, the port and
+ * the current COOKIE_PERIOD_MS period, under a random key of the guard's
+ * own. Nothing is kept per source. A cookie is good for the period it was
+ * made in and the one after.
+ *
+ * Not thread-safe; one owner thread, like the socket it guards.
+ */
+
+namespace net
+{
+
+class FloodGuard
+{
+public:
+    static constexpr size_t SLOTS = 1024;          // a power of two
+    static constexpr double SOURCE_RATE = 0.02;    // packets per ms one source may send (20/s)
+    static constexpr double SOURCE_BURST = 16;
+    static constexpr double TOTAL_RATE = 1;        // packets per ms all sources together may send
+    static constexpr double TOTAL_BURST = 256;
+    static constexpr int64_t COOKIE_PERIOD_MS = 30000;
+
+    FloodGuard()
+    {
+        std::random_device random;
+        for (size_t i = 0; i < AesCtr::KEY_SIZE; i += 4)
+        {
+            uint32_t word = random();
+            for (size_t b = 0; b < 4; ++b)
+                key_[i + b] = static_cast<uint8_t>(word >> (8 * b));
+        }
+        hashKey_ = (uint64_t(random()) << 32) | random() | 1;
+    }
+
+    /** Whether a datagram from `address` (IPv4, network byte order) may be looked at. */
+    bool admit(uint32_t address, int64_t now)
+    {
+        Bucket &slot = slots_[(address * hashKey_) >> (64 - SLOT_BITS)];
+        if (slot.address != address && refilled(slot, SOURCE_RATE, SOURCE_BURST, now) >= SOURCE_BURST)
+        {
+            slot.address = address;
+            slot.tokens = SOURCE_BURST;
+            slot.lastRefill = now;
+        }
+        return take(slot, SOURCE_RATE, SOURCE_BURST, now) && take(total_, TOTAL_RATE, TOTAL_BURST, now);
+    }
+
+    uint32_t cookie(uint32_t address, uint16_t port, int64_t now) const { return cookieFor(address, port, now / COOKIE_PERIOD_MS); }
+
+    bool isValidCookie(uint32_t cookie, uint32_t address, uint16_t port, int64_t now) const
+    {
+        int64_t period = now / COOKIE_PERIOD_MS;
+        return cookie == cookieFor(address, port, period) || cookie == cookieFor(address, port, period - 1);
+    }
+
+private:
+    static constexpr int SLOT_BITS = 10;
+    static_assert(SLOTS == size_t(1) << SLOT_BITS, "SLOTS is 2^SLOT_BITS");
+
+    struct Bucket
+    {
+        uint32_t address = 0;
+        double tokens = 0;
+        int64_t lastRefill = INT64_MIN; // never used: full
+    };
+
+    static double refilled(const Bucket &b, double rate, double burst, int64_t now)
+    {
+        if (b.lastRefill == INT64_MIN)
+            return burst;
+        return std::min(burst, b.tokens + rate * static_cast<double>(std::max<int64_t>(0, now - b.lastRefill)));
+    }
+
+    static bool take(Bucket &b, double rate, double burst, int64_t now)
+    {
+        b.tokens = refilled(b, rate, burst, now);
+        b.lastRefill = now;
+        if (b.tokens < 1)
+            return false;
+        b.tokens -= 1;
+        return true;
+    }
+
+    uint32_t cookieFor(uint32_t address, uint16_t port, int64_t period) const
+    {
+        uint8_t block[AesCtr::IV_SIZE] = {};
+        for (int i = 0; i < 4; ++i)
+            block[i] = static_cast<uint8_t>(address >> (8 * i));
+        block[4] = static_cast<uint8_t>(port >> 8);
+        block[5] = static_cast<uint8_t>(port);
+        for (int i = 0; i < 8; ++i)
+            block[8 + i] = static_cast<uint8_t>(static_cast<uint64_t>(period) >> (56 - 8 * i));
+        // The keystream's first block is AES(key, block)
+        uint8_t out[4] = {};
+        AesCtr(key_, block).apply(out, sizeof(out));
+        return (uint32_t(out[0]) << 24) | (uint32_t(out[1]) << 16) | (uint32_t(out[2]) << 8) | out[3];
+    }
+
+    uint8_t key_[AesCtr::KEY_SIZE];
+    uint64_t hashKey_;
+    Bucket slots_[SLOTS];
+    Bucket total_;
+};
+
+} // namespace net
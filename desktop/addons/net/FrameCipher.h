@@ -0,0 +1,88 @@
+#pragma once
+
+#include "AesCtr.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+/**
+ * RPCPeer's connection-level encryption, applied to one direction of a
+ * native ReUDP session's byte stream in place.
+ *
+ * The stream carries DataChannelParser frames (appShared/src/
+ * DataChannelParser.ts): [type:1][flags:1][length:4 BE][payload]. Once
+ * RPCPeer has a key for a direction, the payload of every frame that is not
+ * part of the auth handshake (SETUP_AUTH_TYPES in rpc.ts) runs through one
+ * continuous AES-256-CTR stream; headers stay in the clear. This walks the
+ * frames exactly the same way, so the bytes on the wire are identical to
+ * what the JS cipher produces and either side may be native or JS.
+ *
+ * Frames are tracked from the first byte of the session whether or not a
+ * key is set, so a key can be installed at any frame boundary. Only frames
+ * that start after setKey() are encrypted; RPCPeer installs keys before any
+ * non-handshake frame is sent or expected.
+ *
+ * Each ReUDP lane is a byte stream of its own, with its own FrameCipher:
+ * RPCPeer runs lane n's keystream from the IV with n XORed into its first
+ * byte, so lanes never share counter blocks and lane 0 is the IV as given.
+ *
+ * I/O thread only.
+ */
+
+namespace net
+{
+
+class FrameCipher
+{
+public:
+    void setKey(const uint8_t *key, const uint8_t *iv, uint8_t lane = 0)
+    {
+        uint8_t laneIv[AesCtr::IV_SIZE];
+        memcpy(laneIv, iv, sizeof(laneIv));
+        laneIv[0] ^= lane;
+        ctr_ = std::make_unique<AesCtr>(key, laneIv);
+    }
+
+    bool hasKey() const { return ctr_ != nullptr; }
+
+    /** Next `len` bytes of the stream, transformed in place. */
+    void apply(uint8_t *data, size_t len)
+    {
+        while (len > 0)
+        {
+            if (payloadLeft_ == 0)
+            {
+                header_[headerUsed_++] = *data++;
+                len--;
+                if (headerUsed_ < HEADER_SIZE)
+                    continue;
+                headerUsed_ = 0;
+                payloadLeft_ = (uint32_t(header_[2]) << 24) | (uint32_t(header_[3]) << 16) |
+                               (uint32_t(header_[4]) << 8) | header_[5];
+                isEncrypted_ = ctr_ && !IsSetupType(header_[0]);
+                continue;
+            }
+            size_t n = len < payloadLeft_ ? len : payloadLeft_;
+            if (isEncrypted_)
+                ctr_->apply(data, n);
+            data += n;
+            len -= n;
+            payloadLeft_ -= static_cast<uint32_t>(n);
+        }
+    }
+
+private:
+    static constexpr size_t HEADER_SIZE = 6;
+
+    // AUTH_CHALLENGE, AUTH_RESPONSE, HELLO, READY
+    static bool IsSetupType(uint8_t type) { return type == 0x04 || type == 0x05 || type == 0x09 || type == 0x0A; }
+
+    std::unique_ptr<AesCtr> ctr_;
+    uint8_t header_[HEADER_SIZE] = {};
+    size_t headerUsed_ = 0;
+    uint32_t payloadLeft_ = 0;
+    bool isEncrypted_ = false;
+};
+
+} // namespace net
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <vector>
+
+/**
+ * Deterministic network impairment emulator.
+ *
+ * A Link carries datagrams one way on a virtual clock (microseconds) and
+ * applies, in order: a path MTU that silently drops larger datagrams, random
+ * loss, a bandwidth cap with a drop-tail bottleneck queue (which can CE-mark
+ * ECN-capable packets once it fills past a threshold, as an AQM would),
+ * fixed delay plus jitter, reordering and duplication.
+ * All randomness comes from a seeded generator whose output does not depend
+ * on the standard library, so a run can be replayed exactly from its seed on
+ * any platform.
+ *
+ * Jitter alone never reorders (a packet is held until the one before it has
+ * arrived, as on a real queue); reordering is its own knob. No threads or
+ * sockets; the owner advances the clock and collects due packets.
+ */
+
+namespace net
+{
+
+/** SplitMix64: tiny, fast and identical everywhere. */
+class Rng
+{
+public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+
+    uint64_t next()
+    {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /** Uniform in [0, 1). */
+    double uniform() { return double(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    bool chance(double p) { return p > 0 && uniform() < p; }
+
+private:
+    uint64_t state_;
+};
+
+struct LinkConfig
+{
+    double delayMs = 0;         // one-way propagation delay
+    double jitterMs = 0;        // extra delay, uniform in [0, jitter]
+    double loss = 0;            // drop probability per packet
+    double reorder = 0;         // probability a packet is held back by reorderDelayMs
+    double reorderDelayMs = 0;  // extra delay for reordered packets (0: 2 × jitter, at least 1 ms)
+    double duplicate = 0;       // probability a packet is delivered twice
+    double rateMbps = 0;        // bottleneck bandwidth; 0 = unlimited
+    size_t queueBytes = 256 * 1024; // bottleneck buffer; packets beyond it are dropped
+    size_t mtu = 0;             // largest datagram carried (UDP payload), no ICMP for bigger ones; 0 = any
+    size_t ecnMarkBytes = 0;    // ECN-capable packets finding more queued than this are marked CE; 0 = never
+};
+
+struct LinkStats
+{
+    uint64_t packets = 0;      // offered by the sender
+    uint64_t bytes = 0;
+    uint64_t tooBig = 0;       // over the path MTU
+    uint64_t lost = 0;         // random loss
+    uint64_t queueDrops = 0;   // bottleneck buffer overflow
+    uint64_t ceMarked = 0;     // ECN-capable packets marked CE at the bottleneck
+    uint64_t reordered = 0;
+    uint64_t duplicated = 0;
+    uint64_t delivered = 0;
+};
+
+class Link
+{
+public:
+    Link(const LinkConfig &config, uint64_t seed) : config_(config), rng_(seed) {}
+
+    /** Offer a datagram at `nowUs`, with the ECN field of its IP header. */
+    void send(const uint8_t *data, size_t len, int64_t nowUs, uint8_t ecn = 0)
+    {
+        stats_.packets++;
+        stats_.bytes += len;
+        if (config_.mtu > 0 && len > config_.mtu)
+        {
+            stats_.tooBig++;
+            return;
+        }
+        if (rng_.chance(config_.loss))
+        {
+            stats_.lost++;
+            return;
+        }
+
+        int64_t departUs = nowUs;
+        if (config_.rateMbps > 0)
+        {
+            // Bytes still waiting to be serialized ahead of this packet
+            int64_t backlogUs = std::max<int64_t>(0, busyUntilUs_ - nowUs);
+            double backlogBytes = backlogUs * config_.rateMbps / 8;
+            if (backlogBytes + len > config_.queueBytes)
+            {
+                stats_.queueDrops++;
+                return;
+            }
+            if (config_.ecnMarkBytes > 0 && ecn != 0 && backlogBytes > config_.ecnMarkBytes)
+            {
+                stats_.ceMarked++;
+                ecn = 3;
+            }
+            int64_t startUs = std::max(nowUs, busyUntilUs_);
+            busyUntilUs_ = startUs + static_cast<int64_t>(std::ceil(len * 8 / config_.rateMbps));
+            departUs = busyUntilUs_;
+        }
+
+        int64_t arriveUs = departUs + msToUs(config_.delayMs);
+        if (config_.jitterMs > 0)
+            arriveUs += msToUs(rng_.uniform() * config_.jitterMs);
+        if (rng_.chance(config_.reorder))
+        {
+            stats_.reordered++;
+            double extraMs = config_.reorderDelayMs > 0 ? config_.reorderDelayMs : std::max(1.0, 2 * config_.jitterMs);
+            arriveUs += msToUs(extraMs);
+        }
+        else
+        {
+            arriveUs = std::max(arriveUs, lastArrivalUs_);
+            lastArrivalUs_ = arriveUs;
+        }
+
+        std::vector<uint8_t> bytes(data, data + len);
+        if (rng_.chance(config_.duplicate))
+        {
+            stats_.duplicated++;
+            queue_.push(InFlight{arriveUs + 1, order_++, ecn, bytes});
+        }
+        queue_.push(InFlight{arriveUs, order_++, ecn, std::move(bytes)});
+    }
+
+    /** Arrival time of the next packet, or INT64_MAX when nothing is in flight. */
+    int64_t nextArrival() const { return queue_.empty() ? INT64_MAX : queue_.top().arriveUs; }
+
+    /** Pop the next packet if it has arrived by `nowUs`. */
+    bool receive(int64_t nowUs, std::vector<uint8_t> &out)
+    {
+        uint8_t ecn;
+        return receive(nowUs, out, ecn);
+    }
+
+    /** Same, with the ECN field it arrived with. */
+    bool receive(int64_t nowUs, std::vector<uint8_t> &out, uint8_t &ecn)
+    {
+        if (queue_.empty() || queue_.top().arriveUs > nowUs)
+            return false;
+        // priority_queue::top() is const; the packet is discarded right after
+        out = std::move(const_cast<InFlight &>(queue_.top()).data);
+        ecn = queue_.top().ecn;
+        queue_.pop();
+        stats_.delivered++;
+        return true;
+    }
+
+    const LinkStats &stats() const { return stats_; }
+    const LinkConfig &config() const { return config_; }
+
+    /** Change the path MTU from now on, as a route change would. */
+    void setMtu(size_t mtu) { config_.mtu = mtu; }
+
+private:
+    struct InFlight
+    {
+        int64_t arriveUs;
+        uint64_t order; // ties keep send order
+        uint8_t ecn;
+        std::vector<uint8_t> data;
+
+        bool operator>(const InFlight &o) const
+        {
+            return arriveUs != o.arriveUs ? arriveUs > o.arriveUs : order > o.order;
+        }
+    };
+
+    static int64_t msToUs(double ms) { return static_cast<int64_t>(std::llround(ms * 1000)); }
+
+    LinkConfig config_;
+    Rng rng_;
+    LinkStats stats_;
+    int64_t busyUntilUs_ = 0;
+    int64_t lastArrivalUs_ = 0;
+    uint64_t order_ = 0;
+    std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight>> queue_;
+};
+
+} // namespace net
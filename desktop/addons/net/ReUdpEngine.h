@@ -0,0 +1,2249 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "SeqRing.h"
+#include "TimerWheel.h"
+
+/**
+ * Native ReUDP session — the reliability layer of appShared/src/reUdpProtocol.ts
+ * (ReDatagram) ported to C++ so it can run on the datagram addon's I/O thread.
+ *
+ * Wire-compatible with the TypeScript implementation: same packets, same
+ * constants, same Jacobson RTO and AIMD with QUIC-style recovery. HELLO and
+ * HELLO_ACK carry the sender's protocol version, and each side only uses what
+ * both speak; docs/Development/reudp.md describes every version. Unlike
+ * ReDatagram, new DATA is paced at about cwnd/srtt (see Pacer) rather than
+ * released as a burst whenever the window opens.
+ *
+ * The session is a pure state machine with no threads, sockets or clocks of
+ * its own: the owner feeds it packets and the current time (ms, monotonic),
+ * calls poll() when nextTimeout() is due, and receives outgoing packets and
+ * in-order payloads through callbacks. Not thread-safe; one owner thread.
+ * Its timers (each DATA packet's retransmit timer, delayed ACK, HELLO, PING,
+ * pacing, MTU probes) live in a timing wheel at 1 ms resolution, so each
+ * costs O(1) however full the window, and a lost packet is resent when its
+ * own RTO expires rather than at the next periodic scan.
+ */
+
+namespace reudp
+{
+
+constexpr size_t HEADER_SIZE = 5; // 1 byte type + 4 bytes seq
+constexpr size_t BASE_PACKET_SIZE = 1300;      // fits any path; the packet size until probing finds more
+constexpr size_t MAX_PACKET_SIZE = 8972;       // 9000-byte jumbo frame less IPv4 + UDP headers
+constexpr uint32_t ACK_BATCH_SIZE = 64;
+constexpr size_t MAX_BUFFERED_PACKETS = 1024; // seqs past the ACK point the receive ring holds; a power of two
+constexpr int64_t INITIAL_RTO = 1200;          // ms — initial RTO before any RTT measurement
+constexpr int64_t MIN_RTO = 150;               // ms — floor for adaptive RTO
+constexpr int64_t MAX_RTO = 2000;              // ms — ceiling for adaptive RTO
+constexpr int MAX_RETRANSMITS_PER_SCAN = 64;   // cap timer retransmits per RETRANSMIT_SCAN_INTERVAL to prevent storms
+constexpr size_t MAX_SACK_BLOCKS = 4;          // max SACK blocks in ACK packets
+constexpr int64_t MAX_ACK_DELAY_MS = 50;
+constexpr int64_t IDLE_THRESHOLD_MS = 5000;    // reset RTT estimator after this much idle
+constexpr int64_t PING_INTERVAL_MS = 3 * 1000;
+constexpr int64_t MAX_PING_DELAY_MS = 10 * 1000;
+constexpr size_t MAX_SEND_WINDOW = 1024;       // max unACKed packets in flight
+constexpr int64_t RETRANSMIT_SCAN_INTERVAL = 200; // ms - retransmit budget and loss-rate sample period
+constexpr int HELLO_MAX_RETRIES = 10;
+
+// Congestion control (AIMD with QUIC-style recovery)
+constexpr double INITIAL_CWND = 10;
+constexpr double MIN_CWND = 2;
+constexpr double INITIAL_SSTHRESH = 128;
+
+// Pacing gain while in slow start, where cwnd doubles each RTT (Linux fq uses the same)
+constexpr double SLOW_START_PACING_GAIN = 2.0;
+
+// Model-based congestion control (see Bbr)
+constexpr double BBR_HIGH_GAIN = 2.885;        // 2 / ln 2: Startup doubles the delivery rate each round
+constexpr double BBR_PROBE_GAINS[] = {1.25, 0.75, 1, 1, 1, 1, 1, 1}; // ProbeBW pacing gain cycle, one min RTT each
+constexpr double BBR_CWND_GAIN = 2.0;          // ProbeBW cwnd in BDPs, room for delayed and aggregated ACKs
+constexpr int BBR_BW_ROUNDS = 10;              // bottleneck bandwidth: max delivery rate of the last N rounds
+constexpr int BBR_FULL_BW_ROUNDS = 3;          // rounds without 25% growth before Startup ends
+constexpr int64_t BBR_MIN_RTT_WINDOW_MS = 10 * 1000; // min RTT sample this old is probed again
+constexpr int64_t BBR_PROBE_RTT_MS = 200;      // time spent at BBR_MIN_CWND to probe it
+constexpr double BBR_MIN_CWND = 4;
+constexpr double BBR_LOSS_THRESH = 0.05;       // round loss rate that bounds inflight; below it loss is the link's, not ours
+constexpr double BBR_LOSS_BETA = 0.7;          // inflight bound after such a round, as a share of what was in flight
+
+enum class CongestionControl
+{
+    Aimd, // loss-based: multiplicative decrease on loss, QUIC-style recovery
+    Bbr,  // model-based: paces at the measured bottleneck bandwidth, ignores random loss
+};
+
+// LAN: gentle backoff (β=0.85) — bandwidth is abundant, losses are transient.
+//      Loose pacing: switch buffers absorb bursts, only smooth out the largest.
+// WAN: standard backoff (β=0.7, CUBIC-style) — avoid buffer-bloat cascading.
+//      Tight pacing: bursts overflow the shallow uplink queue of home routers.
+// LAN keeps AIMD, which holds the switch queues shortest. WAN runs BBR: it
+// trades the loss response for a bandwidth model, which suits lossy uplinks
+// and Wi-Fi that aren't actually full.
+struct NetworkProfile
+{
+    double beta;        // multiplicative decrease factor on loss
+    int maxRetransmits; // per-packet retransmit limit before closing
+    double pacingGain;  // pacing rate = gain × cwnd / srtt in congestion avoidance; 0 disables
+    int pacingBurst;    // packets that may leave back to back
+    CongestionControl congestionControl = CongestionControl::Aimd;
+};
+constexpr NetworkProfile LAN_PROFILE{0.85, 12, 2.0, 32, CongestionControl::Aimd};
+constexpr NetworkProfile WAN_PROFILE{0.7, 16, 1.25, 10, CongestionControl::Bbr};
+
+// Flags
+constexpr uint8_t FLAG_DATA = 0;
+constexpr uint8_t FLAG_ACK = 1;
+constexpr uint8_t FLAG_HELLO = 2;
+constexpr uint8_t FLAG_HELLO_ACK = 3;
+constexpr uint8_t FLAG_BYE = 4;
+constexpr uint8_t FLAG_PING = 5;
+
+// Wire format v2, used only once the peer has announced it. Its packet types
+// have the high bit set so they can be told apart whatever the receiver has
+// negotiated; v1 peers never see them.
+constexpr uint8_t PROTOCOL_VERSION = 8;
+constexpr uint8_t FLAG_V2 = 0x80;
+constexpr uint8_t FLAG_DATA_V2 = FLAG_V2 | FLAG_DATA; // [type][seq & 0xFFFF (2)][payload]
+constexpr uint8_t FLAG_ACK_V2 = FLAG_V2 | FLAG_ACK;   // [type][cumulative seq (4)][bitmap]
+constexpr size_t DATA_V2_HEADER_SIZE = 3;
+constexpr size_t ACK_BITMAP_BYTES = MAX_SEND_WINDOW / 8; // bit i: seq cumulative + 2 + i received
+
+// Lanes (v4): each delivered in its own order over the one seq space
+constexpr uint8_t FLAG_DATA_LANE = FLAG_V2 | 7; // [type][seq & 0xFFFF (2)][lane (1)][lane seq & 0xFFFF (2)][payload]
+constexpr size_t DATA_LANE_HEADER_SIZE = 6;
+constexpr size_t LANE_FIELDS_SIZE = DATA_LANE_HEADER_SIZE - DATA_V2_HEADER_SIZE;
+constexpr uint8_t LANE_CONTROL = 0; // RPC requests, responses, input events
+constexpr uint8_t LANE_MEDIA = 1;   // live media, FEC-protected
+constexpr uint8_t LANE_BULK = 2;    // file and thumbnail streams
+constexpr uint8_t LANE_COUNT = 3;
+constexpr double LANE_WEIGHTS[LANE_COUNT] = {8, 4, 1}; // share of packets while lanes compete
+constexpr size_t CONTROL_HEADROOM = 4; // packets control may have in flight past a full window
+
+// Forward error correction (v3): an XOR parity packet per group of media DATA
+constexpr uint8_t FLAG_PARITY = FLAG_V2 | 6; // [type][first seq (4)][count (1)][length xor (2)][payload xor]
+constexpr size_t PARITY_HEADER_SIZE = 8;
+constexpr uint8_t FLAG_PARITY_LANE = FLAG_V2 | 8; // [type][first seq (4)][member mask (8)][length xor (2)][lane fields + payload xor]
+constexpr size_t PARITY_LANE_HEADER_SIZE = 15;
+constexpr size_t FEC_MAX_SPAN = 64; // seqs one lane group may span: bits in the member mask
+constexpr size_t MAX_PARITY_BODY = MAX_PACKET_SIZE - PARITY_LANE_HEADER_SIZE;
+constexpr size_t FEC_MIN_GROUP = 4;
+constexpr size_t FEC_MAX_GROUP = 32;           // ~3% overhead on a loss-free link
+constexpr double FEC_LOSSES_PER_GROUP = 0.25;  // group size aims for this many expected losses
+constexpr uint64_t FEC_LOSS_SAMPLE = 32;       // packets sent before a loss-rate sample counts
+constexpr size_t FEC_HISTORY = 2 * FEC_MAX_GROUP; // delivered payloads a receiver keeps for recovery
+
+// Path MTU discovery (v5, RFC 8899): padded PINGs probe, FRAGMENTs survive a black hole
+constexpr uint8_t FLAG_PROBE_ACK = FLAG_V2 | 9; // [type][probe size (4)]
+constexpr uint8_t FLAG_FRAGMENT = FLAG_V2 | 10; // [type][seq (4)][index (1)][count (1)][piece of the DATA packet]
+constexpr size_t FRAGMENT_HEADER_SIZE = 7;
+constexpr size_t MAX_FRAGMENTS = (MAX_PACKET_SIZE - 1) / (BASE_PACKET_SIZE - FRAGMENT_HEADER_SIZE) + 1;
+constexpr size_t MTU_PROBE_SIZES[] = {1452, 1472, 8952, 8972}; // 1500 and 9000-byte frames, less IPv6 / IPv4 + UDP headers
+constexpr int MAX_PROBES = 3;                  // probes of one size lost before it counts as too big
+constexpr int BLACK_HOLE_ATTEMPTS = 3;         // sends of a larger-than-base packet without an ACK
+constexpr int64_t MTU_RAISE_INTERVAL_MS = 10 * 60 * 1000; // search again this long after the last one ended
+constexpr size_t MAX_REASSEMBLIES = 64;        // fragmented packets being put back together at once
+
+// ECN (v6, RFC 3168): ACKs echo the peer's ECT and CE counts
+constexpr uint8_t ECN_NOT_ECT = 0; // codepoints: the low two bits of the IP TOS / traffic class
+constexpr uint8_t ECN_ECT1 = 1;
+constexpr uint8_t ECN_ECT0 = 2;
+constexpr uint8_t ECN_CE = 3;
+constexpr uint8_t ECN_MASK = 3;
+constexpr uint8_t FLAG_ACK_ECN = FLAG_V2 | 11; // [type][cumulative seq (4)][ECN-capable count (4)][CE count (4)][bitmap]
+constexpr size_t ACK_ECN_COUNTS_SIZE = 8;
+constexpr uint32_t ECN_VALIDATION_PACKETS = 16; // marked packets ACKed before the peer must have seen a mark
+constexpr double ECN_BACKOFF_SHARE = 0.5;       // a CE mark cuts cwnd by this share of the loss backoff (RFC 8511)
+
+// Local drops (v7): the receiver owns up to datagrams its socket dropped (onLocalDrops())
+constexpr uint8_t FLAG_DROPS = FLAG_V2 | 12;   // [type][datagrams dropped by the sender's socket, running total (4)]
+constexpr int64_t LOCAL_DROP_GRACE_RTOS = 2;   // RTOs a report excuses losses for
+
+// Cookies (v8): a guarding socket's challenge, echoed in our HELLO (see ReadHandshake())
+constexpr uint8_t FLAG_COOKIE = FLAG_V2 | 13; // [type][cookie (4)]
+constexpr uint8_t COOKIE_VERSION = 8;         // peers before it can't echo a cookie
+
+constexpr int64_t NO_TIMEOUT = INT64_MAX;
+
+inline void WriteU32(uint8_t *p, uint32_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+inline uint32_t ReadU32(const uint8_t *p)
+{
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+/** Full seq nearest to `expected` whose low 16 bits are `truncated`. */
+inline uint32_t ExpandSeq(uint16_t truncated, uint32_t expected)
+{
+    int64_t candidate = (int64_t(expected) & ~int64_t(0xFFFF)) | truncated;
+    if (candidate + 0x8000 <= int64_t(expected) && candidate + 0x10000 <= int64_t(UINT32_MAX))
+        candidate += 0x10000;
+    else if (candidate > int64_t(expected) + 0x8000 && candidate >= 0x10000)
+        candidate -= 0x10000;
+    return static_cast<uint32_t>(candidate);
+}
+
+/** What a HELLO or HELLO_ACK says, for an owner screening datagrams before its session sees them. */
+struct HandshakeInfo
+{
+    bool isAck = false;
+    uint8_t version = 1; // bare handshakes are v1
+    bool hasCookie = false;
+    uint32_t cookie = 0;
+};
+
+/**
+ * Whether `buf` is a HELLO or HELLO_ACK, and what it announces.
+ * HELLO: [header(5)] [protocol version(1)] [cookie(4), once challenged];
+ * HELLO_ACK never carries a cookie.
+ */
+inline bool ReadHandshake(const uint8_t *buf, size_t len, HandshakeInfo &handshake)
+{
+    if (len < HEADER_SIZE || (buf[0] != FLAG_HELLO && buf[0] != FLAG_HELLO_ACK))
+        return false;
+    handshake.isAck = buf[0] == FLAG_HELLO_ACK;
+    if (len > HEADER_SIZE)
+        handshake.version = buf[HEADER_SIZE];
+    handshake.hasCookie = !handshake.isAck && len >= HEADER_SIZE + 5;
+    if (handshake.hasCookie)
+        handshake.cookie = ReadU32(buf + HEADER_SIZE + 1);
+    return true;
+}
+
+/** Write a COOKIE challenge carrying `cookie` to `out`; returns its length, HEADER_SIZE. */
+inline size_t WriteCookie(uint8_t *out, uint32_t cookie)
+{
+    out[0] = FLAG_COOKIE;
+    WriteU32(out + 1, cookie);
+    return HEADER_SIZE;
+}
+
+struct SessionStats
+{
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t packetsSent = 0;
+    uint64_t packetsReceived = 0;
+    uint64_t retransmits = 0;
+    double cwnd = 0;
+    double ssthresh = 0;
+    double srtt = 0;
+    int64_t rto = 0;
+    size_t inFlight = 0;
+    size_t queuedBytes = 0;
+    double pacingRate = 0;    // bytes/s new DATA is released at; 0 while unpaced
+    uint64_t pacingDelays = 0; // times the pacer held back a packet the window allowed
+    double lossRate = 0;       // smoothed share of DATA packets reported missing
+    uint64_t paritySent = 0;   // FEC parity packets sent
+    uint64_t fecRecovered = 0; // DATA packets rebuilt from parity instead of retransmitted
+    size_t mtu = 0;            // largest packet sent whole: the path MTU less IP and UDP headers
+    double bottleneckRate = 0; // bytes/s the BBR model measured the path at; 0 under AIMD
+    double minRtt = 0;         // ms, lowest recent RTT sample
+    bool isEcn = false;        // packets go out ECN-capable
+    uint64_t ceReported = 0;   // CE marks the peer echoed: congestion signalled without a drop
+    uint64_t localDrops = 0;   // datagrams our socket dropped, reported to the peer
+    uint64_t lossesExcused = 0; // losses the peer's socket owned up to, not taken for congestion
+    uint64_t cookiesAnswered = 0; // challenges from the peer's socket, answered with a HELLO
+};
+
+/**
+ * Token bucket spacing DATA departures at a target rate. Tokens are bytes,
+ * refilled at `rate` per ms up to a bucket of `burst` packets of the current
+ * size (or 2 ms worth at high rates, so the owner's millisecond timer never
+ * starves it). No rate (before the first RTT sample) means no pacing.
+ */
+class Pacer
+{
+public:
+    void setRate(double bytesPerMs, int burstPackets, size_t packetSize, int64_t now)
+    {
+        refill(now);
+        rate_ = bytesPerMs;
+        packetSize_ = static_cast<double>(packetSize);
+        capacity_ = std::max(burstPackets * packetSize_, rate_ * 2);
+        if (tokens_ > capacity_)
+            tokens_ = capacity_;
+    }
+
+    double rate() const { return rate_; }
+
+    bool canSend(int64_t now)
+    {
+        if (rate_ <= 0)
+            return true;
+        refill(now);
+        return tokens_ >= packetSize_;
+    }
+
+    void onSend(size_t bytes)
+    {
+        if (rate_ > 0)
+            tokens_ -= static_cast<double>(bytes);
+    }
+
+    /** When a full-size packet's worth of tokens is back. */
+    int64_t nextSendTime(int64_t now) const
+    {
+        if (rate_ <= 0 || tokens_ >= packetSize_)
+            return now;
+        return now + std::max<int64_t>(1, static_cast<int64_t>(std::ceil((packetSize_ - tokens_) / rate_)));
+    }
+
+private:
+    double rate_ = 0;     // bytes per ms
+    double packetSize_ = BASE_PACKET_SIZE;
+    double capacity_ = 0; // bytes
+    double tokens_ = 0;
+    int64_t lastRefill_ = 0;
+    bool isStarted_ = false;
+
+    void refill(int64_t now)
+    {
+        if (!isStarted_)
+        {
+            isStarted_ = true;
+            lastRefill_ = now;
+            tokens_ = capacity_;
+            return;
+        }
+        if (now > lastRefill_)
+        {
+            tokens_ = std::min(capacity_, tokens_ + rate_ * static_cast<double>(now - lastRefill_));
+            lastRefill_ = now;
+        }
+    }
+};
+
+/**
+ * Model-based congestion control after BBR v1 (Cardwell et al., "BBR:
+ * Congestion-Based Congestion Control", and the IETF draft). Instead of
+ * reading loss as congestion, it measures the path: the bottleneck bandwidth
+ * as the highest delivery rate of the last 10 round trips, and the
+ * propagation delay as the lowest RTT of the last 10 s. DATA is paced at a
+ * gain times that bandwidth, with cwnd at a gain times their product (the
+ * BDP), plus what the peer holds back for a delayed ACK, so a late ACK
+ * doesn't stall the pipe.
+ *
+ *   Startup   pacing and cwnd gain 2/ln 2, until the bandwidth stops growing
+ *             25% per round for 3 rounds
+ *   Drain     pacing gain ln 2 / 2, until what Startup queued has drained
+ *   ProbeBW   pacing gain cycles 1.25, 0.75, 1 × 6, one min RTT each: probe
+ *             for more bandwidth, drain what the probe queued, cruise
+ *   ProbeRTT  cwnd 4 for 200 ms once the min RTT is 10 s old, so queues
+ *             empty and the propagation delay can be measured again
+ *
+ * A delivery rate sample is taken per ACK, from the newest packet it newly
+ * delivered: bytes delivered since that packet was sent over the time since.
+ * Samples taken while the sender had nothing to send (app-limited) only
+ * count if they raise the estimate. Counts in bytes, times in ms.
+ *
+ * Random loss is ignored, which is the point on Wi-Fi, but a shallow
+ * bottleneck queue overflowing at a cwnd of 2 BDP would otherwise drop
+ * packets every round until retransmits run out. As in BBR v2, a round
+ * losing more than 5% bounds inflight to 0.7 of what it had out, but not
+ * below one BDP (and ends Startup); each clean round the bound is hit, it
+ * is raised by an eighth.
+ */
+class Bbr
+{
+public:
+    enum class Mode
+    {
+        Startup,
+        Drain,
+        ProbeBw,
+        ProbeRtt,
+    };
+
+    // Delivery progress when a packet was sent, for the rate sample its delivery yields
+    struct SendState
+    {
+        uint64_t delivered = 0;
+        int64_t deliveredAt = 0;
+        bool isAppLimited = false;
+    };
+
+    SendState onSend(int64_t now, size_t bytesInFlight)
+    {
+        // Restart the interval after an idle period, or it spans the idle time
+        if (bytesInFlight == 0)
+            deliveredAt_ = now;
+        return {delivered_, deliveredAt_, delivered_ < appLimitedUntil_};
+    }
+
+    /** Nothing left to send with the window open: samples until what is in flight now is delivered understate the path. */
+    void onAppLimited(size_t bytesInFlight) { appLimitedUntil_ = std::max<uint64_t>(delivered_ + bytesInFlight, 1); }
+
+    /** A packet was declared lost (once per packet), or the peer saw it CE-marked. */
+    void onLoss(size_t bytes) { lostInRound_ += bytes; }
+
+    /** A packet reached the receiver (first cumulative ACK or SACK). `rtt`: -1 for retransmitted packets. */
+    void onDelivered(size_t bytes, const SendState &state, int64_t now, int64_t rtt)
+    {
+        delivered_ += bytes;
+        deliveredAt_ = now;
+        ackedBytes_ += bytes;
+        if (!hasSample_ || state.delivered >= sample_.delivered)
+        {
+            sample_ = state;
+            hasSample_ = true;
+        }
+        if (rtt >= 0 && (sampleRtt_ < 0 || rtt < sampleRtt_))
+            sampleRtt_ = rtt;
+    }
+
+    /**
+     * End of an ACK: update the model with what it delivered, move between
+     * modes, and return the new cwnd (packets) from the current one.
+     */
+    double onAck(int64_t now, size_t bytesInFlight, size_t packetSize, double cwnd)
+    {
+        if (!hasSample_)
+            return cwnd;
+        const SendState sample = sample_;
+        const int64_t rtt = sampleRtt_;
+        const double ackedPackets = static_cast<double>(ackedBytes_) / static_cast<double>(packetSize);
+        hasSample_ = false;
+        sampleRtt_ = -1;
+        ackedBytes_ = 0;
+
+        // A round ends when a packet sent after the previous one ended is delivered
+        bool isRoundStart = false;
+        const double inFlight = static_cast<double>(bytesInFlight) / static_cast<double>(packetSize);
+        if (sample.delivered >= nextRoundDelivered_)
+        {
+            const double roundDelivered = static_cast<double>(delivered_ - nextRoundDelivered_);
+            const double roundLost = static_cast<double>(lostInRound_);
+            if (roundLost > BBR_LOSS_THRESH * (roundDelivered + roundLost))
+            {
+                inflightBound_ = std::max(BBR_MIN_CWND, std::min(cwnd, inFlight) * BBR_LOSS_BETA);
+                isPipeFull_ = true;
+            }
+            else if (inflightBound_ > 0 && cwnd >= inflightBound_)
+                inflightBound_ *= 1.125;
+            lostInRound_ = 0;
+            nextRoundDelivered_ = delivered_;
+            roundCount_++;
+            bwRounds_[roundCount_ % BBR_BW_ROUNDS] = 0;
+            isRoundStart = true;
+        }
+        // Shorter than a round trip: ACK compression, not the path's rate
+        const int64_t interval = now - sample.deliveredAt;
+        if (interval > 0 && (minRtt_ == 0 || interval >= minRtt_))
+        {
+            double rate = static_cast<double>(delivered_ - sample.delivered) / static_cast<double>(interval);
+            if (!sample.isAppLimited || rate >= bottleneckRate())
+            {
+                double &slot = bwRounds_[roundCount_ % BBR_BW_ROUNDS];
+                slot = std::max(slot, rate);
+            }
+        }
+
+        const bool isMinRttExpired = minRtt_ > 0 && now - minRttAt_ > BBR_MIN_RTT_WINDOW_MS;
+        if (rtt >= 0 && (minRtt_ == 0 || rtt <= minRtt_ || isMinRttExpired))
+        {
+            minRtt_ = std::max<int64_t>(rtt, 1);
+            minRttAt_ = now;
+        }
+
+        if (isRoundStart && !isPipeFull_ && !sample.isAppLimited)
+            checkFullPipe();
+        const double bdp = bottleneckRate() * static_cast<double>(minRtt_) / static_cast<double>(packetSize);
+        if (mode_ == Mode::Startup && isPipeFull_)
+            mode_ = Mode::Drain;
+        if (mode_ == Mode::Drain && inFlight <= bdp)
+            enterProbeBw(now);
+        if (mode_ == Mode::ProbeBw)
+            advanceCycle(now, inFlight, bdp);
+        if (isMinRttExpired && mode_ != Mode::ProbeRtt)
+        {
+            mode_ = Mode::ProbeRtt;
+            probeRttDoneAt_ = 0;
+        }
+        if (mode_ == Mode::ProbeRtt)
+        {
+            if (probeRttDoneAt_ == 0 && inFlight <= BBR_MIN_CWND)
+                probeRttDoneAt_ = now + std::max(BBR_PROBE_RTT_MS, minRtt_);
+            if (probeRttDoneAt_ != 0 && now >= probeRttDoneAt_)
+            {
+                minRttAt_ = now;
+                if (isPipeFull_)
+                    enterProbeBw(now);
+                else
+                    mode_ = Mode::Startup;
+            }
+        }
+
+        // cwnd: gain × BDP, plus what the peer may hold before its delayed
+        // ACK (up to a batch, or MAX_ACK_DELAY_MS worth): without it the
+        // window closes while those ACKs are pending and caps the rate
+        if (mode_ == Mode::ProbeRtt)
+            return BBR_MIN_CWND;
+        if (bdp <= 0)
+            return cwnd + ackedPackets; // no model yet: grow like slow start
+        const double ackHeld = std::min<double>(ACK_BATCH_SIZE,
+            bottleneckRate() * static_cast<double>(MAX_ACK_DELAY_MS) / static_cast<double>(packetSize));
+        double target = cwndGain() * bdp + ackHeld + 3;
+        // Never below one BDP, or loss the link causes anyway shrinks the
+        // bound, then the rate it measures, then the bound again
+        if (inflightBound_ > 0)
+            target = std::min(target, std::max(inflightBound_, bdp + ackHeld + 3));
+        if (isPipeFull_ || inflightBound_ > 0)
+            cwnd = std::min(cwnd + ackedPackets, target);
+        else if (cwnd < target)
+            cwnd += ackedPackets;
+        return std::max(cwnd, BBR_MIN_CWND);
+    }
+
+    /** Bytes per ms to pace at; before the first sample, from cwnd / srtt like slow start. */
+    double pacingRate(double cwnd, double srtt, size_t packetSize) const
+    {
+        double rate = bottleneckRate();
+        if (rate <= 0)
+            rate = cwnd * static_cast<double>(packetSize) / std::max(srtt, 1.0);
+        return pacingGain() * rate;
+    }
+
+    /** Bytes per ms the path delivers at, 0 until measured. */
+    double bottleneckRate() const { return *std::max_element(std::begin(bwRounds_), std::end(bwRounds_)); }
+
+    int64_t minRtt() const { return minRtt_; }
+    Mode mode() const { return mode_; }
+
+private:
+    Mode mode_ = Mode::Startup;
+    uint64_t delivered_ = 0;
+    int64_t deliveredAt_ = 0;
+    uint64_t appLimitedUntil_ = 0; // delivered_ at which samples reflect the path again
+
+    // Current ACK
+    SendState sample_;
+    bool hasSample_ = false;
+    int64_t sampleRtt_ = -1;
+    uint64_t ackedBytes_ = 0;
+    uint64_t lostInRound_ = 0;
+
+    uint64_t roundCount_ = 0;
+    uint64_t nextRoundDelivered_ = 0;
+    double bwRounds_[BBR_BW_ROUNDS] = {}; // max delivery rate per round
+    int64_t minRtt_ = 0;
+    int64_t minRttAt_ = 0;
+
+    bool isPipeFull_ = false;
+    double fullBw_ = 0;
+    int fullBwRounds_ = 0;
+    size_t cycleIndex_ = 0;
+    int64_t cycleStart_ = 0;
+    int64_t probeRttDoneAt_ = 0;
+    double inflightBound_ = 0; // packets; 0 until a round loses too much
+
+    double pacingGain() const
+    {
+        switch (mode_)
+        {
+        case Mode::Startup:
+            return BBR_HIGH_GAIN;
+        case Mode::Drain:
+            return 1 / BBR_HIGH_GAIN;
+        case Mode::ProbeBw:
+            return BBR_PROBE_GAINS[cycleIndex_];
+        default:
+            return 1;
+        }
+    }
+
+    double cwndGain() const { return mode_ == Mode::ProbeBw ? BBR_CWND_GAIN : BBR_HIGH_GAIN; }
+
+    void checkFullPipe()
+    {
+        double bw = bottleneckRate();
+        if (bw >= fullBw_ * 1.25)
+        {
+            fullBw_ = bw;
+            fullBwRounds_ = 0;
+            return;
+        }
+        if (++fullBwRounds_ >= BBR_FULL_BW_ROUNDS)
+            isPipeFull_ = true;
+    }
+
+    // Start cruising rather than probing: the queue Drain just emptied shouldn't be refilled at once
+    void enterProbeBw(int64_t now)
+    {
+        mode_ = Mode::ProbeBw;
+        cycleIndex_ = 2;
+        cycleStart_ = now;
+    }
+
+    void advanceCycle(int64_t now, double inFlight, double bdp)
+    {
+        bool isPhaseDone = now - cycleStart_ > minRtt_;
+        // The drain phase may end as soon as the probe's queue is gone
+        if (BBR_PROBE_GAINS[cycleIndex_] < 1 && inFlight <= bdp)
+            isPhaseDone = true;
+        if (!isPhaseDone)
+            return;
+        cycleIndex_ = (cycleIndex_ + 1) % (sizeof(BBR_PROBE_GAINS) / sizeof(BBR_PROBE_GAINS[0]));
+        cycleStart_ = now;
+    }
+};
+
+class Session
+{
+public:
+    struct Callbacks
+    {
+        std::function<void(const uint8_t *data, size_t len)> transmit; // raw packet to the peer
+        std::function<void(const uint8_t *data, size_t len, uint8_t lane)> deliver; // in-order payload bytes of one lane
+        std::function<void(bool isSuccess)> ready;
+        std::function<void(const std::string &error)> closed;          // empty error: clean close
+    };
+
+    explicit Session(const NetworkProfile &profile) : profile_(profile) {}
+
+    Session(const NetworkProfile &profile, Callbacks callbacks)
+        : profile_(profile), cb_(std::move(callbacks))
+    {
+    }
+
+    void setCallbacks(Callbacks callbacks) { cb_ = std::move(callbacks); }
+
+    void start(int64_t now)
+    {
+        timers_.reset(now);
+        lastPingReceived_ = now;
+        lastDataActivity_ = now;
+        retransmitBudgetStart_ = now;
+        timers_.schedule(pingTimer_, now + PING_INTERVAL_MS);
+        sendHello(now);
+    }
+
+    bool isReady() const { return isReady_; }
+    bool isClosed() const { return isClosing_; }
+
+    /**
+     * Probe for packets larger than BASE_PACKET_SIZE once the peer speaks v5.
+     * Only for owners that send with the don't-fragment bit set: otherwise
+     * the path fragments a probe instead of dropping it, and every size fits.
+     * `knownSize`, what an earlier session with the peer found, is probed first;
+     * nothing past `maxSize`, the most the owner's route takes, is probed.
+     */
+    void enableMtuProbing(size_t knownSize = 0, size_t maxSize = MAX_PACKET_SIZE)
+    {
+        canProbe_ = true;
+        maxProbeSize_ = std::min(maxSize, MAX_PACKET_SIZE);
+        probeHint_ = knownSize > BASE_PACKET_SIZE && knownSize <= maxProbeSize_ ? knownSize : 0;
+    }
+
+    /**
+     * The owner's socket no longer sends with the don't-fragment bit set.
+     * Packets go back to the base size and the search stops for good.
+     */
+    void disableMtuProbing()
+    {
+        canProbe_ = false;
+        probeTimer_.cancel();
+        probeSize_ = 0;
+        packetSize_ = BASE_PACKET_SIZE;
+    }
+
+    /**
+     * The owner's socket refused a `size`-byte packet as too big for its
+     * route. A probe of that size counts as lost for good at once; a packet
+     * size the route took before has shrunk as a black hole would. Nothing
+     * that size or more is probed again.
+     */
+    void onSendTooBig(size_t size, int64_t now)
+    {
+        if (size <= BASE_PACKET_SIZE)
+            return;
+        maxProbeSize_ = std::min(maxProbeSize_, size - 1);
+        if (size == probeSize_)
+        {
+            probeCeiling_ = size;
+            probeSize_ = 0;
+            probeMtu(now);
+        }
+        else if (size <= packetSize_)
+        {
+            onBlackHole(size, now);
+        }
+    }
+
+    /**
+     * Mark packets ECN-capable once the peer speaks v6, and echo the marks
+     * received. Only for owners that pass each datagram's ECN field to
+     * onPacket() and send each with ecnCodepoint().
+     */
+    void enableEcn() { isEcnEnabled_ = true; }
+
+    /**
+     * The owner's socket dropped `count` datagrams on receive for lack of
+     * buffer room, which it is adding. Tells a v7 peer, so it doesn't cut its
+     * window for them. Drops that more buffer won't fix are congestion and
+     * shouldn't be reported.
+     */
+    void onLocalDrops(uint32_t count)
+    {
+        localDrops_ += count;
+        stats_.localDrops += count;
+        if (isReady_ && !isClosing_ && wireVersion() >= 7)
+            sendControl(FLAG_DROPS, localDrops_);
+    }
+
+    /** ECN field to send packets with right now: ECT(0), or not ECN-capable. */
+    uint8_t ecnCodepoint() const { return isEcnMarking() ? ECN_ECT0 : ECN_NOT_ECT; }
+
+    /** Largest packet sent whole right now. */
+    size_t packetSize() const { return packetSize_; }
+
+    /** Bytes accepted by send() that are not yet packetized into the window. */
+    size_t queuedBytes() const { return queuedBytes_; }
+
+    /** Same, for one lane. */
+    size_t queuedBytes(uint8_t lane) const { return lane < LANE_COUNT ? lanes_[lane].bytes : 0; }
+
+    /**
+     * Lane that data sent now travels on, and is delivered on: `lane` once
+     * the peer speaks v4, control until then.
+     */
+    uint8_t laneFor(uint8_t lane) const { return wireVersion() >= 4 && lane < LANE_COUNT ? lane : LANE_CONTROL; }
+
+    /**
+     * Queue application data on a lane; packetized as window space allows.
+     * Data sent on the media lane is FEC-protected once the peer speaks v3:
+     * its packets don't share payload with other sends, and a parity packet
+     * closes each group and the end of each media send.
+     */
+    void send(std::vector<uint8_t> data, int64_t now, uint8_t lane = LANE_CONTROL)
+    {
+        if (isClosing_ || data.empty())
+            return;
+        Lane &l = lanes_[laneFor(lane)];
+        queuedBytes_ += data.size();
+        l.bytes += data.size();
+        l.queue.push_back({std::move(data), lane == LANE_MEDIA});
+        pump(now);
+    }
+
+    void send(const uint8_t *data, size_t len, int64_t now, uint8_t lane = LANE_CONTROL)
+    {
+        send(std::vector<uint8_t>(data, data + len), now, lane);
+    }
+
+    /**
+     * Feed one datagram received from the peer, with the ECN field of its IP
+     * header when the owner can read it, and when it reached the host (the
+     * kernel's receive timestamp, on the same clock as `now`; -1 if unknown)
+     * so time it spent queued for the owner stays out of RTT samples. Call
+     * flush() after a batch.
+     */
+    void onPacket(const uint8_t *buf, size_t len, int64_t now, uint8_t ecn = ECN_NOT_ECT, int64_t arrivedAt = -1)
+    {
+        if (isClosing_ || len == 0)
+            return;
+        if ((ecn & ECN_MASK) != ECN_NOT_ECT)
+            countEcn(buf[0], ecn);
+        if (buf[0] == FLAG_DATA_V2 && len >= DATA_V2_HEADER_SIZE)
+        {
+            markReady();
+            peerVersion_ = std::max<uint8_t>(peerVersion_, 2);
+            stats_.packetsReceived++;
+            uint32_t seq = ExpandSeq(static_cast<uint16_t>((buf[1] << 8) | buf[2]), recvSeq_);
+            handleData(seq, LANE_CONTROL, seq, buf + DATA_V2_HEADER_SIZE, len - DATA_V2_HEADER_SIZE, now);
+            return;
+        }
+        if (buf[0] == FLAG_DATA_LANE && len >= DATA_LANE_HEADER_SIZE)
+        {
+            markReady();
+            peerVersion_ = std::max<uint8_t>(peerVersion_, 4);
+            stats_.packetsReceived++;
+            uint8_t lane = buf[3];
+            if (lane >= LANE_COUNT)
+                return;
+            uint32_t seq = ExpandSeq(static_cast<uint16_t>((buf[1] << 8) | buf[2]), recvSeq_);
+            uint32_t laneSeq = ExpandSeq(static_cast<uint16_t>((buf[4] << 8) | buf[5]), laneNext_[lane]);
+            handleData(seq, lane, laneSeq, buf + DATA_LANE_HEADER_SIZE, len - DATA_LANE_HEADER_SIZE, now);
+            return;
+        }
+        if (len < HEADER_SIZE)
+        {
+            close(now, "Invalid packet: too short");
+            return;
+        }
+        uint8_t type = buf[0];
+        uint32_t seq = ReadU32(buf + 1);
+        // From the peer's socket, not its session: no sign the peer is ready
+        if (type == FLAG_COOKIE)
+        {
+            onCookie(seq, now);
+            return;
+        }
+        markReady();
+
+        switch (type)
+        {
+        case FLAG_DATA:
+            stats_.packetsReceived++;
+            handleData(seq, LANE_CONTROL, seq, buf + HEADER_SIZE, len - HEADER_SIZE, now);
+            break;
+        case FLAG_ACK:
+        case FLAG_ACK_V2:
+        case FLAG_ACK_ECN:
+            handleAck(type, seq, buf, len, now, arrivedAt >= 0 && arrivedAt < now ? arrivedAt : now);
+            break;
+        case FLAG_PARITY:
+        case FLAG_PARITY_LANE:
+            handleParity(buf, len, now);
+            break;
+        case FLAG_HELLO:
+            lastPingReceived_ = now;
+            onPeerVersion(buf, len);
+            sendHandshake(FLAG_HELLO_ACK);
+            startMtuSearch(now);
+            break;
+        case FLAG_HELLO_ACK:
+            lastPingReceived_ = now;
+            isHelloAcked_ = true;
+            onPeerVersion(buf, len);
+            startMtuSearch(now);
+            break;
+        case FLAG_PING:
+            lastPingReceived_ = now;
+            // A probe, if padded to the size in its seq; a truncated one isn't confirmed
+            if (len > HEADER_SIZE && seq == len)
+                sendControl(FLAG_PROBE_ACK, seq);
+            break;
+        case FLAG_DROPS:
+            onPeerDrops(seq, now);
+            break;
+        case FLAG_PROBE_ACK:
+            onProbeAck(seq, now);
+            break;
+        case FLAG_FRAGMENT:
+            handleFragment(seq, buf, len, now);
+            break;
+        case FLAG_BYE:
+            isRemoteClosed_ = true;
+            close(now);
+            break;
+        default:
+            break; // unknown type: ignore, like the TS side
+        }
+    }
+
+    /**
+     * End of an input batch: send the SACK scheduled by out-of-order data and
+     * hand everything that became deliverable to the application, one call
+     * per lane, control first.
+     */
+    void flush()
+    {
+        if (isClosing_)
+            return;
+        if (sackScheduled_)
+        {
+            sackScheduled_ = false;
+            sendAck(recvSeq_ - 1);
+        }
+        for (uint8_t lane = 0; lane < LANE_COUNT && !isClosing_; lane++)
+        {
+            if (pendingDeliver_[lane].empty())
+                continue;
+            std::vector<uint8_t> out;
+            out.swap(pendingDeliver_[lane]);
+            if (cb_.deliver)
+                cb_.deliver(out.data(), out.size(), lane);
+        }
+    }
+
+    /** Run due timers. */
+    void poll(int64_t now)
+    {
+        if (isClosing_)
+            return;
+        timers_.advance(now, [this, now](net::TimerWheel::Timer &timer) { onTimer(timer, now); });
+        if (!isClosing_)
+            pump(now);
+    }
+
+    /**
+     * Absolute time (ms) at which poll() next has work to do. May come early
+     * for timers more than 64 ms out; poll() then just moves them along.
+     */
+    int64_t nextTimeout() const
+    {
+        if (isClosing_)
+            return NO_TIMEOUT;
+        return timers_.nextDeadline();
+    }
+
+    /** Graceful close: notify the peer with BYE (best effort) and stop. */
+    void close(int64_t now, const std::string &error = std::string())
+    {
+        (void)now;
+        if (isClosing_)
+            return;
+        if (!isRemoteClosed_ && isReady_)
+            sendControl(FLAG_BYE);
+        isClosing_ = true;
+        sendWindow_.clear();
+        sackedInFlight_ = 0;
+        bytesInFlight_ = 0;
+        controlInFlight_ = 0;
+        received_.clear();
+        for (uint8_t lane = 0; lane < LANE_COUNT; lane++)
+        {
+            lanes_[lane].queue.clear();
+            lanes_[lane].bytes = 0;
+            laneWaiting_[lane].clear();
+            pendingDeliver_[lane].clear();
+        }
+        fecHistory_.clear();
+        reassembly_.clear();
+        queuedBytes_ = 0;
+        timers_.clear();
+        if (!isReady_ && cb_.ready)
+            cb_.ready(false);
+        if (cb_.closed)
+            cb_.closed(error);
+    }
+
+    SessionStats stats() const
+    {
+        SessionStats s = stats_;
+        s.cwnd = cwnd_;
+        s.ssthresh = ssthresh_;
+        s.srtt = srtt_;
+        s.rto = rto_;
+        s.inFlight = sendWindow_.size();
+        s.queuedBytes = queuedBytes_;
+        s.pacingRate = pacer_.rate() * 1000;
+        s.lossRate = lossRate_;
+        s.mtu = packetSize_;
+        s.minRtt = minRtt_;
+        s.isEcn = isEcnMarking();
+        if (isBbr())
+        {
+            s.bottleneckRate = bbr_.bottleneckRate() * 1000;
+            s.minRtt = static_cast<double>(bbr_.minRtt());
+        }
+        return s;
+    }
+
+    /** Wire format in use towards the peer: 1 until it announces v2 or later. */
+    uint8_t wireVersion() const { return std::min(PROTOCOL_VERSION, peerVersion_); }
+
+private:
+    // What a timer fired for
+    enum TimerKind : uint32_t
+    {
+        TIMER_HELLO,
+        TIMER_ACK,          // delayed ACK
+        TIMER_PING,         // keepalive, and the peer's silence
+        TIMER_LOSS_SAMPLE,
+        TIMER_PACE,         // pump() is waiting for the pacer
+        TIMER_PROBE,        // probe (again), or start the next MTU search
+        TIMER_RETRANSMIT,   // a SentPacket's
+    };
+
+    // A DATA packet in the window; its own retransmit timer while not SACKed
+    struct SentPacket : net::TimerWheel::Timer
+    {
+        SentPacket() : Timer(TIMER_RETRANSMIT) {}
+
+        uint32_t seq = 0;
+        std::vector<uint8_t> packet;
+        int64_t sentAt = 0;
+        int attempts = 1;
+        bool sacked = false;
+        bool isLost = false; // noted as lost (in the loss rate unless a local drop)
+        bool isLocalDrop = false; // lost in the peer's socket buffer, not on the path
+        Bbr::SendState delivery; // at its last send, for BBR's rate sample
+    };
+
+    struct QueuedSend
+    {
+        std::vector<uint8_t> data;
+        bool isMedia;
+    };
+
+    // One lane's sending side
+    struct Lane
+    {
+        std::deque<QueuedSend> queue;
+        size_t offset = 0;    // consumed bytes of queue.front()
+        size_t bytes = 0;     // queued, not yet packetized
+        uint32_t nextSeq = 1; // lane seq of its next DATA packet
+        double finish = 0;    // virtual time its last packet finished at
+    };
+
+    // A DATA packet received ahead of the cumulative ACK point
+    struct Received
+    {
+        uint8_t lane = LANE_CONTROL;
+        uint32_t laneSeq = 0;
+        std::vector<uint8_t> payload;
+    };
+
+    // Payload of a packet already past the ACK point, for rebuilding a later loss
+    struct DeliveredPayload
+    {
+        uint32_t seq = 0;
+        Received packet;
+    };
+
+    // A DATA packet arriving in FRAGMENTs
+    struct Reassembly
+    {
+        size_t count = 0;
+        size_t have = 0;
+        std::vector<uint8_t> pieces[MAX_FRAGMENTS];
+    };
+
+    static uint8_t LaneOf(const std::vector<uint8_t> &packet)
+    {
+        return packet[0] == FLAG_DATA_LANE ? packet[3] : LANE_CONTROL;
+    }
+
+    NetworkProfile profile_;
+    Callbacks cb_;
+
+    uint32_t sendSeq_ = 1;
+    uint32_t recvSeq_ = 1;
+    uint32_t sendBase_ = 1; // first un-ACKed sequence
+
+    // Declared ahead of everything holding a timer, so it outlives them
+    net::TimerWheel timers_;
+    net::TimerWheel::Timer helloTimer_{TIMER_HELLO};
+    net::TimerWheel::Timer ackTimer_{TIMER_ACK};
+    net::TimerWheel::Timer pingTimer_{TIMER_PING};
+    net::TimerWheel::Timer lossSampleTimer_{TIMER_LOSS_SAMPLE};
+    net::TimerWheel::Timer paceTimer_{TIMER_PACE};
+    net::TimerWheel::Timer probeTimer_{TIMER_PROBE};
+
+    std::map<uint32_t, SentPacket> sendWindow_;
+    int64_t retransmitBudgetStart_ = 0; // timer retransmits are capped per RETRANSMIT_SCAN_INTERVAL
+    int retransmitBudget_ = MAX_RETRANSMITS_PER_SCAN;
+
+    // Receiving: packets past recvSeq_ (delivered or not) for SACK and FEC,
+    // in ring slot seq % MAX_BUFFERED_PACKETS, and per lane the next lane seq
+    // to deliver and those that wait for it
+    net::SeqRing<Received> received_{MAX_BUFFERED_PACKETS};
+    uint32_t laneNext_[LANE_COUNT] = {1, 1, 1};
+    std::map<uint32_t, uint32_t> laneWaiting_[LANE_COUNT]; // lane seq → seq
+    std::vector<uint8_t> pendingDeliver_[LANE_COUNT];
+
+    Lane lanes_[LANE_COUNT];
+    double virtualTime_ = 0; // start of the last packet scheduled, for weighted fair queueing
+    size_t sackedInFlight_ = 0;  // packets in sendWindow_ the receiver already has
+    size_t bytesInFlight_ = 0;   // of packets in sendWindow_ not yet SACKed
+    size_t controlInFlight_ = 0; // control packets sent and neither ACKed nor SACKed
+    size_t queuedBytes_ = 0;
+
+    // FEC group being sent: XOR of its payloads (with lane fields) so far
+    uint32_t fecFirst_ = 0;
+    uint64_t fecMask_ = 0; // bit i: fecFirst_ + i is in the group
+    size_t fecCount_ = 0;
+    bool isFecLaneGroup_ = false;
+    size_t fecLength_ = 0; // longest payload in the group
+    uint16_t fecLengthXor_ = 0;
+    uint8_t fecParity_[MAX_PARITY_BODY];
+
+    // Loss rate sizing the FEC groups, sampled every RETRANSMIT_SCAN_INTERVAL while sending
+    double lossRate_ = 0;
+    uint64_t lostPackets_ = 0;
+    uint64_t lossSampleSent_ = 0;
+    uint64_t lossSampleLost_ = 0;
+
+    // Receiving: filled from the first parity packet on, slot seq % FEC_HISTORY
+    std::vector<DeliveredPayload> fecHistory_;
+
+    uint32_t ackPending_ = 0;
+    bool sackScheduled_ = false;
+
+    bool isReady_ = false;
+    bool isRemoteClosed_ = false;
+    bool isClosing_ = false;
+
+    int helloAttempts_ = 0;
+    bool isHelloAcked_ = false; // the peer answered our HELLO
+    bool hasCookie_ = false; // challenged by the peer's socket (v8)
+    uint32_t cookie_ = 0;
+    int64_t cookieAnsweredAt_ = 0;
+    int64_t lastPingReceived_ = 0;
+
+    // Adaptive RTO (Jacobson's algorithm, RFC 6298)
+    double srtt_ = 0;
+    double rttvar_ = 0;
+    int64_t rto_ = INITIAL_RTO;
+    bool rttMeasured_ = false;
+    double minRtt_ = 0;
+    int64_t lastDataActivity_ = 0;
+
+    // Congestion control: AIMD, or cwnd from BBR's model (profile_.congestionControl)
+    Bbr bbr_;
+    double cwnd_ = INITIAL_CWND;
+    double ssthresh_ = INITIAL_SSTHRESH;
+    uint32_t recoverySeq_ = 0;
+    bool inRecovery_ = false;
+    int64_t recoveryUntil_ = 0;
+
+    uint8_t peerVersion_ = 1; // from its HELLO / HELLO_ACK, or any v2 packet
+
+    // ECN: what we received, echoed in ACKs, and what the peer echoed back
+    bool isEcnEnabled_ = false;
+    bool isEcnFailed_ = false;
+    uint32_t ecnCheckSeq_ = 0;   // ACKed past this, the peer must have seen marks; 0 until marking
+    uint32_t ecnReceived_ = 0;   // ECN-capable packets received, CE included
+    uint32_t ceReceived_ = 0;
+    uint32_t peerEcnReceived_ = 0;
+    uint32_t peerCeReceived_ = 0;
+    uint32_t ecnRecoverySeq_ = 0; // one cwnd cut per window: not again until this is ACKed
+
+    // Local drops: our running total, and losses the peer's total still excuses
+    uint32_t localDrops_ = 0;
+    uint32_t peerDrops_ = 0;
+    uint32_t dropsToExcuse_ = 0;
+    int64_t excuseUntil_ = 0;
+
+    Pacer pacer_;
+
+    // Path MTU: packets up to packetSize_ go out whole, and a search for
+    // more probes one size at a time
+    size_t packetSize_ = BASE_PACKET_SIZE;
+    bool canProbe_ = false;
+    bool isMtuSearchStarted_ = false;
+    size_t probeSize_ = 0;            // awaiting its PROBE_ACK; 0: none
+    size_t probeHint_ = 0;            // probed first: what an earlier session found
+    size_t probeCeiling_ = SIZE_MAX;  // smallest size found too big this search
+    size_t maxProbeSize_ = MAX_PACKET_SIZE; // most the owner's route takes
+    int probeAttempts_ = 0;
+    std::map<uint32_t, Reassembly> reassembly_;
+
+    SessionStats stats_;
+
+    void markReady()
+    {
+        if (isReady_)
+            return;
+        isReady_ = true;
+        helloTimer_.cancel();
+        if (cb_.ready)
+            cb_.ready(true);
+    }
+
+    void transmit(const uint8_t *data, size_t len)
+    {
+        if (cb_.transmit)
+            cb_.transmit(data, len);
+    }
+
+    void sendControl(uint8_t type, uint32_t seq = 0)
+    {
+        uint8_t header[HEADER_SIZE];
+        header[0] = type;
+        WriteU32(header + 1, seq);
+        transmit(header, HEADER_SIZE);
+    }
+
+    // HELLO / HELLO_ACK: [header(5)] [protocol version(1)]; v1 peers ignore the extra byte.
+    // A HELLO also echoes the cookie the peer's socket last challenged us with.
+    void sendHandshake(uint8_t type)
+    {
+        uint8_t pkt[HEADER_SIZE + 5];
+        pkt[0] = type;
+        WriteU32(pkt + 1, 0);
+        pkt[HEADER_SIZE] = PROTOCOL_VERSION;
+        size_t len = HEADER_SIZE + 1;
+        if (type == FLAG_HELLO && hasCookie_)
+        {
+            WriteU32(pkt + len, cookie_);
+            len += 4;
+        }
+        transmit(pkt, len);
+    }
+
+    // The peer's socket holds our packets back until a HELLO echoes this.
+    // Answered at once, ready or not (the peer may have let us in on its
+    // side already), but only until our HELLO is answered and at most once
+    // per RTO: a forged stream of cookies mustn't turn into one of HELLOs.
+    void onCookie(uint32_t cookie, int64_t now)
+    {
+        if (isHelloAcked_ || (hasCookie_ && now - cookieAnsweredAt_ < rto_))
+            return;
+        hasCookie_ = true;
+        cookie_ = cookie;
+        cookieAnsweredAt_ = now;
+        stats_.cookiesAnswered++;
+        sendHandshake(FLAG_HELLO);
+    }
+
+    // v1 peers send bare handshakes
+    void onPeerVersion(const uint8_t *buf, size_t len)
+    {
+        if (len > HEADER_SIZE)
+            peerVersion_ = std::max(peerVersion_, buf[HEADER_SIZE]);
+    }
+
+    void sendHello(int64_t now)
+    {
+        if (isReady_ || isClosing_)
+            return;
+        if (++helloAttempts_ > HELLO_MAX_RETRIES)
+        {
+            isRemoteClosed_ = true;
+            close(now, "Failed to establish connection: no HELLO_ACK received");
+            return;
+        }
+        sendHandshake(FLAG_HELLO);
+        timers_.schedule(helloTimer_, now + INITIAL_RTO);
+    }
+
+    // Once the handshake shows the peer answers probes
+    void startMtuSearch(int64_t now)
+    {
+        if (!canProbe_ || isMtuSearchStarted_ || wireVersion() < 5)
+            return;
+        isMtuSearchStarted_ = true;
+        probeMtu(now);
+    }
+
+    // Next size to try: the hint, then the candidates between what fits and what didn't
+    size_t nextProbeSize()
+    {
+        size_t hint = probeHint_;
+        probeHint_ = 0;
+        if (hint > packetSize_ && hint < probeCeiling_ && hint <= maxProbeSize_)
+            return hint;
+        for (size_t size : MTU_PROBE_SIZES)
+        {
+            if (size > packetSize_ && size < probeCeiling_ && size <= maxProbeSize_)
+                return size;
+        }
+        return 0;
+    }
+
+    // Send a probe: the one awaiting its PROBE_ACK again, or the next size
+    // once that one counts as too big. Probes are not DATA: not in the window,
+    // not retransmitted, and their loss isn't congestion.
+    void probeMtu(int64_t now)
+    {
+        probeTimer_.cancel();
+        if (probeSize_ != 0 && probeAttempts_ >= MAX_PROBES)
+        {
+            probeCeiling_ = probeSize_;
+            probeSize_ = 0;
+        }
+        if (probeSize_ == 0)
+        {
+            probeSize_ = nextProbeSize();
+            probeAttempts_ = 0;
+        }
+        if (probeSize_ == 0)
+        {
+            // Nothing left to try; the path may carry more by the next search
+            probeCeiling_ = SIZE_MAX;
+            timers_.schedule(probeTimer_, now + MTU_RAISE_INTERVAL_MS);
+            return;
+        }
+        std::vector<uint8_t> probe(probeSize_, 0);
+        probe[0] = FLAG_PING;
+        WriteU32(probe.data() + 1, static_cast<uint32_t>(probeSize_));
+        probeAttempts_++;
+        pacer_.onSend(probeSize_);
+        transmit(probe.data(), probe.size());
+        timers_.schedule(probeTimer_, now + rto_);
+    }
+
+    void onProbeAck(uint32_t size, int64_t now)
+    {
+        if (size == 0 || size != probeSize_)
+            return;
+        packetSize_ = size;
+        probeSize_ = 0;
+        probeMtu(now);
+    }
+
+    // Back to the base size, and look again below the one that stopped getting through
+    void onBlackHole(size_t size, int64_t now)
+    {
+        packetSize_ = BASE_PACKET_SIZE;
+        probeCeiling_ = size;
+        probeSize_ = 0;
+        if (isMtuSearchStarted_)
+            probeMtu(now);
+    }
+
+    size_t effectiveWindow() const
+    {
+        return std::min(static_cast<size_t>(std::floor(cwnd_)), MAX_SEND_WINDOW);
+    }
+
+    // Target rate from the current window: gain × cwnd per smoothed RTT
+    void updatePacingRate(int64_t now)
+    {
+        if (profile_.pacingGain <= 0 || !rttMeasured_)
+            return;
+        if (isBbr())
+        {
+            pacer_.setRate(bbr_.pacingRate(cwnd_, srtt_, packetSize_), profile_.pacingBurst, packetSize_, now);
+            return;
+        }
+        double gain = cwnd_ < ssthresh_ ? std::max(SLOW_START_PACING_GAIN, profile_.pacingGain) : profile_.pacingGain;
+        double rate = gain * cwnd_ * static_cast<double>(packetSize_) / std::max(srtt_, 1.0);
+        pacer_.setRate(rate, profile_.pacingBurst, packetSize_, now);
+    }
+
+    // Weighted fair queueing between the lanes with data queued that the
+    // window lets through: the one whose next packet starts earliest in
+    // virtual time, control first on ties. -1: nothing may go.
+    //
+    // Bulk counts every packet since the first unACKed one, as all DATA did
+    // before lanes. Control and media count only what is still in the network
+    // (not SACKed), so a hole in a bulk transfer waiting for its retransmit
+    // doesn't hold them back, and a trickle of control may overrun even that,
+    // so an input event never waits for ACKs.
+    int nextLane() const
+    {
+        size_t inFlight = sendWindow_.size();
+        size_t window = effectiveWindow();
+        if (inFlight >= MAX_SEND_WINDOW)
+            return -1; // the most an ACK bitmap covers
+        size_t pipe = inFlight - sackedInFlight_;
+        int best = -1;
+        double bestStart = 0;
+        for (int lane = 0; lane < LANE_COUNT; lane++)
+        {
+            if (lanes_[lane].bytes == 0)
+                continue;
+            bool fits = lane == LANE_BULK ? inFlight < window
+                                          : pipe < window || (lane == LANE_CONTROL && controlInFlight_ < CONTROL_HEADROOM);
+            if (!fits)
+                continue;
+            double start = std::max(virtualTime_, lanes_[lane].finish);
+            if (best < 0 || start < bestStart)
+            {
+                best = lane;
+                bestStart = start;
+            }
+        }
+        return best;
+    }
+
+    // Move queued application bytes into DATA packets while the window and pacer allow
+    void pump(int64_t now)
+    {
+        paceTimer_.cancel();
+        updatePacingRate(now);
+        const bool isV2 = wireVersion() >= 2;
+        const bool hasFec = wireVersion() >= 3;
+        const bool hasLanes = wireVersion() >= 4;
+        const size_t headerSize = hasLanes ? DATA_LANE_HEADER_SIZE : isV2 ? DATA_V2_HEADER_SIZE : HEADER_SIZE;
+        while (!isClosing_ && queuedBytes_ > 0)
+        {
+            int laneIndex = nextLane();
+            if (laneIndex < 0)
+                break;
+            if (!pacer_.canSend(now))
+            {
+                timers_.schedule(paceTimer_, pacer_.nextSendTime(now));
+                stats_.pacingDelays++;
+                break;
+            }
+            Lane &lane = lanes_[laneIndex];
+            // Media packets stay within their send, so a group ends with it
+            const bool isMedia = hasFec && lane.queue.front().isMedia;
+            // Media leaves room for the lane fields in its parity packet, which must fit too
+            size_t limit = std::min(packetSize_ - (isMedia ? PARITY_LANE_HEADER_SIZE + LANE_FIELDS_SIZE : headerSize), lane.bytes);
+            std::vector<uint8_t> packet(headerSize + limit);
+            size_t filled = 0;
+            bool endsMedia = false;
+            while (filled < limit)
+            {
+                QueuedSend &front = lane.queue.front();
+                if (hasFec && front.isMedia != isMedia)
+                    break;
+                size_t n = std::min(limit - filled, front.data.size() - lane.offset);
+                memcpy(packet.data() + headerSize + filled, front.data.data() + lane.offset, n);
+                filled += n;
+                lane.offset += n;
+                if (lane.offset == front.data.size())
+                {
+                    lane.queue.pop_front();
+                    lane.offset = 0;
+                    if (isMedia)
+                    {
+                        endsMedia = true;
+                        break;
+                    }
+                }
+            }
+            packet.resize(headerSize + filled);
+            queuedBytes_ -= filled;
+            lane.bytes -= filled;
+            virtualTime_ = std::max(virtualTime_, lane.finish);
+            lane.finish = virtualTime_ + 1 / LANE_WEIGHTS[laneIndex];
+
+            uint32_t seq = sendSeq_++;
+            uint32_t laneSeq = lane.nextSeq++;
+            if (hasLanes)
+            {
+                packet[0] = FLAG_DATA_LANE;
+                packet[1] = static_cast<uint8_t>(seq >> 8);
+                packet[2] = static_cast<uint8_t>(seq);
+                packet[3] = static_cast<uint8_t>(laneIndex);
+                packet[4] = static_cast<uint8_t>(laneSeq >> 8);
+                packet[5] = static_cast<uint8_t>(laneSeq);
+            }
+            else if (isV2)
+            {
+                packet[0] = FLAG_DATA_V2;
+                packet[1] = static_cast<uint8_t>(seq >> 8);
+                packet[2] = static_cast<uint8_t>(seq);
+            }
+            else
+            {
+                packet[0] = FLAG_DATA;
+                WriteU32(packet.data() + 1, seq);
+            }
+
+            stats_.bytesSent += filled;
+            stats_.packetsSent++;
+            lastDataActivity_ = now;
+            SentPacket &entry = sendWindow_[seq];
+            entry.seq = seq;
+            entry.packet = std::move(packet);
+            entry.sentAt = now;
+            entry.delivery = bbr_.onSend(now, bytesInFlight_);
+            bytesInFlight_ += entry.packet.size();
+            timers_.schedule(entry, now + rto_);
+            if (!lossSampleTimer_.isArmed())
+                timers_.schedule(lossSampleTimer_, now + RETRANSMIT_SCAN_INTERVAL);
+            if (laneIndex == LANE_CONTROL)
+                controlInFlight_++;
+            pacer_.onSend(entry.packet.size());
+            transmit(entry.packet.data(), entry.packet.size());
+
+            if (isMedia)
+            {
+                // Parity covers everything after the seq: lane fields too, when there are any
+                if (fecCount_ > 0 && (seq - fecFirst_ >= FEC_MAX_SPAN || isFecLaneGroup_ != hasLanes))
+                    sendParity();
+                addToFecGroup(seq, entry.packet.data() + DATA_V2_HEADER_SIZE, entry.packet.size() - DATA_V2_HEADER_SIZE, hasLanes);
+                if (endsMedia || fecCount_ >= fecGroupSize())
+                    sendParity();
+            }
+        }
+        // The window had room the application didn't fill: BBR's rate samples say so
+        if (queuedBytes_ == 0 && sendWindow_.size() < effectiveWindow())
+            bbr_.onAppLimited(bytesInFlight_);
+    }
+
+    // Fewer packets per parity the more get lost, so one loss per group stays the norm
+    size_t fecGroupSize() const
+    {
+        if (lossRate_ <= 0)
+            return FEC_MAX_GROUP;
+        return std::clamp(static_cast<size_t>(FEC_LOSSES_PER_GROUP / lossRate_), FEC_MIN_GROUP, FEC_MAX_GROUP);
+    }
+
+    void addToFecGroup(uint32_t seq, const uint8_t *body, size_t len, bool isLaneGroup)
+    {
+        if (fecCount_ == 0)
+        {
+            fecFirst_ = seq;
+            fecMask_ = 0;
+            fecLength_ = 0;
+            fecLengthXor_ = 0;
+            isFecLaneGroup_ = isLaneGroup;
+        }
+        if (len > fecLength_)
+        {
+            memset(fecParity_ + fecLength_, 0, len - fecLength_);
+            fecLength_ = len;
+        }
+        for (size_t i = 0; i < len; i++)
+            fecParity_[i] ^= body[i];
+        fecLengthXor_ ^= static_cast<uint16_t>(len);
+        fecMask_ |= uint64_t(1) << (seq - fecFirst_);
+        fecCount_++;
+    }
+
+    // Parity isn't tracked in the window or retransmitted; a lost one just costs the retransmit it would have saved
+    void sendParity()
+    {
+        uint8_t pkt[PARITY_LANE_HEADER_SIZE + MAX_PARITY_BODY];
+        size_t headerSize;
+        WriteU32(pkt + 1, fecFirst_);
+        if (isFecLaneGroup_)
+        {
+            pkt[0] = FLAG_PARITY_LANE;
+            WriteU32(pkt + 5, static_cast<uint32_t>(fecMask_ >> 32));
+            WriteU32(pkt + 9, static_cast<uint32_t>(fecMask_));
+            headerSize = PARITY_LANE_HEADER_SIZE;
+        }
+        else
+        {
+            pkt[0] = FLAG_PARITY;
+            pkt[5] = static_cast<uint8_t>(fecCount_);
+            headerSize = PARITY_HEADER_SIZE;
+        }
+        pkt[headerSize - 2] = static_cast<uint8_t>(fecLengthXor_ >> 8);
+        pkt[headerSize - 1] = static_cast<uint8_t>(fecLengthXor_);
+        memcpy(pkt + headerSize, fecParity_, fecLength_);
+        fecCount_ = 0;
+        stats_.paritySent++;
+        pacer_.onSend(headerSize + fecLength_);
+        transmit(pkt, headerSize + fecLength_);
+    }
+
+    // A DATA packet first seen missing, by a SACK hole or its retransmit
+    // timer: count it as lost, once. False when the peer's socket owned up to
+    // dropping it, which says nothing about the path.
+    bool noteLoss(SentPacket &entry, int64_t now)
+    {
+        if (entry.isLost)
+            return !entry.isLocalDrop;
+        entry.isLost = true;
+        if (dropsToExcuse_ > 0 && now < excuseUntil_)
+        {
+            dropsToExcuse_--;
+            entry.isLocalDrop = true;
+            stats_.lossesExcused++;
+            return false;
+        }
+        lostPackets_++;
+        if (isBbr())
+            bbr_.onLoss(entry.packet.size());
+        return true;
+    }
+
+    // The peer's running total of datagrams its socket dropped
+    void onPeerDrops(uint32_t total, int64_t now)
+    {
+        if (static_cast<int32_t>(total - peerDrops_) <= 0)
+            return;
+        dropsToExcuse_ += total - peerDrops_;
+        peerDrops_ = total;
+        excuseUntil_ = now + LOCAL_DROP_GRACE_RTOS * rto_;
+    }
+
+    void updateLossRate()
+    {
+        uint64_t sent = stats_.packetsSent - lossSampleSent_;
+        if (sent < FEC_LOSS_SAMPLE)
+            return;
+        double sample = std::min(1.0, static_cast<double>(lostPackets_ - lossSampleLost_) / static_cast<double>(sent));
+        lossRate_ = 0.875 * lossRate_ + 0.125 * sample;
+        lossSampleSent_ = stats_.packetsSent;
+        lossSampleLost_ = lostPackets_;
+    }
+
+    /** Shrink cwnd on loss — only once per recovery phase (QUIC RFC 9002 §7). */
+    void onCongestionEvent(int64_t now)
+    {
+        if (inRecovery_)
+            return;
+        // A few RPC responses retransmitting isn't congestion
+        if (sendWindow_.size() < INITIAL_CWND)
+            return;
+        // BBR's model already accounts for what the path delivers: recovery
+        // only keeps RTT samples inflated by the holes out of srtt
+        if (!isBbr())
+        {
+            ssthresh_ = std::max(std::floor(cwnd_ * profile_.beta), MIN_CWND);
+            cwnd_ = ssthresh_;
+        }
+        inRecovery_ = true;
+        recoverySeq_ = sendSeq_ - 1;
+        // Hold recovery for at least 1s to prevent rapid cut cascades
+        recoveryUntil_ = now + std::max<int64_t>(rto_, 1000);
+    }
+
+    // Per-packet exponential backoff: rto × 2^(attempts-1)
+    int64_t retransmitTimeout(const SentPacket &entry) const
+    {
+        return std::min<int64_t>(rto_ << std::min(std::max(0, entry.attempts - 1), 16), MAX_RTO);
+    }
+
+    void retransmit(uint32_t seq, SentPacket &entry, int64_t now)
+    {
+        // Lost again and again at a size probing found: suspect the path, not the network
+        if (entry.attempts >= BLACK_HOLE_ATTEMPTS && entry.packet.size() > BASE_PACKET_SIZE && entry.packet.size() <= packetSize_)
+            onBlackHole(entry.packet.size(), now);
+        stats_.retransmits++;
+        entry.attempts++;
+        entry.sentAt = now;
+        entry.delivery = bbr_.onSend(now, bytesInFlight_);
+        timers_.schedule(entry, now + retransmitTimeout(entry));
+        if (entry.packet.size() > packetSize_)
+            sendFragments(seq, entry.packet);
+        else
+            transmit(entry.packet.data(), entry.packet.size());
+    }
+
+    // A DATA packet sent before the packet size came down, in pieces that fit.
+    // Always cut at the base size: the peer may hold pieces of an earlier
+    // resend, and pieces cut at another size would splice into garbage
+    void sendFragments(uint32_t seq, const std::vector<uint8_t> &packet)
+    {
+        const size_t pieceSize = BASE_PACKET_SIZE - FRAGMENT_HEADER_SIZE;
+        const size_t count = (packet.size() + pieceSize - 1) / pieceSize;
+        std::vector<uint8_t> fragment(BASE_PACKET_SIZE);
+        fragment[0] = FLAG_FRAGMENT;
+        WriteU32(fragment.data() + 1, seq);
+        fragment[6] = static_cast<uint8_t>(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t n = std::min(pieceSize, packet.size() - i * pieceSize);
+            fragment[5] = static_cast<uint8_t>(i);
+            memcpy(fragment.data() + FRAGMENT_HEADER_SIZE, packet.data() + i * pieceSize, n);
+            transmit(fragment.data(), FRAGMENT_HEADER_SIZE + n);
+        }
+    }
+
+    void onTimer(net::TimerWheel::Timer &timer, int64_t now)
+    {
+        if (isClosing_)
+            return;
+        switch (timer.kind)
+        {
+        case TIMER_HELLO:
+            sendHello(now);
+            break;
+        case TIMER_ACK:
+            if (ackPending_ > 0)
+            {
+                sendAck(recvSeq_ - 1);
+                ackPending_ = 0;
+            }
+            break;
+        case TIMER_PING:
+            if (now - lastPingReceived_ > MAX_PING_DELAY_MS)
+            {
+                close(now, "No ping received from remote");
+                return;
+            }
+            sendControl(FLAG_PING);
+            timers_.schedule(pingTimer_, now + PING_INTERVAL_MS);
+            break;
+        case TIMER_LOSS_SAMPLE:
+            updateLossRate();
+            if (!sendWindow_.empty())
+                timers_.schedule(lossSampleTimer_, now + RETRANSMIT_SCAN_INTERVAL);
+            break;
+        case TIMER_PACE:
+            break; // poll() pumps after the timers
+        case TIMER_PROBE:
+            probeMtu(now);
+            break;
+        case TIMER_RETRANSMIT:
+            onRetransmitTimer(static_cast<SentPacket &>(timer), now);
+            break;
+        }
+    }
+
+    // Armed with the RTO of its last send; the RTO may have grown since
+    void onRetransmitTimer(SentPacket &entry, int64_t now)
+    {
+        const int64_t due = entry.sentAt + retransmitTimeout(entry);
+        if (now < due)
+        {
+            timers_.schedule(entry, due);
+            return;
+        }
+        if (entry.attempts >= profile_.maxRetransmits)
+        {
+            close(now, "Max retransmits reached");
+            return;
+        }
+        if (now - retransmitBudgetStart_ >= RETRANSMIT_SCAN_INTERVAL)
+        {
+            retransmitBudgetStart_ = now;
+            retransmitBudget_ = MAX_RETRANSMITS_PER_SCAN;
+        }
+        if (retransmitBudget_ == 0)
+        {
+            timers_.schedule(entry, retransmitBudgetStart_ + RETRANSMIT_SCAN_INTERVAL);
+            return;
+        }
+        retransmitBudget_--;
+        // First timer retransmit is often RTO jitter, not congestion
+        if (noteLoss(entry, now) && entry.attempts >= 2)
+            onCongestionEvent(now);
+        retransmit(entry.seq, entry, now);
+    }
+
+    void handleData(uint32_t seq, uint8_t lane, uint32_t laneSeq, const uint8_t *payload, size_t len, int64_t now)
+    {
+        if (seq < 1)
+            return;
+        // Old/duplicate packet: our ACK for it was lost, re-ACK so the sender stops retransmitting
+        if (seq < recvSeq_ || buffered(seq))
+        {
+            sackScheduled_ = true;
+            return;
+        }
+        if (laneSeq < laneNext_[lane] || seq - recvSeq_ >= MAX_BUFFERED_PACKETS)
+            return;
+        stats_.bytesReceived += len;
+
+        // In order on its lane: deliverable now, whatever other lanes are missing
+        bool isDeliverable = laneSeq == laneNext_[lane];
+        if (isDeliverable)
+        {
+            pendingDeliver_[lane].insert(pendingDeliver_[lane].end(), payload, payload + len);
+            laneNext_[lane]++;
+        }
+        if (seq == recvSeq_ && isDeliverable)
+        {
+            if (!fecHistory_.empty())
+            {
+                DeliveredPayload &kept = fecHistory_[seq % FEC_HISTORY];
+                kept.seq = seq;
+                kept.packet.lane = lane;
+                kept.packet.laneSeq = laneSeq;
+                kept.packet.payload.assign(payload, payload + len);
+            }
+        }
+        else
+        {
+            // Into the slot's own buffer, allocated once it has held a packet this big
+            Received &slot = received_.insert(seq);
+            slot.lane = lane;
+            slot.laneSeq = laneSeq;
+            slot.payload.assign(payload, payload + len);
+            if (!isDeliverable)
+                laneWaiting_[lane].emplace(laneSeq, seq);
+        }
+        if (isDeliverable)
+            deliverWaiting(lane);
+
+        if (seq != recvSeq_)
+        {
+            sackScheduled_ = true;
+            return;
+        }
+        // Advance the ACK point over the run now contiguous; a lane seq
+        // follows the seq order, so all of it has been delivered already
+        const uint32_t runEnd = received_.nextFree(recvSeq_ + 1, recvSeq_ + MAX_BUFFERED_PACKETS);
+        while (recvSeq_ != runEnd)
+        {
+            // All but this packet (unless its lane wasn't ready) come from the ring
+            if (received_.contains(recvSeq_))
+            {
+                if (!fecHistory_.empty())
+                {
+                    // Trade buffers, so neither side allocates next time
+                    DeliveredPayload &kept = fecHistory_[recvSeq_ % FEC_HISTORY];
+                    kept.seq = recvSeq_;
+                    std::swap(kept.packet, received_[recvSeq_]);
+                }
+                received_.erase(recvSeq_);
+            }
+            recvSeq_++;
+            onInOrder(now);
+        }
+    }
+
+    // The packet at `seq` past the ACK point, if it has arrived
+    Received *buffered(uint32_t seq)
+    {
+        if (seq < recvSeq_ || seq - recvSeq_ >= MAX_BUFFERED_PACKETS || !received_.contains(seq))
+            return nullptr;
+        return &received_[seq];
+    }
+
+    // Deliver the packets of `lane` that were waiting for the one just delivered
+    void deliverWaiting(uint8_t lane)
+    {
+        auto &waiting = laneWaiting_[lane];
+        while (!waiting.empty() && waiting.begin()->first == laneNext_[lane])
+        {
+            const Received *packet = buffered(waiting.begin()->second);
+            waiting.erase(waiting.begin());
+            if (!packet)
+                break;
+            const std::vector<uint8_t> &payload = packet->payload;
+            pendingDeliver_[lane].insert(pendingDeliver_[lane].end(), payload.begin(), payload.end());
+            laneNext_[lane]++;
+        }
+    }
+
+    // One more packet under the cumulative ACK: ACK first, then let the owner
+    // deliver at the end of the batch
+    void onInOrder(int64_t now)
+    {
+        ackPending_++;
+        if (ackPending_ >= ACK_BATCH_SIZE)
+        {
+            sendAck(recvSeq_ - 1);
+            ackPending_ = 0;
+            ackTimer_.cancel();
+        }
+        else if (!ackTimer_.isArmed())
+        {
+            timers_.schedule(ackTimer_, now + MAX_ACK_DELAY_MS);
+        }
+    }
+
+    // Rebuild the one packet of a parity group that hasn't arrived, if only one
+    void handleParity(const uint8_t *buf, size_t len, int64_t now)
+    {
+        const bool isLaneGroup = buf[0] == FLAG_PARITY_LANE;
+        const size_t headerSize = isLaneGroup ? PARITY_LANE_HEADER_SIZE : PARITY_HEADER_SIZE;
+        if (len < headerSize)
+            return;
+        // From now on keep delivered payloads: the next group may need them
+        if (fecHistory_.empty())
+            fecHistory_.resize(FEC_HISTORY);
+        uint32_t first = ReadU32(buf + 1);
+        uint64_t mask;
+        if (isLaneGroup)
+            mask = (uint64_t(ReadU32(buf + 5)) << 32) | ReadU32(buf + 9);
+        else
+            mask = buf[5] == 0 || buf[5] > FEC_MAX_GROUP ? 0 : (uint64_t(1) << buf[5]) - 1;
+        const uint8_t *parity = buf + headerSize;
+        size_t parityLen = len - headerSize;
+        size_t span = mask == 0 ? 0 : 64 - static_cast<size_t>(__builtin_clzll(mask));
+        if (first == 0 || mask == 0 || first > UINT32_MAX - span || first + span <= recvSeq_)
+            return;
+
+        uint32_t missing = 0;
+        for (size_t i = 0; i < span; i++)
+        {
+            if (!(mask & (uint64_t(1) << i)))
+                continue;
+            uint32_t s = first + static_cast<uint32_t>(i);
+            if (s >= recvSeq_ && !buffered(s))
+            {
+                if (missing != 0)
+                    return; // two or more lost: retransmits fill them in
+                missing = s;
+            }
+            else if (s < recvSeq_ && fecHistory_[s % FEC_HISTORY].seq != s)
+            {
+                return; // delivered before we kept payloads
+            }
+        }
+        if (missing == 0)
+            return;
+
+        std::vector<uint8_t> rebuilt(parity, parity + parityLen);
+        size_t length = (size_t(buf[headerSize - 2]) << 8) | buf[headerSize - 1];
+        const size_t fieldsSize = isLaneGroup ? LANE_FIELDS_SIZE : 0;
+        for (size_t i = 0; i < span; i++)
+        {
+            uint32_t s = first + static_cast<uint32_t>(i);
+            if (!(mask & (uint64_t(1) << i)) || s == missing)
+                continue;
+            const Received &have = s < recvSeq_ ? fecHistory_[s % FEC_HISTORY].packet : *buffered(s);
+            if (fieldsSize + have.payload.size() > parityLen)
+                return;
+            if (isLaneGroup)
+            {
+                rebuilt[0] ^= have.lane;
+                rebuilt[1] ^= static_cast<uint8_t>(have.laneSeq >> 8);
+                rebuilt[2] ^= static_cast<uint8_t>(have.laneSeq);
+            }
+            for (size_t b = 0; b < have.payload.size(); b++)
+                rebuilt[fieldsSize + b] ^= have.payload[b];
+            length ^= fieldsSize + have.payload.size();
+        }
+        if (length > parityLen || length < fieldsSize)
+            return;
+        stats_.fecRecovered++;
+        if (!isLaneGroup)
+        {
+            handleData(missing, LANE_CONTROL, missing, rebuilt.data(), length, now);
+            return;
+        }
+        uint8_t lane = rebuilt[0];
+        if (lane >= LANE_COUNT)
+            return;
+        uint32_t laneSeq = ExpandSeq(static_cast<uint16_t>((rebuilt[1] << 8) | rebuilt[2]), laneNext_[lane]);
+        handleData(missing, lane, laneSeq, rebuilt.data() + LANE_FIELDS_SIZE, length - LANE_FIELDS_SIZE, now);
+    }
+
+    // Put a DATA packet retransmitted in pieces back together, then take it
+    // as if it had come whole
+    void handleFragment(uint32_t seq, const uint8_t *buf, size_t len, int64_t now)
+    {
+        const size_t index = buf[5], count = buf[6];
+        if (len <= FRAGMENT_HEADER_SIZE || count < 2 || count > MAX_FRAGMENTS || index >= count)
+            return;
+        // Whatever is under the ACK point got here some other way
+        reassembly_.erase(reassembly_.begin(), reassembly_.lower_bound(recvSeq_));
+        if (seq < recvSeq_ || buffered(seq))
+        {
+            sackScheduled_ = true;
+            return;
+        }
+        auto it = reassembly_.find(seq);
+        if (it == reassembly_.end())
+        {
+            if (reassembly_.size() >= MAX_REASSEMBLIES)
+                return;
+            it = reassembly_.emplace(seq, Reassembly{}).first;
+            it->second.count = count;
+        }
+        Reassembly &r = it->second;
+        if (r.count != count || !r.pieces[index].empty())
+            return;
+        r.pieces[index].assign(buf + FRAGMENT_HEADER_SIZE, buf + len);
+        if (++r.have < count)
+            return;
+        std::vector<uint8_t> packet;
+        for (size_t i = 0; i < count; i++)
+            packet.insert(packet.end(), r.pieces[i].begin(), r.pieces[i].end());
+        reassembly_.erase(it);
+        const uint8_t type = packet[0];
+        if ((type == FLAG_DATA && packet.size() >= HEADER_SIZE) || type == FLAG_DATA_V2 || type == FLAG_DATA_LANE)
+            onPacket(packet.data(), packet.size(), now);
+    }
+
+    // Resend un-SACKed packets below `limit` not sent within MIN_RTO; all of
+    // them count as lost. False if that hit the retransmit limit and closed the session.
+    bool fastRetransmitBelow(uint32_t limit, int64_t now)
+    {
+        int fastRetx = 0;
+        for (auto it = sendWindow_.lower_bound(sendBase_);
+             it != sendWindow_.end() && it->first < limit && fastRetx < MAX_RETRANSMITS_PER_SCAN; ++it)
+        {
+            SentPacket &gap = it->second;
+            if (gap.sacked)
+                continue;
+            const bool isPathLoss = noteLoss(gap, now);
+            if (now - gap.sentAt < MIN_RTO)
+                continue;
+            if (gap.attempts >= profile_.maxRetransmits)
+            {
+                close(now, "Max retransmits reached");
+                return false;
+            }
+            if (isPathLoss)
+                onCongestionEvent(now);
+            fastRetx++;
+            retransmit(it->first, gap, now);
+        }
+        return true;
+    }
+
+    // `arrivedAt`: when the ACK reached the host, for the RTT sample
+    void handleAck(uint8_t type, uint32_t seq, const uint8_t *buf, size_t len, int64_t now, int64_t arrivedAt)
+    {
+        if (type == FLAG_ACK_ECN && len < HEADER_SIZE + ACK_ECN_COUNTS_SIZE)
+            return;
+        uint32_t nextAck = seq + 1;
+        // RTT from the highest-seq first-attempt packet only (Karn's algorithm);
+        // skipped during recovery, where samples are inflated by reordering.
+        if (!inRecovery_ && nextAck > sendBase_)
+        {
+            auto it = sendWindow_.lower_bound(nextAck);
+            while (it != sendWindow_.begin())
+            {
+                --it;
+                if (it->first < sendBase_)
+                    break;
+                if (it->second.attempts == 1)
+                {
+                    updateRtt(static_cast<double>(std::max(arrivedAt - it->second.sentAt, int64_t(0))), now);
+                    break; // one sample per ACK
+                }
+            }
+        }
+
+        // Remove all cached packets from sendBase up to nextAck
+        uint32_t ackedCount = 0;
+        if (nextAck > sendBase_)
+        {
+            ackedCount = nextAck - sendBase_;
+            auto end = sendWindow_.lower_bound(nextAck);
+            for (auto it = sendWindow_.begin(); it != end; ++it)
+            {
+                if (it->second.sacked)
+                    sackedInFlight_--;
+                else
+                    onDelivered(it->second, now);
+            }
+            sendWindow_.erase(sendWindow_.begin(), end);
+            sendBase_ = nextAck;
+        }
+
+        if (ackedCount > 0)
+        {
+            // BBR sets cwnd from its model once the whole ACK is in
+            if (!isBbr())
+            {
+                if (cwnd_ < ssthresh_)
+                    cwnd_ = std::min(cwnd_ + ackedCount, static_cast<double>(MAX_SEND_WINDOW)); // slow start
+                else
+                    cwnd_ = std::min(cwnd_ + ackedCount / cwnd_, static_cast<double>(MAX_SEND_WINDOW)); // congestion avoidance
+            }
+            // Exit recovery once pre-loss packets are ACKed and the hold time passed
+            if (inRecovery_ && seq >= recoverySeq_ && now >= recoveryUntil_)
+            {
+                inRecovery_ = false;
+                if (minRtt_ > 0)
+                {
+                    srtt_ = minRtt_ * 2;
+                    rttvar_ = minRtt_;
+                    rto_ = clampRto(srtt_ + 4 * rttvar_);
+                }
+                else
+                {
+                    rttMeasured_ = false;
+                    rto_ = INITIAL_RTO;
+                }
+            }
+        }
+
+        if (type == FLAG_ACK_V2 || type == FLAG_ACK_ECN)
+        {
+            // Bitmap of everything received beyond the first missing packet
+            peerVersion_ = std::max<uint8_t>(peerVersion_, type == FLAG_ACK_ECN ? 6 : 2);
+            const size_t bitmapAt = type == FLAG_ACK_ECN ? HEADER_SIZE + ACK_ECN_COUNTS_SIZE : HEADER_SIZE;
+            uint32_t highestSacked = 0;
+            for (size_t byte = 0; bitmapAt + byte < len && byte < ACK_BITMAP_BYTES; byte++)
+            {
+                uint8_t bits = buf[bitmapAt + byte];
+                for (int bit = 0; bits != 0 && bit < 8; bit++, bits >>= 1)
+                {
+                    if (!(bits & 1))
+                        continue;
+                    uint32_t s = nextAck + 1 + static_cast<uint32_t>(byte * 8 + bit);
+                    auto it = sendWindow_.find(s);
+                    if (it != sendWindow_.end())
+                        markSacked(it->second, now);
+                    highestSacked = s;
+                }
+            }
+            // Every hole below the highest SACKed packet is lost
+            if (highestSacked > sendBase_ && !fastRetransmitBelow(highestSacked, now))
+                return;
+        }
+        else if (len > HEADER_SIZE)
+        {
+            // SACK blocks beyond the 5-byte header
+            size_t sackCount = std::min<size_t>(buf[HEADER_SIZE], MAX_SACK_BLOCKS);
+            uint32_t firstSackStart = 0;
+            for (size_t i = 0; i < sackCount && HEADER_SIZE + 1 + i * 8 + 8 <= len; i++)
+            {
+                uint32_t sackStart = ReadU32(buf + HEADER_SIZE + 1 + i * 8);
+                uint32_t sackEnd = ReadU32(buf + HEADER_SIZE + 1 + i * 8 + 4);
+                if (i == 0)
+                    firstSackStart = sackStart;
+                auto it = sendWindow_.lower_bound(sackStart);
+                for (; it != sendWindow_.end() && it->first <= sackEnd && it->first - sackStart < MAX_SEND_WINDOW; ++it)
+                    markSacked(it->second, now);
+            }
+            // Fast retransmit: resend gap packets between cumulative ACK and first SACK block
+            if (sackCount > 0 && firstSackStart > sendBase_ && !fastRetransmitBelow(firstSackStart, now))
+                return;
+        }
+
+        if (type == FLAG_ACK_ECN)
+            onEcnCounts(ReadU32(buf + HEADER_SIZE), ReadU32(buf + HEADER_SIZE + 4), nextAck);
+        validateEcn(nextAck);
+        if (isBbr())
+            cwnd_ = std::min(bbr_.onAck(now, bytesInFlight_, packetSize_, cwnd_), static_cast<double>(MAX_SEND_WINDOW));
+
+        // ACK proves peer is alive
+        lastPingReceived_ = now;
+        pump(now);
+    }
+
+    bool isEcnMarking() const { return isEcnEnabled_ && !isEcnFailed_ && wireVersion() >= 6; }
+
+    // Received with an ECN-capable field; CE on DATA is ACKed at the end of
+    // the batch, not after the delayed-ACK wait, so the sender backs off sooner
+    void countEcn(uint8_t type, uint8_t ecn)
+    {
+        ecnReceived_++;
+        if ((ecn & ECN_MASK) != ECN_CE)
+            return;
+        ceReceived_++;
+        if (type == FLAG_DATA || type == FLAG_DATA_V2 || type == FLAG_DATA_LANE || type == FLAG_FRAGMENT)
+            sackScheduled_ = true;
+    }
+
+    // The peer's running totals; an ACK overtaken by a later one reports less
+    void onEcnCounts(uint32_t received, uint32_t ce, uint32_t nextAck)
+    {
+        if (static_cast<int32_t>(received - peerEcnReceived_) > 0)
+            peerEcnReceived_ = received;
+        if (static_cast<int32_t>(ce - peerCeReceived_) <= 0)
+            return;
+        const uint32_t marks = ce - peerCeReceived_;
+        peerCeReceived_ = ce;
+        stats_.ceReported += marks;
+        // BBR: marks count like loss towards its inflight bound
+        if (isBbr())
+        {
+            bbr_.onLoss(static_cast<size_t>(marks) * packetSize_);
+            return;
+        }
+        // AIMD: a gentler cut than for loss, once per window, and not on top
+        // of a loss recovery's
+        if (inRecovery_ || nextAck <= ecnRecoverySeq_)
+            return;
+        const double beta = 1 - (1 - profile_.beta) * ECN_BACKOFF_SHARE;
+        ssthresh_ = std::max(std::floor(cwnd_ * beta), MIN_CWND);
+        cwnd_ = ssthresh_;
+        ecnRecoverySeq_ = sendSeq_;
+    }
+
+    // Marked packets ACKed, but the peer has yet to see a mark: the path
+    // clears them (or the peer can't read them), so stop
+    void validateEcn(uint32_t nextAck)
+    {
+        if (!isEcnMarking())
+            return;
+        if (ecnCheckSeq_ == 0)
+            ecnCheckSeq_ = sendSeq_ + ECN_VALIDATION_PACKETS;
+        else if (nextAck > ecnCheckSeq_ && peerEcnReceived_ == 0)
+            isEcnFailed_ = true;
+    }
+
+    // The receiver has it: out of the network, though still in the window
+    void markSacked(SentPacket &entry, int64_t now)
+    {
+        if (entry.sacked)
+            return;
+        entry.sacked = true;
+        entry.cancel();
+        sackedInFlight_++;
+        onDelivered(entry, now);
+    }
+
+    // Out of the network: first ACKed or SACKed
+    void onDelivered(const SentPacket &entry, int64_t now)
+    {
+        controlInFlight_ -= LaneOf(entry.packet) == LANE_CONTROL;
+        bytesInFlight_ -= entry.packet.size();
+        bbr_.onDelivered(entry.packet.size(), entry.delivery, now, entry.attempts == 1 ? now - entry.sentAt : -1);
+    }
+
+    bool isBbr() const { return profile_.congestionControl == CongestionControl::Bbr; }
+
+    static int64_t clampRto(double v)
+    {
+        return std::max(MIN_RTO, std::min(MAX_RTO, static_cast<int64_t>(std::llround(v))));
+    }
+
+    void updateRtt(double sample, int64_t now)
+    {
+        int64_t idleTime = now - lastDataActivity_;
+        lastDataActivity_ = now;
+
+        // Re-bootstrap after idle (RFC 6298 §5.1 note, RFC 7661 cwnd validation)
+        if (rttMeasured_ && idleTime > IDLE_THRESHOLD_MS)
+        {
+            rttMeasured_ = false;
+            rto_ = INITIAL_RTO;
+            minRtt_ = 0;
+            // BBR keeps its model and paces at it
+            if (!isBbr())
+                cwnd_ = INITIAL_CWND;
+            inRecovery_ = false;
+        }
+
+        if (minRtt_ == 0 || sample < minRtt_)
+            minRtt_ = sample;
+        // Clamp outliers to 8× min_rtt (400ms floor) so queueing spikes don't stick
+        if (minRtt_ > 0)
+            sample = std::min(sample, std::max(minRtt_ * 8, 400.0));
+
+        if (!rttMeasured_)
+        {
+            srtt_ = sample;
+            rttvar_ = sample / 2;
+            rttMeasured_ = true;
+        }
+        else
+        {
+            rttvar_ = 0.75 * rttvar_ + 0.25 * std::fabs(srtt_ - sample);
+            srtt_ = 0.875 * srtt_ + 0.125 * sample;
+        }
+        rto_ = clampRto(srtt_ + 4 * rttvar_);
+    }
+
+    void sendAck(uint32_t seq)
+    {
+        if (isClosing_)
+            return;
+        if (wireVersion() >= 2)
+        {
+            sendBitmapAck(seq);
+            return;
+        }
+        uint8_t pkt[HEADER_SIZE + 1 + MAX_SACK_BLOCKS * 8];
+        pkt[0] = FLAG_ACK;
+        WriteU32(pkt + 1, seq);
+        if (received_.empty())
+        {
+            transmit(pkt, HEADER_SIZE);
+            return;
+        }
+        // ACK with SACK: [header(5)] [count(1)] [start(4)+end(4)] × N
+        size_t count = 0;
+        const uint32_t windowEnd = recvSeq_ + MAX_BUFFERED_PACKETS;
+        uint32_t start = received_.nextOccupied(recvSeq_, windowEnd);
+        while (start != windowEnd && count < MAX_SACK_BLOCKS)
+        {
+            uint32_t end = received_.nextFree(start, windowEnd);
+            WriteU32(pkt + HEADER_SIZE + 1 + count * 8, start);
+            WriteU32(pkt + HEADER_SIZE + 1 + count * 8 + 4, end - 1);
+            count++;
+            start = received_.nextOccupied(end, windowEnd);
+        }
+        pkt[HEADER_SIZE] = static_cast<uint8_t>(count);
+        transmit(pkt, HEADER_SIZE + 1 + count * 8);
+    }
+
+    // v2 ACK: [type][seq(4)] then one bit per packet after seq + 1, trimmed
+    // after the last one received — everything past the ACK point, not 4 ranges.
+    // Once ECN-capable packets have arrived from a v6 peer, the ECN counts
+    // go before the bitmap.
+    void sendBitmapAck(uint32_t seq)
+    {
+        uint8_t pkt[HEADER_SIZE + ACK_ECN_COUNTS_SIZE + ACK_BITMAP_BYTES] = {};
+        pkt[0] = FLAG_ACK_V2;
+        WriteU32(pkt + 1, seq);
+        size_t bitmapAt = HEADER_SIZE;
+        if (ecnReceived_ > 0 && wireVersion() >= 6)
+        {
+            pkt[0] = FLAG_ACK_ECN;
+            WriteU32(pkt + HEADER_SIZE, ecnReceived_);
+            WriteU32(pkt + HEADER_SIZE + 4, ceReceived_);
+            bitmapAt += ACK_ECN_COUNTS_SIZE;
+        }
+        size_t used = 0;
+        const uint32_t from = seq + 2;
+        const uint32_t end = std::min<uint32_t>(from + ACK_BITMAP_BYTES * 8, recvSeq_ + MAX_BUFFERED_PACKETS);
+        for (uint32_t s = received_.nextOccupied(from, end); s != end; s = received_.nextOccupied(s + 1, end))
+        {
+            size_t bit = s - from;
+            pkt[bitmapAt + bit / 8] |= static_cast<uint8_t>(1u << (bit % 8));
+            used = bit / 8 + 1;
+        }
+        transmit(pkt, bitmapAt + used);
+    }
+};
+
+} // namespace reudp
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Fixed window of slots keyed by sequence number: slot `seq & mask` of a
+ * power-of-two ring, with a bitmap of the occupied ones.
+ *
+ * Made for packets received ahead of a receiver's in-order point. Every seq
+ * in [base, base + capacity) has a slot of its own, so lookup, insert and
+ * erase are an index and a bit, and walking the occupied (or free) seqs in
+ * order skips 64 slots per bitmap word. The ring doesn't track the base:
+ * the owner keeps every seq it passes within one window, and the window
+ * only moves forward past erased slots.
+ *
+ * Slots are constructed once and reused. An erased slot keeps its value,
+ * so a value holding a buffer the owner assign()s into (a std::vector)
+ * makes steady-state reordering free of allocations, and the memory a
+ * ring takes is known from its capacity.
+ *
+ * Not thread-safe; one owner thread, like the session using it.
+ */
+
+namespace net
+{
+
+template <typename T>
+class SeqRing
+{
+public:
+    /** `capacity`: a power of two, at least 64. */
+    explicit SeqRing(size_t capacity)
+        : slots_(capacity), occupied_(capacity / WORD_BITS), mask_(static_cast<uint32_t>(capacity - 1)) {}
+
+    size_t capacity() const { return slots_.size(); }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    bool contains(uint32_t seq) const
+    {
+        const size_t i = seq & mask_;
+        return (occupied_[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    /** Mark `seq` occupied and return its slot, holding whatever it last held. */
+    T &insert(uint32_t seq)
+    {
+        const size_t i = seq & mask_;
+        uint64_t &word = occupied_[i / WORD_BITS];
+        const uint64_t bit = uint64_t(1) << (i % WORD_BITS);
+        if (!(word & bit))
+        {
+            word |= bit;
+            size_++;
+        }
+        return slots_[i];
+    }
+
+    /** Slot of `seq`; meaningful while contains(seq). */
+    T &operator[](uint32_t seq) { return slots_[seq & mask_]; }
+
+    /** Free `seq`'s slot; its value stays for the next insert() to reuse. */
+    void erase(uint32_t seq)
+    {
+        const size_t i = seq & mask_;
+        uint64_t &word = occupied_[i / WORD_BITS];
+        const uint64_t bit = uint64_t(1) << (i % WORD_BITS);
+        if (word & bit)
+        {
+            word &= ~bit;
+            size_--;
+        }
+    }
+
+    void clear()
+    {
+        std::fill(occupied_.begin(), occupied_.end(), 0);
+        size_ = 0;
+    }
+
+    /** First occupied seq in [from, end), or `end`; the range spans at most capacity(). */
+    uint32_t nextOccupied(uint32_t from, uint32_t end) const { return scan(from, end, 0); }
+
+    /** First free seq in [from, end), or `end`: where a run of occupied slots stops. */
+    uint32_t nextFree(uint32_t from, uint32_t end) const { return scan(from, end, ~uint64_t(0)); }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+
+    // First seq in [from, end) whose bit differs from `skip`'s
+    uint32_t scan(uint32_t from, uint32_t end, uint64_t skip) const
+    {
+        uint32_t seq = from;
+        while (seq != end)
+        {
+            const size_t i = seq & mask_;
+            const uint32_t inWord = static_cast<uint32_t>(WORD_BITS - i % WORD_BITS);
+            const uint64_t bits = (occupied_[i / WORD_BITS] ^ skip) >> (i % WORD_BITS);
+            if (bits != 0)
+            {
+                const uint32_t step = static_cast<uint32_t>(__builtin_ctzll(bits));
+                return end - seq > step ? seq + step : end;
+            }
+            if (end - seq <= inWord)
+                return end;
+            seq += inWord;
+        }
+        return end;
+    }
+
+    std::vector<T> slots_;
+    std::vector<uint64_t> occupied_; // bit i % 64 of word i / 64: slot i holds a seq
+    uint32_t mask_;
+    size_t size_ = 0;
+};
+
+} // namespace net
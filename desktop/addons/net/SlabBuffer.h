@@ -0,0 +1,86 @@
+#pragma once
+
+#include <napi.h>
+#include <unordered_map>
+#include "SlabPool.h"
+
+/**
+ * Slab memory as JS Buffers.
+ *
+ * SlabToBuffer() wraps a range of a slab in an external Buffer that owns one
+ * slab reference, dropped when the Buffer is garbage-collected or when JS
+ * calls ReleaseSlabBuffer() on it — which also detaches it, so a recycled
+ * slab can never be read through a stale view. Where external buffers are
+ * not allowed (Electron's V8 sandbox) the range is copied and the reference
+ * dropped right away.
+ *
+ * JS thread only.
+ */
+
+namespace net
+{
+
+struct SlabLease
+{
+    Slab *slab;
+    bool isReleased = false;
+};
+
+// Live external buffers by data pointer, for ReleaseSlabBuffer()
+inline std::unordered_map<const uint8_t *, SlabLease *> &SlabLeases()
+{
+    static auto *leases = new std::unordered_map<const uint8_t *, SlabLease *>();
+    return *leases;
+}
+
+inline void FinalizeSlabBuffer(Napi::Env, uint8_t *data, SlabLease *lease)
+{
+    auto &leases = SlabLeases();
+    auto it = leases.find(data);
+    if (it != leases.end() && it->second == lease)
+        leases.erase(it);
+    if (!lease->isReleased)
+        SlabPool::release(lease->slab);
+    delete lease;
+}
+
+/** Takes over one reference the caller holds on `slab`. */
+inline Napi::Buffer<uint8_t> SlabToBuffer(Napi::Env env, Slab *slab, size_t offset, size_t length)
+{
+    uint8_t *data = slab->data.get() + offset;
+    auto *lease = new SlabLease{slab};
+    Napi::Buffer<uint8_t> buf;
+    try
+    {
+        buf = Napi::Buffer<uint8_t>::NewOrCopy(env, data, length, FinalizeSlabBuffer, lease);
+    }
+    catch (...)
+    {
+        SlabPool::release(slab);
+        delete lease;
+        throw;
+    }
+    // Copied: the finalizer already ran and the lease is gone
+    if (buf.Data() == data)
+        SlabLeases()[data] = lease;
+    return buf;
+}
+
+/** Returns the buffer's slab to the pool now instead of at GC. */
+inline void ReleaseSlabBuffer(const Napi::Value &value)
+{
+    if (!value.IsBuffer())
+        return;
+    auto buf = value.As<Napi::Buffer<uint8_t>>();
+    auto &leases = SlabLeases();
+    auto it = leases.find(buf.Data());
+    if (it == leases.end())
+        return;
+    SlabLease *lease = it->second;
+    leases.erase(it);
+    buf.ArrayBuffer().Detach();
+    lease->isReleased = true;
+    SlabPool::release(lease->slab);
+}
+
+} // namespace net
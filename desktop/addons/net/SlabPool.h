@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Pool of fixed-size, reference-counted receive slabs.
+ *
+ * Datagrams are received straight into a slab and handed to JS as views of
+ * it (see SlabBuffer.h), so the bytes the kernel / WinRT wrote are the bytes
+ * JS reads. A slab goes back to the pool when its last holder lets go: the
+ * receiving thread while it is still filling it, and every JS buffer that
+ * points into it. Recycling keeps large transfers from allocating (and the
+ * GC from tracking) a fresh buffer per batch.
+ *
+ * Thread-safe: slabs are filled on I/O threads and released on the JS thread.
+ */
+
+namespace net
+{
+
+class SlabPool;
+
+struct Slab
+{
+    std::unique_ptr<uint8_t[]> data;
+    size_t capacity = 0;
+    size_t used = 0; // bytes handed out so far (owner thread only)
+    std::atomic<int> refs{0};
+    SlabPool *pool = nullptr;
+
+    size_t available() const { return capacity - used; }
+};
+
+class SlabPool
+{
+public:
+    SlabPool(size_t slabSize, size_t maxIdle) : slabSize_(slabSize), maxIdle_(maxIdle) {}
+
+    ~SlabPool()
+    {
+        for (Slab *s : idle_)
+            delete s;
+    }
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    size_t slabSize() const { return slabSize_; }
+
+    /** An empty slab holding one reference for the caller. */
+    Slab *acquire()
+    {
+        Slab *s = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (!idle_.empty())
+            {
+                s = idle_.back();
+                idle_.pop_back();
+            }
+        }
+        if (!s)
+        {
+            s = new Slab();
+            s->data.reset(new uint8_t[slabSize_]);
+            s->capacity = slabSize_;
+            s->pool = this;
+        }
+        s->used = 0;
+        s->refs.store(1, std::memory_order_relaxed);
+        return s;
+    }
+
+    static void retain(Slab *s)
+    {
+        s->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void release(Slab *s)
+    {
+        if (s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            s->pool->recycle(s);
+    }
+
+private:
+    void recycle(Slab *s)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            if (idle_.size() < maxIdle_)
+            {
+                idle_.push_back(s);
+                return;
+            }
+        }
+        delete s;
+    }
+
+    size_t slabSize_;
+    size_t maxIdle_;
+    std::mutex mu_;
+    std::vector<Slab *> idle_;
+};
+
+} // namespace net
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <napi.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Per-socket transport counters for the datagram addons' getStats().
+ *
+ * Covers what ReDatagram cannot see from JS: datagrams and bytes through
+ * the socket, where received datagrams were dropped (by the kernel, by us
+ * because JS fell behind, or by the peer filter), how many events are
+ * queued for the JS thread, and how long they waited there. The last two
+ * tell an event-loop stall apart from a network one.
+ *
+ * The handoff histogram has log2 buckets: bucket i counts events that took
+ * [2^i, 2^(i+1)) µs from being posted to their callback starting (bucket 0
+ * also takes anything under 1 µs; the last one everything above).
+ *
+ * Written from I/O / WinRT threads and the JS thread, hence relaxed atomics
+ * throughout: every counter is a statistic on its own; nobody reads a
+ * consistent snapshot of several.
+ */
+
+namespace net
+{
+
+constexpr int HANDOFF_BUCKETS = 24; // up to ~8 s, then open-ended
+
+inline int64_t MonotonicUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct SocketStats
+{
+    std::atomic<uint64_t> packetsReceived{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> packetsSent{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> kernelDrops{0}; // receive-queue overflows reported by the kernel (SO_RXQ_OVFL)
+    std::atomic<uint64_t> batchDrops{0};  // dropped because JS let a batch grow past its limit
+    std::atomic<uint64_t> truncated{0};   // too large for a receive slot
+    std::atomic<uint64_t> filtered{0};    // from a peer the socket's peer filter does not list
+    std::atomic<uint64_t> shed{0};        // from a session peer not yet validated, past its rate limit
+    std::atomic<uint64_t> challenged{0};  // from a session peer not yet validated, answered with a cookie
+    std::atomic<uint64_t> sendErrors{0};  // datagrams the OS refused to send
+    std::atomic<uint64_t> sendFull{0};    // send() calls turned away for lack of credits
+    std::atomic<uint64_t> recvBuffer{0};  // kernel receive buffer in bytes, where the addon sizes it
+    std::atomic<uint64_t> sendBuffer{0};  // kernel send buffer, likewise
+    std::atomic<int64_t> pendingEvents{0}; // posted to the JS thread, callback not yet run
+    std::atomic<int64_t> peakPendingEvents{0};
+    std::atomic<uint64_t> handoffUs[HANDOFF_BUCKETS] = {};
+    std::atomic<uint64_t> handoffMaxUs{0};
+
+    static void add(std::atomic<uint64_t> &counter, uint64_t n = 1)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    static void raise(std::atomic<uint64_t> &value, uint64_t to)
+    {
+        uint64_t cur = value.load(std::memory_order_relaxed);
+        while (cur < to && !value.compare_exchange_weak(cur, to, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void onPosted()
+    {
+        int64_t n = pendingEvents.fetch_add(1, std::memory_order_relaxed) + 1;
+        int64_t peak = peakPendingEvents.load(std::memory_order_relaxed);
+        while (peak < n && !peakPendingEvents.compare_exchange_weak(peak, n, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void onPostFailed()
+    {
+        pendingEvents.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /** JS thread, as the event's callback starts. */
+    void onDelivered(int64_t postedUs)
+    {
+        pendingEvents.fetch_sub(1, std::memory_order_relaxed);
+        uint64_t us = static_cast<uint64_t>(std::max<int64_t>(0, MonotonicUs() - postedUs));
+        int bucket = 0;
+        while (bucket < HANDOFF_BUCKETS - 1 && (us >> (bucket + 1)) != 0)
+            bucket++;
+        add(handoffUs[bucket]);
+        raise(handoffMaxUs, us);
+    }
+
+    /** Upper bound (µs) of the bucket holding the p-th quantile; 0 with no samples. */
+    uint64_t handoffPercentileUs(double p) const
+    {
+        uint64_t counts[HANDOFF_BUCKETS];
+        uint64_t total = 0;
+        for (int i = 0; i < HANDOFF_BUCKETS; ++i)
+            total += counts[i] = handoffUs[i].load(std::memory_order_relaxed);
+        if (total == 0)
+            return 0;
+        uint64_t rank = static_cast<uint64_t>(p * total);
+        uint64_t seen = 0;
+        uint64_t maxUs = handoffMaxUs.load(std::memory_order_relaxed);
+        for (int i = 0; i < HANDOFF_BUCKETS; ++i)
+        {
+            seen += counts[i];
+            if (seen > rank)
+                return std::min<uint64_t>(uint64_t(1) << (i + 1), maxUs);
+        }
+        return maxUs;
+    }
+};
+
+/**
+ * getStats() result. Queue depths are sampled by the caller;
+ * `hasKernelDrops` is false where the platform has no such counter.
+ */
+inline Napi::Object SocketStatsToNapi(Napi::Env env, const SocketStats &s, size_t sendQueue, size_t pendingDatagrams,
+                                      bool hasKernelDrops)
+{
+    auto load = [](const std::atomic<uint64_t> &v) { return static_cast<double>(v.load(std::memory_order_relaxed)); };
+
+    auto result = Napi::Object::New(env);
+    result.Set("packetsReceived", load(s.packetsReceived));
+    result.Set("bytesReceived", load(s.bytesReceived));
+    result.Set("packetsSent", load(s.packetsSent));
+    result.Set("bytesSent", load(s.bytesSent));
+    if (hasKernelDrops)
+        result.Set("kernelDrops", load(s.kernelDrops));
+    result.Set("batchDrops", load(s.batchDrops));
+    result.Set("truncated", load(s.truncated));
+    result.Set("filtered", load(s.filtered));
+    result.Set("shed", load(s.shed));
+    result.Set("challenged", load(s.challenged));
+    result.Set("sendErrors", load(s.sendErrors));
+    result.Set("sendFull", load(s.sendFull));
+    if (s.recvBuffer.load(std::memory_order_relaxed) > 0)
+    {
+        result.Set("recvBuffer", load(s.recvBuffer));
+        result.Set("sendBuffer", load(s.sendBuffer));
+    }
+    result.Set("sendQueue", static_cast<double>(sendQueue));
+    result.Set("pendingDatagrams", static_cast<double>(pendingDatagrams));
+    result.Set("pendingEvents", static_cast<double>(std::max<int64_t>(0, s.pendingEvents.load(std::memory_order_relaxed))));
+    result.Set("peakPendingEvents", static_cast<double>(s.peakPendingEvents.load(std::memory_order_relaxed)));
+
+    auto handoff = Napi::Object::New(env);
+    auto buckets = Napi::Array::New(env, HANDOFF_BUCKETS);
+    double count = 0;
+    for (int i = 0; i < HANDOFF_BUCKETS; ++i)
+    {
+        double n = load(s.handoffUs[i]);
+        buckets.Set(static_cast<uint32_t>(i), n);
+        count += n;
+    }
+    handoff.Set("count", count);
+    handoff.Set("p50Us", static_cast<double>(s.handoffPercentileUs(0.5)));
+    handoff.Set("p90Us", static_cast<double>(s.handoffPercentileUs(0.9)));
+    handoff.Set("p99Us", static_cast<double>(s.handoffPercentileUs(0.99)));
+    handoff.Set("maxUs", load(s.handoffMaxUs));
+    handoff.Set("buckets", buckets);
+    result.Set("handoff", handoff);
+    return result;
+}
+
+} // namespace net
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+/**
+ * Hierarchical timing wheel at 1 ms resolution (Varghese & Lauck, as in the
+ * Linux kernel's timer wheel).
+ *
+ * Four levels of 64 slots each: level 0 holds timers due within the current
+ * 64 ms, level 1 those within the current 4 s, and so on up to ~4.6 hours;
+ * anything further waits in an overflow list. A timer sits in the slot its
+ * deadline falls in at the lowest level that can tell it apart from now, and
+ * moves down a level whenever the clock reaches its slot. Arming, cancelling
+ * and firing are O(1); finding the next deadline is O(levels) using a bitmap
+ * of occupied slots per level.
+ *
+ * Timers are intrusive: the owner embeds a Timer, or derives from one (per
+ * packet, per purpose), and the wheel links it into a slot. `kind` tells the
+ * owner what a fired one is for. A Timer unlinks itself when destroyed, so
+ * erasing whatever holds it cancels it. Copies start out unarmed.
+ *
+ * Not thread-safe; one owner thread, like the session using it.
+ */
+
+namespace net
+{
+
+class TimerWheel
+{
+public:
+    struct Timer
+    {
+        int64_t deadline = 0;
+        uint32_t kind = 0;
+
+        Timer() = default;
+        explicit Timer(uint32_t kind) : kind(kind) {}
+        Timer(const Timer &other) : kind(other.kind) {}
+        Timer &operator=(const Timer &other)
+        {
+            kind = other.kind;
+            return *this;
+        }
+        ~Timer() { cancel(); }
+
+        bool isArmed() const { return next_ != nullptr; }
+
+        void cancel()
+        {
+            if (!next_)
+                return;
+            prev_->next_ = next_;
+            next_->prev_ = prev_;
+            prev_ = next_ = nullptr;
+        }
+
+    private:
+        friend class TimerWheel;
+        Timer *prev_ = nullptr;
+        Timer *next_ = nullptr;
+    };
+
+    static constexpr int LEVEL_BITS = 6;
+    static constexpr int SLOTS = 1 << LEVEL_BITS;
+    static constexpr int LEVELS = 4;
+    static constexpr int64_t NEVER = INT64_MAX;
+
+    explicit TimerWheel(int64_t now = 0) : now_(now)
+    {
+        for (auto &level : slots_)
+        {
+            for (Timer &head : level)
+                head.prev_ = head.next_ = &head;
+        }
+        overflow_.prev_ = overflow_.next_ = &overflow_;
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    ~TimerWheel() { clear(); }
+
+    /** Time the wheel has been advanced to. */
+    int64_t now() const { return now_; }
+
+    /** (Re)arm `timer` for `deadline`; one already due fires on the next advance(). */
+    void schedule(Timer &timer, int64_t deadline)
+    {
+        timer.cancel();
+        timer.deadline = deadline;
+        insert(timer);
+    }
+
+    /**
+     * Lower bound of the earliest armed deadline, NEVER if none: exact for
+     * timers due within the current 64 ms, otherwise the start of the slot
+     * holding the earliest, where advance() moves it down a level.
+     */
+    int64_t nextDeadline() const
+    {
+        for (int level = 0; level < LEVELS; level++)
+        {
+            const int shift = level * LEVEL_BITS;
+            const int digit = static_cast<int>((now_ >> shift) & (SLOTS - 1));
+            // Level 0 still counts the current slot: timers due now
+            uint64_t ahead = level == 0 ? ~uint64_t(0) << digit
+                                        : digit == SLOTS - 1 ? 0 : ~uint64_t(0) << (digit + 1);
+            uint64_t occupied = occupied_[level] & ahead;
+            while (occupied != 0)
+            {
+                const int slot = __builtin_ctzll(occupied);
+                // Cancelled timers leave their bit set; clear it on the way
+                if (slots_[level][slot].next_ != &slots_[level][slot])
+                {
+                    const int64_t base = (now_ >> (shift + LEVEL_BITS)) << (shift + LEVEL_BITS);
+                    return base | (int64_t(slot) << shift);
+                }
+                occupied_[level] &= ~(uint64_t(1) << slot);
+                occupied &= occupied - 1;
+            }
+        }
+        if (overflow_.next_ != &overflow_)
+            return ((now_ >> (LEVELS * LEVEL_BITS)) + 1) << (LEVELS * LEVEL_BITS);
+        return NEVER;
+    }
+
+    /**
+     * Move the clock to `now`, calling fire(Timer &) for each timer due by
+     * then, in deadline order (timers due in the same millisecond in the
+     * order they were armed). A fired timer is unarmed; fire() may re-arm
+     * it, or arm and cancel others.
+     */
+    template <typename Fire>
+    void advance(int64_t now, Fire &&fire)
+    {
+        while (true)
+        {
+            const int64_t next = nextDeadline();
+            if (next > now)
+                break;
+            // Every slot boundary skipped on the way is empty
+            now_ = std::max(now_, next);
+            cascade();
+            Timer &head = slots_[0][now_ & (SLOTS - 1)];
+            if (head.next_ == &head)
+                continue;
+            // Take the slot's timers out first: anything fire() arms for now
+            // or earlier lands in the emptied slot and fires next round
+            Timer due;
+            due.next_ = head.next_;
+            due.prev_ = head.prev_;
+            due.next_->prev_ = &due;
+            due.prev_->next_ = &due;
+            head.prev_ = head.next_ = &head;
+            while (due.next_ != &due)
+            {
+                Timer &timer = *due.next_;
+                timer.cancel();
+                fire(timer);
+            }
+            due.cancel(); // emptied: just unlinks itself from itself
+        }
+        now_ = std::max(now_, now);
+    }
+
+    /** Cancel every timer and set the clock. */
+    void reset(int64_t now)
+    {
+        clear();
+        now_ = now;
+    }
+
+    /** Cancel every timer. */
+    void clear()
+    {
+        for (auto &level : slots_)
+        {
+            for (Timer &head : level)
+            {
+                while (head.next_ != &head)
+                    head.next_->cancel();
+            }
+        }
+        while (overflow_.next_ != &overflow_)
+            overflow_.next_->cancel();
+        for (uint64_t &bits : occupied_)
+            bits = 0;
+    }
+
+private:
+    int64_t now_;
+    Timer slots_[LEVELS][SLOTS];
+    Timer overflow_;                    // due past the top level's reach
+    mutable uint64_t occupied_[LEVELS] = {}; // bit per slot; may be stale after cancel()
+
+    // The lowest level whose slots tell the deadline apart from now: all
+    // higher digits match, so its slot comes strictly after now's (or is
+    // now's, at level 0) and gets cascaded or fired in time
+    void insert(Timer &timer)
+    {
+        const int64_t deadline = timer.deadline < now_ ? now_ : timer.deadline;
+        Timer *head = &overflow_;
+        for (int level = 0; level < LEVELS; level++)
+        {
+            const int shift = level * LEVEL_BITS;
+            if ((deadline >> (shift + LEVEL_BITS)) == (now_ >> (shift + LEVEL_BITS)))
+            {
+                const int slot = static_cast<int>((deadline >> shift) & (SLOTS - 1));
+                head = &slots_[level][slot];
+                occupied_[level] |= uint64_t(1) << slot;
+                break;
+            }
+        }
+        timer.prev_ = head->prev_;
+        timer.next_ = head;
+        head->prev_->next_ = &timer;
+        head->prev_ = &timer;
+    }
+
+    // On reaching a slot boundary, spread the timers of the slot now current
+    // at each level it starts (highest first) over the levels below
+    void cascade()
+    {
+        int top = 0;
+        while (top < LEVELS && (now_ & ((int64_t(1) << ((top + 1) * LEVEL_BITS)) - 1)) == 0)
+            top++;
+        if (top == LEVELS)
+            rehome(overflow_);
+        for (int level = std::min(top, LEVELS - 1); level >= 1; level--)
+            rehome(slots_[level][(now_ >> (level * LEVEL_BITS)) & (SLOTS - 1)]);
+    }
+
+    void rehome(Timer &head)
+    {
+        Timer moving;
+        if (head.next_ == &head)
+            return;
+        moving.next_ = head.next_;
+        moving.prev_ = head.prev_;
+        moving.next_->prev_ = &moving;
+        moving.prev_->next_ = &moving;
+        head.prev_ = head.next_ = &head;
+        while (moving.next_ != &moving)
+        {
+            Timer &timer = *moving.next_;
+            timer.cancel();
+            insert(timer);
+        }
+        moving.cancel();
+    }
+};
+
+} // namespace net
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <memory>
+
+/**
+ * Minimal io_uring ring for the datagram reactor, on raw syscalls (no
+ * liburing dependency).
+ *
+ * Covers what DatagramLinux needs and nothing more: one submission and one
+ * completion ring, submit-and-wait with a timeout (IORING_ENTER_EXT_ARG),
+ * and one ring of provided buffers that multishot receives pick from.
+ *
+ * init() refuses kernels that lack any of it, so callers can fall back to
+ * epoll on ENOSYS / EINVAL / EPERM (io_uring disabled by sysctl or seccomp)
+ * alike. Multishot RECVMSG (6.0) has no probe of its own; SEND_ZC arrived in
+ * the same release and stands in for it.
+ *
+ * Single-threaded: every call must come from the thread that owns the ring,
+ * except enterCount(), which may be read from anywhere.
+ */
+
+// Kernel headers older than 6.0 lack multishot receive; such builds are
+// epoll only
+#ifdef IORING_RECV_MULTISHOT
+#define NET_HAS_URING 1
+#else
+#define NET_HAS_URING 0
+#endif
+
+#if NET_HAS_URING
+
+namespace net
+{
+
+class Uring
+{
+public:
+    Uring() = default;
+    Uring(const Uring &) = delete;
+    Uring &operator=(const Uring &) = delete;
+
+    ~Uring()
+    {
+        if (bufRing_)
+            munmap(bufRing_, bufRingBytes_);
+        if (sqes_)
+            munmap(sqes_, sqeBytes_);
+        if (cqMap_ && cqMap_ != sqMap_)
+            munmap(cqMap_, cqMapBytes_);
+        if (sqMap_)
+            munmap(sqMap_, sqMapBytes_);
+        if (fd_ >= 0)
+            close(fd_);
+    }
+
+    /** Set up rings of `entries` submissions and `cqEntries` completions. 0 or errno. */
+    int init(unsigned entries, unsigned cqEntries)
+    {
+        io_uring_params p{};
+        p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+        p.cq_entries = cqEntries;
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0 && errno == EINVAL)
+        {
+            // COOP_TASKRUN is 5.19; the probe below rejects anything older anyway
+            p = io_uring_params{};
+            p.flags = IORING_SETUP_CQSIZE;
+            p.cq_entries = cqEntries;
+            fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        }
+        if (fd_ < 0)
+            return errno;
+        constexpr uint32_t required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((p.features & required) != required)
+            return ENOSYS;
+
+        sqMapBytes_ = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+        cqMapBytes_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        sqMapBytes_ = cqMapBytes_ = sqMapBytes_ > cqMapBytes_ ? sqMapBytes_ : cqMapBytes_;
+        sqMap_ = mmap(nullptr, sqMapBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                      IORING_OFF_SQ_RING);
+        if (sqMap_ == MAP_FAILED)
+        {
+            sqMap_ = nullptr;
+            return errno;
+        }
+        cqMap_ = sqMap_;
+        sqeBytes_ = p.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, sqeBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return errno;
+        sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+        auto *sq = static_cast<uint8_t *>(sqMap_);
+        sqHead_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+        sqTail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sqMask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sqEntries_ = p.sq_entries;
+        sqArray_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        auto *cq = static_cast<uint8_t *>(cqMap_);
+        cqHead_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cqTail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cqMask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        // The SQ index array maps 1:1 onto the SQE array
+        for (unsigned i = 0; i < sqEntries_; ++i)
+            sqArray_[i] = i;
+        localTail_ = *sqTail_;
+
+        const uint8_t ops[] = {IORING_OP_RECVMSG, IORING_OP_SENDMSG, IORING_OP_READ, IORING_OP_ASYNC_CANCEL,
+                               IORING_OP_SEND_ZC};
+        return probe(ops, sizeof(ops)) ? 0 : ENOSYS;
+    }
+
+    /**
+     * Next free SQE, zeroed. Submits what is queued first if the ring is
+     * full; nullptr only if that fails too.
+     */
+    io_uring_sqe *sqe()
+    {
+        unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if (localTail_ - head >= sqEntries_)
+        {
+            if (enter(0) != 0)
+                return nullptr;
+            head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+            if (localTail_ - head >= sqEntries_)
+                return nullptr;
+        }
+        io_uring_sqe *s = &sqes_[localTail_ & sqMask_];
+        memset(s, 0, sizeof(*s));
+        localTail_++;
+        return s;
+    }
+
+    /** Make room for `n` SQEs in a row (a linked chain must not be split by a submit). */
+    bool reserve(unsigned n)
+    {
+        if (sqEntries_ - (localTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE)) >= n)
+            return true;
+        return enter(0) == 0 && sqEntries_ - (localTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE)) >= n;
+    }
+
+    /**
+     * Submit queued SQEs and, unless `timeoutMs` is 0, wait up to that long
+     * (-1: no limit) for at least one completion. 0, ETIME or errno.
+     */
+    int enter(int timeoutMs)
+    {
+        __atomic_store_n(sqTail_, localTail_, __ATOMIC_RELEASE);
+        unsigned toSubmit = localTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        unsigned flags = 0;
+        unsigned minComplete = 0;
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        if (timeoutMs != 0 && !hasCompletions())
+        {
+            flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+            minComplete = 1;
+            if (timeoutMs > 0)
+            {
+                ts.tv_sec = timeoutMs / 1000;
+                ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+                arg.ts = reinterpret_cast<uint64_t>(&ts);
+            }
+        }
+        if (toSubmit == 0 && minComplete == 0)
+            return 0;
+        enterCount_.fetch_add(1, std::memory_order_relaxed);
+        long n = syscall(__NR_io_uring_enter, fd_, toSubmit, minComplete, flags,
+                         flags ? &arg : nullptr, flags ? sizeof(arg) : 0);
+        return n < 0 ? errno : 0;
+    }
+
+    bool hasCompletions() const { return __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_; }
+
+    /** Hand each completion to `fn(const io_uring_cqe &)` and retire it. */
+    template <typename F>
+    void reap(F &&fn)
+    {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+            fn(cqes_[head & cqMask_]);
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Register `count` (a power of two) buffers of `size` bytes as
+     * provided-buffer group `group` (IORING_REGISTER_PBUF_RING, 5.19).
+     */
+    bool addBuffers(uint16_t group, uint16_t count, uint32_t size)
+    {
+        bufRingBytes_ = count * sizeof(io_uring_buf);
+        void *mem = mmap(nullptr, bufRingBytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+            return false;
+        bufRing_ = static_cast<io_uring_buf_ring *>(mem);
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+        reg.ring_entries = count;
+        reg.bgid = group;
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+            return false;
+        buffers_.reset(new uint8_t[size_t(count) * size]);
+        bufSize_ = size;
+        bufMask_ = count - 1;
+        for (uint16_t i = 0; i < count; ++i)
+            recycle(i);
+        publishBuffers();
+        return true;
+    }
+
+    uint8_t *buffer(uint16_t id) const { return buffers_.get() + size_t(id) * bufSize_; }
+    uint32_t bufferSize() const { return bufSize_; }
+
+    /** Give buffer `id` back to the kernel, as of the next publishBuffers(). */
+    void recycle(uint16_t id)
+    {
+        // Not bufRing_->bufs: in C++ the header's flex-array wrapper puts it 8 bytes in
+        io_uring_buf &b = reinterpret_cast<io_uring_buf *>(bufRing_)[bufTail_ & bufMask_];
+        b.addr = reinterpret_cast<uint64_t>(buffer(id));
+        b.len = bufSize_;
+        b.bid = id;
+        bufTail_++;
+    }
+
+    void publishBuffers() { __atomic_store_n(&bufRing_->tail, bufTail_, __ATOMIC_RELEASE); }
+
+    /** io_uring_enter() calls so far */
+    uint64_t enterCount() const { return enterCount_.load(std::memory_order_relaxed); }
+
+private:
+    bool probe(const uint8_t *ops, size_t count)
+    {
+        constexpr unsigned PROBE_OPS = 256;
+        size_t bytes = sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op);
+        std::unique_ptr<uint8_t[]> mem(new uint8_t[bytes]());
+        auto *p = reinterpret_cast<io_uring_probe *>(mem.get());
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, p, PROBE_OPS) < 0)
+            return false;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (ops[i] > p->last_op || !(p->ops[ops[i]].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    void *sqMap_ = nullptr;
+    void *cqMap_ = nullptr;
+    size_t sqMapBytes_ = 0;
+    size_t cqMapBytes_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqeBytes_ = 0;
+
+    unsigned *sqHead_ = nullptr;
+    unsigned *sqTail_ = nullptr;
+    unsigned *sqArray_ = nullptr;
+    unsigned sqMask_ = 0;
+    unsigned sqEntries_ = 0;
+    unsigned localTail_ = 0; // SQEs handed out; published to *sqTail_ by enter()
+
+    unsigned *cqHead_ = nullptr;
+    unsigned *cqTail_ = nullptr;
+    unsigned cqMask_ = 0;
+    io_uring_cqe *cqes_ = nullptr;
+
+    io_uring_buf_ring *bufRing_ = nullptr;
+    size_t bufRingBytes_ = 0;
+    std::unique_ptr<uint8_t[]> buffers_;
+    uint32_t bufSize_ = 0;
+    uint16_t bufMask_ = 0;
+    uint16_t bufTail_ = 0;
+
+    std::atomic<uint64_t> enterCount_{0};
+};
+
+} // namespace net
+
+#endif // NET_HAS_URING
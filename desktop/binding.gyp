@@ -1,6 +1,27 @@
 {
+  "variables": {
+    "reudp_bench%": 0
+  },
   "targets": [],
   "conditions": [
+    ["reudp_bench==1", {
+      "targets": [
+        {
+          "target_name": "ReUdpBench",
+          "type": "executable",
+          "sources": ["addons/ReUdpBench.cpp"],
+          "cflags_cc": ["-std=c++17"],
+          "xcode_settings": {
+            "OTHER_CPLUSPLUSFLAGS": ["-std=c++17"]
+          },
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "AdditionalOptions": ["/std:c++17"]
+            }
+          }
+        }
+      ]
+    }],
     ["OS=='mac'", {
       "targets": [
         {
@@ -41,6 +62,20 @@
         }
       ]
     }],
+    ["OS=='linux'", {
+      "targets": [
+        {
+          "target_name": "DatagramLinux",
+          "sources": ["addons/DatagramLinux.cpp"],
+          "defines": ["NAPI_CPP_EXCEPTIONS"],
+          "cflags_cc!": ["-fno-exceptions"],
+          "cflags_cc": ["-std=c++17"],
+          "dependencies": [
+            "<!(node -p \"require('node-addon-api').targets\"):node_addon_api"
+          ]
+        }
+      ]
+    }],
     ["OS=='win'", {
       "targets": [
         {
@@ -0,0 +1,171 @@
+// Loopback throughput of DatagramLinux under each reactor backend, reported
+// per GB moved: syscalls made and CPU time used by the native I/O threads.
+//
+//   npm run build && npm run bench:datagram -- [--mode=datagram|session] [--mb=1024]
+//
+// Each backend runs in its own process, since a reactor keeps the backend it
+// started with. `datagram` sends 1300-byte datagrams (ReUDP's packet size)
+// between two batch-mode sockets, honouring send credits; `session` pushes a
+// native ReUDP session transfer through the same sockets.
+
+const { execFileSync } = require('child_process');
+const path = require('path');
+
+const ADDON = path.join(__dirname, '..', 'build', 'Release', 'DatagramLinux.node');
+const PACKET_SIZE = 1300;
+const CHUNK_SIZE = 65536;
+const BACKENDS = ['epoll', 'io_uring'];
+
+function parseArgs() {
+    const args = { mode: 'datagram', mb: 1024, child: null };
+    for (const arg of process.argv.slice(2)) {
+        const [key, value] = arg.replace(/^--/, '').split('=');
+        if (key === 'mode') args.mode = value;
+        else if (key === 'mb') args.mb = Number(value);
+        else if (key === 'child') args.child = value;
+    }
+    if (!['datagram', 'session'].includes(args.mode) || !(args.mb > 0)) {
+        console.error('Usage: node scripts/bench-datagram.js [--mode=datagram|session] [--mb=1024]');
+        process.exit(1);
+    }
+    return args;
+}
+
+// ── Child: one transfer on one backend ──────────────────────────────
+
+function runDatagram(m, total, finish) {
+    let received = 0;
+    const rx = m.createSocket((event, data, table) => {
+        if (event !== 'batch') return;
+        for (let i = 1; i < table.length; i += 3) received += table[i];
+        m.release(data);
+        if (received >= total) finish(received);
+    }, { batch: true });
+    let credits = 1;
+    let waiting = null;
+    const tx = m.createSocket((event, value) => {
+        if (event !== 'drain') return;
+        credits = value;
+        const resume = waiting;
+        waiting = null;
+        resume && resume();
+    });
+    const port = m.bind(rx, 0).port;
+    m.bind(tx, 0);
+    const packet = Buffer.alloc(PACKET_SIZE, 7);
+
+    (async () => {
+        for (let sent = 0; sent < total; sent += PACKET_SIZE) {
+            if (credits <= 0) await new Promise(resolve => waiting = resolve);
+            credits = m.send(tx, packet, port, '127.0.0.1');
+        }
+        // Loopback may still drop under load: settle for what arrived
+        let last = -1;
+        const settle = setInterval(() => {
+            if (received === last) {
+                clearInterval(settle);
+                finish(received);
+            }
+            last = received;
+        }, 200);
+    })();
+    return [rx, tx];
+}
+
+function runSession(m, total, finish) {
+    const peers = [];
+    let received = 0;
+    let waiting = null;
+    for (let i = 0; i < 2; i++) {
+        peers.push(m.createSocket((event, id, value) => {
+            if (event === 'sessionData') {
+                received += value.length;
+                if (received >= total) finish(received);
+            } else if (event === 'sessionDrain') {
+                const resume = waiting;
+                waiting = null;
+                resume && resume();
+            } else if (event === 'sessionReady' && i === 0) {
+                pump();
+            }
+        }, { batch: true }));
+    }
+    const ports = peers.map(h => m.bind(h, 0).port);
+    const sender = m.openSession(peers[0], { addresses: ['127.0.0.1'], port: ports[1], lan: true });
+    m.openSession(peers[1], { addresses: ['127.0.0.1'], port: ports[0], lan: true });
+    const chunk = Buffer.alloc(CHUNK_SIZE, 7);
+
+    async function pump() {
+        for (let sent = 0; sent < total; sent += CHUNK_SIZE) {
+            if (!m.sessionSend(peers[0], sender, chunk)) await new Promise(resolve => waiting = resolve);
+        }
+    }
+    return peers;
+}
+
+function runChild(backend, mode, total) {
+    const m = require(ADDON);
+    m.setBackend(backend);
+    const start = process.hrtime.bigint();
+    let handles = [];
+    let isDone = false;
+    const finish = (received) => {
+        if (isDone) return;
+        isDone = true;
+        const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+        const stats = m.reactorStats();
+        handles.forEach(h => m.close(h));
+        console.log(JSON.stringify({
+            backend: stats.backend,
+            received,
+            seconds,
+            syscalls: stats.syscalls,
+            cpuMs: stats.cpuMs,
+        }));
+        process.exit(0);
+    };
+    handles = mode === 'session' ? runSession(m, total, finish) : runDatagram(m, total, finish);
+    setTimeout(() => {
+        console.error(`${backend}: transfer stalled`);
+        process.exit(1);
+    }, 120000);
+}
+
+// ── Parent: run each backend and compare ────────────────────────────
+
+function main() {
+    const args = parseArgs();
+    const total = args.mb * 1024 * 1024;
+    if (args.child) {
+        runChild(args.child, args.mode, total);
+        return;
+    }
+    if (process.platform !== 'linux') {
+        console.error('DatagramLinux only runs on Linux.');
+        process.exit(1);
+    }
+
+    const rows = [];
+    for (const backend of BACKENDS) {
+        const out = execFileSync(process.execPath,
+            [__filename, `--child=${backend}`, `--mode=${args.mode}`, `--mb=${args.mb}`],
+            { encoding: 'utf-8', stdio: ['ignore', 'pipe', 'inherit'] });
+        const result = JSON.parse(out.trim().split('\n').pop());
+        if (result.backend !== backend) {
+            console.warn(`${backend}: not available, ran on ${result.backend}`);
+        }
+        const gb = result.received / (1024 * 1024 * 1024);
+        rows.push({
+            backend: result.backend,
+            requested: backend,
+            'MB/s': Math.round(result.received / (1024 * 1024) / result.seconds),
+            'delivered %': +(100 * result.received / total).toFixed(1),
+            'syscalls/GB': Math.round(result.syscalls / gb),
+            'CPU ms/GB': Math.round(result.cpuMs / gb),
+        });
+    }
+    console.log(`${args.mode} transfer, ${args.mb} MB over loopback`);
+    console.table(rows);
+}
+
+main();
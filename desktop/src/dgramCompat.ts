@@ -1,45 +1,167 @@
-import { DatagramCompat } from "shared/compat";
+import { DatagramBatch, DatagramCompat, DatagramPeer, DatagramSocketStats, ReliableSessionCompat, ReliableSessionOptions, ReliableSessionStats } from "shared/compat";
 import { importModule } from "./utils";
 import { platform } from "os";
+import { isIP } from "net";
+import { lookup } from "dns/promises";
 import { UserPreferences } from "./types";
+import { DataLane, DataSendOptions } from "shared/types";
 import { Datagram_ } from "nodeShared/netCompat";
 
-// ── WinRT DatagramSocket wrapper ────────────────────────────────────
-// Uses Windows.Networking.Sockets.DatagramSocket via native addon.
-// This is necessary for MSIX AppContainer where Win32 Winsock (Node.js dgram)
-// doesn't fully respect network capabilities like internetClientServer.
+// ── Native datagram addons ──────────────────────────────────────────
+// DatagramWin: Windows.Networking.Sockets.DatagramSocket. This is necessary
+// for MSIX AppContainer where Win32 Winsock (Node.js dgram) doesn't fully
+// respect network capabilities like internetClientServer.
+// DatagramLinux: recvmmsg/sendmmsg batching on a native I/O thread, so bulk
+// ReUDP transfers aren't capped by per-packet syscalls and callbacks.
+// Both expose the same surface, including batched delivery: all datagrams
+// received since JS last ran arrive in a single 'batch' callback.
+// DatagramLinux can also run ReUDP sessions on its I/O thread (openSession),
+// drop datagrams from unknown peers there (setPeerFilter), and drive its
+// I/O thread with io_uring instead of epoll (setBackend).
 
-interface DatagramWinModule {
-    createSocket(callback: (event: string, ...args: any[]) => void): number;
+interface NativeDatagramModule {
+    createSocket(callback: (event: string, ...args: any[]) => void, options?: { batch?: boolean; maxBuffer?: number }): number;
     bind(handle: number, port?: number): { address: string; family: string; port: number };
-    send(handle: number, data: Uint8Array | Buffer, port: number, address: string): void;
+    send(handle: number, data: Uint8Array | Buffer, port: number, address: string): number | void; // credits, -1 when full
     address(handle: number): { address: string; family: string; port: number };
     close(handle: number): void;
+    openSession?(handle: number, options: { addresses: string[]; port: number; lan: boolean; legacyPeer?: boolean }): number;
+    sessionSend?(handle: number, sessionId: number, data: Uint8Array, lane?: DataLane): boolean;
+    closeSession?(handle: number, sessionId: number): void;
+    sessionStats?(handle: number, sessionId: number): ReliableSessionStats | null;
+    setPeerFilter?(handle: number, peers: DatagramPeer[] | null): void;
+    isDontFragment?(handle: number): boolean;
+    maxDatagramSize?(handle: number, address: string): number;
+    setSessionCipher?(handle: number, sessionId: number, direction: 'send' | 'recv', key: Uint8Array, iv: Uint8Array): void;
+    getStats?(handle: number): DatagramSocketStats | null;
+    release?(buffer: Buffer): void;
+    setBackend?(backend: 'io_uring' | 'epoll'): void;
+    reactorStats?(): { backend: 'io_uring' | 'epoll' | null; syscalls: number; cpuMs: number };
 }
 
-let datagramWinModule: DatagramWinModule | null = null;
+let datagramWinModule: NativeDatagramModule | null = null;
+let datagramLinuxModule: NativeDatagramModule | null = null;
 
-function getDatagramWinModule(): DatagramWinModule {
+function getDatagramWinModule(): NativeDatagramModule {
     if (!datagramWinModule) {
-        datagramWinModule = importModule("DatagramWin") as DatagramWinModule;
+        datagramWinModule = importModule("DatagramWin") as NativeDatagramModule;
     }
     return datagramWinModule;
 }
 
-export class WinRTDatagram extends DatagramCompat {
-    private handle: number | null = null;
+function getDatagramLinuxModule(): NativeDatagramModule {
+    if (!datagramLinuxModule) {
+        datagramLinuxModule = importModule("DatagramLinux") as NativeDatagramModule;
+    }
+    return datagramLinuxModule;
+}
+
+class NativeReliableSession implements ReliableSessionCompat {
+    onReady?: (isSuccess: boolean) => void;
+    onMessage?: (data: Uint8Array, lane: DataLane) => void;
+    onClose?: (err: Error | null) => void;
+
+    private isClosed = false;
+    private drainWaiters: (() => void)[] = [];
+
+    constructor(private mod: NativeDatagramModule, private handle: number, readonly id: number) { }
+
+    async send(data: Uint8Array, options?: DataSendOptions): Promise<void> {
+        if (this.isClosed) return;
+        const lane = options?.lane ?? DataLane.Control;
+        let hasRoom: boolean;
+        try {
+            hasRoom = this.mod.sessionSend!(this.handle, this.id, data, lane);
+        } catch (e) {
+            return; // closed natively, the close event is on its way
+        }
+        // The backlog is mostly bulk; control is scheduled ahead of it natively
+        // and is too small to matter, so it doesn't wait
+        if (!hasRoom && lane !== DataLane.Control) {
+            await new Promise<void>(resolve => this.drainWaiters.push(resolve));
+        }
+    }
+
+    close(): void {
+        if (this.isClosed) return;
+        try {
+            this.mod.closeSession!(this.handle, this.id);
+        } catch (e) {
+            // Socket already closed
+        }
+    }
+
+    stats(): ReliableSessionStats | null {
+        if (this.isClosed || !this.mod.sessionStats) return null;
+        return this.mod.sessionStats(this.handle, this.id);
+    }
+
+    setFrameCipher(direction: 'send' | 'recv', secretKey: string, iv: string): void {
+        try {
+            this.mod.setSessionCipher!(this.handle, this.id, direction, Buffer.from(secretKey, 'hex'), Buffer.from(iv, 'hex'));
+        } catch (e) {
+            // Closed natively, the close event is on its way
+        }
+    }
+
+    handleEvent(event: string, args: any[]) {
+        switch (event) {
+            case 'sessionReady':
+                this.onReady?.(args[0]);
+                break;
+            case 'sessionData': {
+                const [data, lane] = args;
+                this.onMessage?.(new Uint8Array(data.buffer, data.byteOffset, data.byteLength), lane);
+                break;
+            }
+            case 'sessionDrain':
+                this.wakeSenders();
+                break;
+            case 'sessionClose': {
+                const [errMsg] = args;
+                this.markClosed();
+                this.onClose?.(errMsg ? new Error(errMsg) : null);
+                break;
+            }
+        }
+    }
+
+    markClosed() {
+        this.isClosed = true;
+        this.wakeSenders();
+    }
+
+    private wakeSenders() {
+        const waiters = this.drainWaiters;
+        this.drainWaiters = [];
+        for (const w of waiters) w();
+    }
+}
+
+class NativeDatagram extends DatagramCompat {
+    protected handle: number | null = null;
     private _address?: { address: string; family: string; port: number };
+    private sessions = new Map<number, NativeReliableSession>();
+    private credits = Infinity;
+    private drainWaiters: (() => void)[] = [];
 
-    constructor() {
+    constructor(protected mod: NativeDatagramModule) {
         super();
-        const mod = getDatagramWinModule();
         this.handle = mod.createSocket((event: string, ...args: any[]) => {
             switch (event) {
                 case 'message': {
                     const [msg, rinfo] = args;
                     if (this.onMessage) {
-                        // msg comes as Buffer from native side
-                        this.onMessage(new Uint8Array(msg), rinfo);
+                        // msg is a Buffer over native receive memory; view it, don't copy
+                        this.onMessage(new Uint8Array(msg.buffer, msg.byteOffset, msg.byteLength), rinfo);
+                    }
+                    break;
+                }
+                case 'batch': {
+                    const [data, table, rinfos, times] = args;
+                    if (this.dispatchBatch({ data: new Uint8Array(data.buffer, data.byteOffset, data.byteLength), table, rinfos, times })) {
+                        // Batch consumers copy what they keep, so the slab can be reused right away
+                        this.mod.release?.(data);
                     }
                     break;
                 }
@@ -50,22 +172,83 @@ export class WinRTDatagram extends DatagramCompat {
                     }
                     break;
                 }
+                case 'drain': {
+                    const [credits] = args;
+                    this.credits = credits;
+                    this.wakeSenders();
+                    this.onDrain?.();
+                    break;
+                }
                 case 'close': {
+                    this.wakeSenders();
+                    for (const session of this.sessions.values()) session.markClosed();
+                    this.sessions.clear();
                     if (this.onClose) {
                         this.onClose();
                     }
                     break;
                 }
+                case 'sessionReady':
+                case 'sessionData':
+                case 'sessionDrain':
+                case 'sessionClose': {
+                    const [sessionId, ...rest] = args;
+                    const session = this.sessions.get(sessionId);
+                    if (event === 'sessionClose') this.sessions.delete(sessionId);
+                    session?.handleEvent(event, rest);
+                    break;
+                }
             }
-        });
+        }, { batch: true });
+    }
+
+    openReliableSession(options: ReliableSessionOptions): ReliableSessionCompat | null {
+        // Native sessions only take numeric IPv4 peers
+        if (this.handle === null || !this.mod.openSession || !options.addresses.every(addr => isIP(addr) === 4)) {
+            return null;
+        }
+        const id = this.mod.openSession(this.handle, { addresses: options.addresses, port: options.port, lan: options.isLan, legacyPeer: options.isLegacyPeer });
+        const session = new NativeReliableSession(this.mod, this.handle, id);
+        this.sessions.set(id, session);
+        return session;
+    }
+
+    setPeerFilter(peers: DatagramPeer[] | null): boolean {
+        // The native filter only takes numeric IPv4 addresses
+        if (this.handle === null || !this.mod.setPeerFilter
+            || !(peers ?? []).every(peer => peer.addresses.every(addr => isIP(addr) === 4))) {
+            return false;
+        }
+        this.mod.setPeerFilter(this.handle, peers);
+        return true;
+    }
+
+    isDontFragment(): boolean {
+        return this.handle !== null && (this.mod.isDontFragment?.(this.handle) ?? false);
+    }
+
+    maxDatagramSize(address: string): number {
+        return this.handle !== null && isIP(address) === 4 ? (this.mod.maxDatagramSize?.(this.handle, address) ?? 0) : 0;
+    }
+
+    // Returns whether the batch went to onMessageBatch (and may be released)
+    private dispatchBatch(batch: DatagramBatch): boolean {
+        if (this.onMessageBatch) {
+            this.onMessageBatch(batch);
+            return true;
+        }
+        const { data, table, rinfos } = batch;
+        for (let i = 0; i < table.length && this.onMessage; i += 3) {
+            this.onMessage(data.subarray(table[i], table[i] + table[i + 1]), rinfos[table[i + 2]]);
+        }
+        return false;
     }
 
     async bind(port?: number, _address?: string): Promise<void> {
         if (this.handle === null) {
             throw new Error('Socket not initialized');
         }
-        const mod = getDatagramWinModule();
-        const addr = mod.bind(this.handle, port);
+        const addr = this.mod.bind(this.handle, port);
         this._address = addr;
         if (this.onListen) {
             this.onListen();
@@ -80,17 +263,40 @@ export class WinRTDatagram extends DatagramCompat {
     }
 
     async send(data: Uint8Array, port: number, address: string): Promise<void> {
-        if (this.handle !== null) {
-            const mod = getDatagramWinModule();
-            mod.send(this.handle, data, port, address);
+        // Queue behind senders already waiting for room so datagrams keep their order
+        if (this.drainWaiters.length > 0) {
+            await new Promise<void>(resolve => this.drainWaiters.push(resolve));
         }
+        while (this.handle !== null) {
+            const credits = this.mod.send(this.handle, data, port, address);
+            if (typeof credits !== 'number' || credits >= 0) {
+                this.credits = typeof credits === 'number' ? credits : Infinity;
+                return;
+            }
+            this.credits = 0;
+            await new Promise<void>(resolve => this.drainWaiters.push(resolve));
+        }
+    }
+
+    sendCredits(): number {
+        return this.credits;
+    }
+
+    stats(): DatagramSocketStats | null {
+        if (this.handle === null || !this.mod.getStats) return null;
+        return this.mod.getStats(this.handle);
+    }
+
+    private wakeSenders() {
+        const waiters = this.drainWaiters;
+        this.drainWaiters = [];
+        for (const w of waiters) w();
     }
 
     close(): void {
         if (this.handle !== null) {
-            const mod = getDatagramWinModule();
             try {
-                mod.close(this.handle);
+                this.mod.close(this.handle);
             } catch (e) {
                 // Already closed
             }
@@ -100,9 +306,50 @@ export class WinRTDatagram extends DatagramCompat {
     }
 }
 
+export class WinRTDatagram extends NativeDatagram {
+    constructor() {
+        super(getDatagramWinModule());
+    }
+}
+
+export class LinuxDatagram extends NativeDatagram {
+    // The native side only takes numeric addresses; the auth server is
+    // addressed by hostname, so resolve here (off the I/O thread).
+    private resolved = new Map<string, string>();
+
+    constructor() {
+        super(getDatagramLinuxModule());
+    }
+
+    async send(data: Uint8Array, port: number, address: string): Promise<void> {
+        if (!isIP(address)) {
+            let ip = this.resolved.get(address);
+            if (!ip) {
+                ip = (await lookup(address, { family: 4 })).address;
+                this.resolved.set(address, ip);
+            }
+            address = ip;
+        }
+        return super.send(data, port, address);
+    }
+}
+
+// On unless the user turned it off: sessions then run the JS engine over Node.js dgram
+function useNativeLinuxDatagram(): boolean {
+    try {
+        const localSc = modules.getLocalServiceController();
+        return localSc.app.getUserPreferenceSync(UserPreferences.USE_NATIVE_DGRAM) !== false;
+    } catch (e) {
+        return true;
+    }
+}
+
 /**
  * Create the best available DatagramCompat for the current environment.
  * - On Windows MSIX (packaged app): uses WinRT DatagramSocket
+ * - On Linux: uses the batched native socket unless the `useNativeDgram`
+ *   preference is off, on io_uring if the `useIoUring` preference is set
+ *   (falls back to epoll on older kernels)
  * - Otherwise: uses Node.js dgram
  */
 export function createBestDatagram(): DatagramCompat {
@@ -118,5 +365,20 @@ export function createBestDatagram(): DatagramCompat {
             console.warn('[Datagram] Failed to create WinRT datagram, falling back to Node.js dgram:', e);
         }
     }
+    if (platform() === 'linux' && useNativeLinuxDatagram()) {
+        try {
+            // Takes effect for an I/O thread not started yet, i.e. until the first socket
+            const localSc = modules.getLocalServiceController();
+            const useIoUring = localSc.app.getUserPreferenceSync(UserPreferences.USE_IO_URING);
+            getDatagramLinuxModule().setBackend?.(useIoUring ? 'io_uring' : 'epoll');
+        } catch (e) {
+            console.warn('[Datagram] Failed to select the Linux I/O backend:', e);
+        }
+        try {
+            return new LinuxDatagram();
+        } catch (e) {
+            console.warn('[Datagram] Failed to create native Linux datagram, falling back to Node.js dgram:', e);
+        }
+    }
     return new Datagram_();
 }
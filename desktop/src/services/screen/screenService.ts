@@ -4,7 +4,7 @@ import {
     RemoteAppWindowActionPayload,
     StreamingSessionInfo,
 } from "shared/types";
-import { encodeMediaChunk } from "shared/mediaStream";
+import { encodeMediaChunk, markMediaStream } from "shared/mediaStream";
 import { serviceStartMethod, serviceStopMethod } from "shared/servicePrimatives";
 import { AppsDriver } from "./driver";
 import { MacAppsDriver } from "./macDriver";
@@ -88,16 +88,16 @@ export default class DesktopScreenService extends ScreenService {
         // Stop any existing session
         await this._stopStreamingSession();
 
-        // Create a ReadableStream that will receive H.264 chunks
+        // Create a ReadableStream that will receive H.264 chunks; as media, ReUDP sends it with FEC
         let streamController: ReadableStreamDefaultController<Uint8Array> | null = null;
-        const stream = new ReadableStream<Uint8Array>({
+        const stream = markMediaStream(new ReadableStream<Uint8Array>({
             start(controller) {
                 streamController = controller;
             },
             cancel: () => {
                 this._stopStreamingSession().catch(() => {});
             },
-        });
+        }));
 
         // Start native H.264 screen stream
         let frameCount = 0;
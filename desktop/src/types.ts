@@ -32,6 +32,8 @@ export interface VolumeDriver {
 
 export enum UserPreferences {
     USE_WINRT_DGRAM = 'useWinrtDgram',
+    USE_NATIVE_DGRAM = 'useNativeDgram',
+    USE_IO_URING = 'useIoUring',
     CHECK_FOR_UPDATES = 'checkForUpdates',
     AUTO_CONNECT_MOBILE = 'autoConnectMobile',
 }
@@ -148,24 +148,25 @@ export default class CryptoImpl extends CryptoModule {
         return Buffer.from(data).toString('base64');
     }
 
+    // CTR is a stream mode: update() returns all of the output and final()
+    // adds nothing, so neither needs a concat.
     encryptBuffer(data: Uint8Array, secretKey: string): Uint8Array {
         const iv = crypto.randomBytes(16);
         const key = this.getParsedKey(secretKey);
         const cipher = crypto.createCipheriv('aes-256-ctr', key, iv);
-        const encrypted = Buffer.concat([cipher.update(data), cipher.final()]);
         // Prepend IV to ciphertext: [IV (16 bytes)][ciphertext]
-        const result = new Uint8Array(16 + encrypted.length);
-        result.set(iv, 0);
-        result.set(encrypted, 16);
+        const result = Buffer.allocUnsafe(16 + data.length);
+        iv.copy(result, 0);
+        cipher.update(data).copy(result, 16);
         return result;
     }
 
     decryptBuffer(data: Uint8Array, secretKey: string): Uint8Array {
-        const iv = data.slice(0, 16);
-        const ciphertext = data.slice(16);
+        const iv = data.subarray(0, 16);
+        const ciphertext = data.subarray(16);
         const key = this.getParsedKey(secretKey);
         const decipher = crypto.createDecipheriv('aes-256-ctr', key, iv);
-        return new Uint8Array(Buffer.concat([decipher.update(ciphertext), decipher.final()]));
+        return decipher.update(ciphertext);
     }
 
     generateIv(): string {
@@ -176,7 +177,7 @@ export default class CryptoImpl extends CryptoModule {
         const key = this.getParsedKey(secretKey);
         const cipher = crypto.createCipheriv('aes-256-ctr', key, Buffer.from(iv, 'hex'));
         return {
-            update: (data: Uint8Array): Uint8Array => new Uint8Array(cipher.update(data)),
+            update: (data: Uint8Array): Uint8Array => cipher.update(data), // a Buffer is a Uint8Array; don't copy it
         };
     }
 
@@ -184,7 +185,7 @@ export default class CryptoImpl extends CryptoModule {
         const key = this.getParsedKey(secretKey);
         const decipher = crypto.createDecipheriv('aes-256-ctr', key, Buffer.from(iv, 'hex'));
         return {
-            update: (data: Uint8Array): Uint8Array => new Uint8Array(decipher.update(data)),
+            update: (data: Uint8Array): Uint8Array => decipher.update(data),
         };
     }
 }
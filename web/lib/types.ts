@@ -103,6 +103,8 @@ export type NativeUtils = {
 
 export enum UserPreferences {
     USE_WINRT_DGRAM = 'useWinrtDgram',
+    USE_NATIVE_DGRAM = 'useNativeDgram',
+    USE_IO_URING = 'useIoUring',
     CHECK_FOR_UPDATES = 'checkForUpdates',
     AUTO_CONNECT_MOBILE = 'autoConnectMobile',
     MCP_AUTO_START = 'mcpAutoStart',
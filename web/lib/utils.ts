@@ -265,6 +265,11 @@ export function isWindows(): boolean {
   return window.modules.config.OS === OSType.Windows;
 }
 
+export function isLinux(): boolean {
+  if (typeof window === 'undefined') return false;
+  return window.modules.config.OS === OSType.Linux;
+}
+
 export function getAppName() {
   if (typeof window === 'undefined') return 'App';
   if (window.modules?.config?.APP_NAME) {
@@ -1,6 +1,6 @@
 import { PageBar, PageContent } from "@/components/pagePrimatives";
 import { FormContainer, Section, Line } from '@/components/formPrimatives'
-import { buildPageConfig, isWindows } from '@/lib/utils'
+import { buildPageConfig, isLinux, isWindows } from '@/lib/utils'
 import Head from 'next/head'
 import Image from 'next/image'
 import React, { useEffect, useState, useCallback, useMemo } from 'react'
@@ -28,6 +28,8 @@ function Page() {
   const [autoStartDisabled, setAutoStartDisabled] = useState(false);
   const { openDialog } = useOnboardingStore();
   const [useWinrtDgram, setUseWinrtDgram] = useState(false);
+  const [useNativeDgram, setUseNativeDgram] = useState(true);
+  const [useIoUring, setUseIoUring] = useState(false);
   const [autoConnectMobile, setAutoConnectMobile] = useState(true);
   const [checkForUpdates, setCheckForUpdates] = useState(true);
   const [ifaceStatuses, setIfaceStatuses] = useState<{ type: ConnectionType; enabled: boolean }[]>([]);
@@ -36,6 +38,8 @@ function Page() {
   useEffect(() => {
     const localSc = window.modules.getLocalServiceController();
     setUseWinrtDgram(localSc.app.getUserPreferenceSync(UserPreferences.USE_WINRT_DGRAM));
+    setUseNativeDgram(localSc.app.getUserPreferenceSync(UserPreferences.USE_NATIVE_DGRAM) !== false);
+    setUseIoUring(localSc.app.getUserPreferenceSync(UserPreferences.USE_IO_URING));
     const autoConnectMobilePref = localSc.app.getUserPreferenceSync(UserPreferences.AUTO_CONNECT_MOBILE);
     setAutoConnectMobile(autoConnectMobilePref !== false);
     const updatesPref = localSc.app.getUserPreferenceSync(UserPreferences.CHECK_FOR_UPDATES);
@@ -74,6 +78,18 @@ function Page() {
     setUseWinrtDgram(localSc.app.getUserPreferenceSync(UserPreferences.USE_WINRT_DGRAM));
   }, []);
 
+  const updateNativeDgram = useCallback(async (val: boolean) => {
+    const localSc = window.modules.getLocalServiceController();
+    await localSc.app.setUserPreference(UserPreferences.USE_NATIVE_DGRAM, val);
+    setUseNativeDgram(val);
+  }, []);
+
+  const updateIoUring = useCallback(async (val: boolean) => {
+    const localSc = window.modules.getLocalServiceController();
+    await localSc.app.setUserPreference(UserPreferences.USE_IO_URING, val);
+    setUseIoUring(localSc.app.getUserPreferenceSync(UserPreferences.USE_IO_URING));
+  }, []);
+
   const updateAutoConnectMobile = useCallback(async (val: boolean) => {
     const localSc = window.modules.getLocalServiceController();
     await localSc.app.setUserPreference(UserPreferences.AUTO_CONNECT_MOBILE, val);
@@ -105,6 +121,7 @@ function Page() {
     return autoStartEnabled !== null
       || !window.modules.config.IS_STORE_DISTRIBUTION
       || isWindows()
+      || isLinux()
       || isLinked;
   }, [autoStartEnabled, isLinked]);
 
@@ -174,6 +191,22 @@ function Page() {
                 />
               </Line>
             }
+            {
+              isLinux() && <Line title={'Use native network I/O'}>
+                <Switch
+                  checked={useNativeDgram}
+                  onCheckedChange={updateNativeDgram}
+                />
+              </Line>
+            }
+            {
+              isLinux() && useNativeDgram && <Line title={'Use io_uring for network I/O (Experimental)'}>
+                <Switch
+                  checked={useIoUring}
+                  onCheckedChange={updateIoUring}
+                />
+              </Line>
+            }
           </Section>}
           {ifaceStatuses.length > 0 && (
             <Section title="Allowed Connections" footer="At least one connection method must be enabled to connect to other devices.">